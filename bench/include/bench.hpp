@@ -0,0 +1,94 @@
+#ifndef __BENCH_HPP__
+#define __BENCH_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Minimal micro benchmark harness for utils-bench.
+ *
+ * Every case is registered at static initialisation time with BENCH_CASE
+ * and receives a State holding the number of iterations to execute. The
+ * runner grows the iteration count until one run lasts at least the
+ * configured minimum time, repeats the measurement and keeps the median.
+ * Heap allocations are counted by the replaced global operator new in
+ * bench/main.cpp.
+ */
+namespace Bench
+{
+    class State
+    {
+    public:
+        std::size_t iterations;
+        std::size_t bytesPerOp;
+        std::size_t threads;
+
+        explicit State(std::size_t iterations) : iterations(iterations), bytesPerOp(0), threads(1) {}
+
+        /* payload processed by one operation, enables the MB/s column */
+        void setBytesPerOp(std::size_t bytes)
+        {
+            this->bytesPerOp = bytes;
+        }
+
+        /* number of threads the case runs, iterations are split across them */
+        void setThreads(std::size_t threads)
+        {
+            this->threads = threads;
+        }
+    };
+
+    struct Case
+    {
+        std::string name;
+        std::function<void(State &)> body;
+    };
+
+    struct Result
+    {
+        std::string name;
+        std::size_t iterations;
+        std::size_t threads;
+        double nsPerOp;
+        double allocsPerOp;
+        double bytesPerSecond;
+        double opsPerSecond;
+    };
+
+    std::vector<Case> &registry();
+    std::atomic<std::uint64_t> &allocations();
+
+    struct Registrar
+    {
+        Registrar(const char *name, void (*body)(State &))
+        {
+            Bench::registry().push_back(Case{name, body});
+        }
+    };
+
+    /* keep the compiler from discarding a computed value */
+    template <typename T>
+    inline void doNotOptimize(const T &value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    inline void clobberMemory()
+    {
+        asm volatile("" : : : "memory");
+    }
+}
+
+#define BENCH_CONCAT_IMPL(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_IMPL(a, b)
+#define BENCH_CASE(name)                                                                                     \
+    static void BENCH_CONCAT(benchCase, __LINE__)(Bench::State & state);                                     \
+    static Bench::Registrar BENCH_CONCAT(benchRegistrar, __LINE__)(name, BENCH_CONCAT(benchCase, __LINE__)); \
+    static void BENCH_CONCAT(benchCase, __LINE__)(Bench::State & state)
+
+#endif
@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <unordered_map>
+#include "bench.hpp"
+#include "debug.hpp"
+
+static std::atomic<std::uint64_t> allocationCounter(0);
+
+void *operator new(std::size_t size)
+{
+    allocationCounter.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = std::malloc(size ? size : 1);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](std::size_t size)
+{
+    allocationCounter.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = std::malloc(size ? size : 1);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+std::vector<Bench::Case> &Bench::registry()
+{
+    static std::vector<Bench::Case> cases;
+    return cases;
+}
+
+std::atomic<std::uint64_t> &Bench::allocations()
+{
+    return allocationCounter;
+}
+
+class BenchOptions
+{
+private:
+    std::unordered_map<std::string, std::string> options;
+
+public:
+    BenchOptions(int argc, char *argv[])
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg(argv[i]);
+            if (arg == "--help")
+            {
+                std::cout << "Usage: " << argv[0] << " [options]\n\n"
+                                                     "Options:\n"
+                                                     "  --filter=<text>      Only run cases whose name contains text\n"
+                                                     "  --min-time-ms=<ms>   Minimum duration of one measurement\n"
+                                                     "                       Default: 200\n\n"
+                                                     "  --repetitions=<n>    Measurements per case, median is reported\n"
+                                                     "                       Default: 5\n\n"
+                                                     "  --json=<path>        Write results as JSON to path\n"
+                                                     "                       Default: bench.json\n\n"
+                                                     "  --list               List the registered cases and exit\n"
+                                                     "  --help               Show this help and exit\n";
+                std::exit(0);
+            }
+            if (arg.rfind("--", 0) == 0)
+            {
+                auto pos = arg.find('=');
+                if (pos != std::string::npos)
+                    this->options[arg.substr(2, pos - 2)] = arg.substr(pos + 1);
+                else
+                    this->options[arg.substr(2)] = "";
+            }
+        }
+    }
+
+    bool has(const std::string &key) const
+    {
+        return this->options.find(key) != this->options.end();
+    }
+
+    std::string getString(const std::string &key, const std::string &defaultValue) const
+    {
+        auto it = this->options.find(key);
+        return (it != this->options.end()) ? it->second : defaultValue;
+    }
+
+    std::size_t getSizeT(const std::string &key, std::size_t defaultValue) const
+    {
+        auto it = this->options.find(key);
+        if (it == this->options.end())
+            return defaultValue;
+        std::size_t value{};
+        std::istringstream iss(it->second);
+        iss >> value;
+        return iss.fail() ? defaultValue : value;
+    }
+};
+
+struct Sample
+{
+    double ns;
+    std::uint64_t allocs;
+};
+
+static Sample measure(const Bench::Case &benchCase, Bench::State &state)
+{
+    std::uint64_t allocs = Bench::allocations().load();
+    auto start = std::chrono::steady_clock::now();
+    benchCase.body(state);
+    auto end = std::chrono::steady_clock::now();
+    Sample sample;
+    sample.ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    sample.allocs = Bench::allocations().load() - allocs;
+    return sample;
+}
+
+static Bench::Result run(const Bench::Case &benchCase, double minTimeNs, std::size_t repetitions)
+{
+    /* grow the iteration count until one run is long enough to be stable */
+    std::size_t iterations = 1;
+    for (;;)
+    {
+        Bench::State state(iterations);
+        Sample sample = measure(benchCase, state);
+        if (sample.ns >= minTimeNs || iterations >= (static_cast<std::size_t>(1) << 30))
+            break;
+        double scale = sample.ns > 0 ? (minTimeNs * 1.2) / sample.ns : 10.0;
+        scale = std::min(std::max(scale, 2.0), 100.0);
+        iterations = static_cast<std::size_t>(static_cast<double>(iterations) * scale);
+    }
+
+    std::vector<Sample> samples;
+    Bench::State state(iterations);
+    for (std::size_t i = 0; i < repetitions; i++)
+    {
+        state = Bench::State(iterations);
+        samples.push_back(measure(benchCase, state));
+    }
+    std::sort(samples.begin(), samples.end(), [](const Sample &a, const Sample &b)
+              { return a.ns < b.ns; });
+    const Sample &median = samples[samples.size() / 2];
+
+    Bench::Result result;
+    result.name = benchCase.name;
+    result.iterations = iterations;
+    result.threads = state.threads;
+    result.nsPerOp = median.ns / static_cast<double>(iterations);
+    result.allocsPerOp = static_cast<double>(median.allocs) / static_cast<double>(iterations);
+    result.opsPerSecond = 1e9 / result.nsPerOp;
+    result.bytesPerSecond = static_cast<double>(state.bytesPerOp) * result.opsPerSecond;
+    return result;
+}
+
+static std::string escape(const std::string &value)
+{
+    std::string out;
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+static bool writeJson(const std::string &path, const std::vector<Bench::Result> &results)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+        return false;
+
+    file << "{\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        const Bench::Result &r = results[i];
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "    {\"name\": \"%s\", \"iterations\": %zu, \"threads\": %zu, \"ns_per_op\": %.3f, "
+                      "\"allocs_per_op\": %.3f, \"ops_per_second\": %.1f, \"bytes_per_second\": %.1f}%s\n",
+                      escape(r.name).c_str(), r.iterations, r.threads, r.nsPerOp,
+                      r.allocsPerOp, r.opsPerSecond, r.bytesPerSecond,
+                      (i + 1 < results.size()) ? "," : "");
+        file << line;
+    }
+    file << "  ]\n}\n";
+    return file.good();
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions opts(argc, argv);
+
+    const std::string filter = opts.getString("filter", "");
+    const double minTimeNs = static_cast<double>(opts.getSizeT("min-time-ms", 200)) * 1e6;
+    const std::size_t repetitions = std::max<std::size_t>(opts.getSizeT("repetitions", 5), 1);
+    const std::string jsonPath = opts.getString("json", "bench.json");
+
+    std::vector<Bench::Case> cases = Bench::registry();
+    std::sort(cases.begin(), cases.end(), [](const Bench::Case &a, const Bench::Case &b)
+              { return a.name < b.name; });
+
+    if (opts.has("list"))
+    {
+        for (const Bench::Case &benchCase : cases)
+        {
+            std::cout << benchCase.name << std::endl;
+        }
+        return 0;
+    }
+
+    /* library diagnostics (TXTLog rotation and friends) would flood the table */
+    Debug::clearSinks();
+
+    std::printf("%-40s %12s %10s %14s %12s\n", "benchmark", "ns/op", "allocs/op", "ops/s", "MB/s");
+    std::vector<Bench::Result> results;
+    for (const Bench::Case &benchCase : cases)
+    {
+        if (!filter.empty() && benchCase.name.find(filter) == std::string::npos)
+            continue;
+        Bench::Result r = run(benchCase, minTimeNs, repetitions);
+        std::printf("%-40s %12.1f %10.2f %14.0f %12.2f\n", r.name.c_str(), r.nsPerOp, r.allocsPerOp,
+                    r.opsPerSecond, r.bytesPerSecond / (1024.0 * 1024.0));
+        std::fflush(stdout);
+        results.push_back(r);
+    }
+
+    if (!writeJson(jsonPath, results))
+    {
+        std::cerr << "failed to write " << jsonPath << std::endl;
+        return 1;
+    }
+    std::cout << "results written to " << jsonPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,34 @@
+#include "bench.hpp"
+#include "binary-tree.hpp"
+
+namespace
+{
+    /* deterministic pseudo random keys keep the tree balanced enough */
+    int key(std::size_t i)
+    {
+        return static_cast<int>((i * 2654435761u) % 1000003u);
+    }
+}
+
+BENCH_CASE("binary-tree/insert")
+{
+    BinaryTree<int> tree;
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        tree.insert(key(i));
+    }
+}
+
+BENCH_CASE("binary-tree/contains-4k")
+{
+    BinaryTree<int> tree;
+    for (std::size_t i = 0; i < 4096; i++)
+    {
+        tree.insert(key(i));
+    }
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        bool found = tree.contains(key(i & 8191));
+        Bench::doNotOptimize(found);
+    }
+}
@@ -0,0 +1,113 @@
+#include <thread>
+#include "bench.hpp"
+#include "debug.hpp"
+#include "debug-sink.hpp"
+
+namespace
+{
+    /* main() already removed the stdout sink, only the history cache is fed */
+    struct DebugSetup
+    {
+        DebugSetup()
+        {
+            Debug::setMaxLinesLogCache(1024);
+            Debug::clearLogHistory();
+        }
+
+        ~DebugSetup()
+        {
+            Debug::clearLogHistory();
+        }
+    };
+
+    void contended(Bench::State &state, std::size_t threads)
+    {
+        DebugSetup setup;
+        state.setThreads(threads);
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&state, threads, t]()
+                                 {
+                                     for (std::size_t i = t; i < state.iterations; i += threads)
+                                     {
+                                         Debug::info(__FILE__, __LINE__, "bench", "worker %zu value %zu\n", t, i);
+                                     } });
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+}
+
+BENCH_CASE("debug/generate")
+{
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        std::string out = Debug::generate(Debug::INFO, __FILE__, __LINE__, "bench", "value %zu %s\n", i, "payload");
+        Bench::doNotOptimize(out);
+    }
+}
+
+BENCH_CASE("debug/log")
+{
+    DebugSetup setup;
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        Debug::info(__FILE__, __LINE__, "bench", "value %zu %s\n", i, "payload");
+    }
+}
+
+BENCH_CASE("debug/log-filtered")
+{
+    DebugSetup setup;
+    Debug::setLogLevel(Debug::ERROR);
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        Debug::info(__FILE__, __LINE__, "bench", "value %zu %s\n", i, "payload");
+    }
+    Debug::setLogLevel(Debug::INFO);
+}
+
+BENCH_CASE("debug/log-deferred")
+{
+    DebugSetup setup;
+    /* arguments are only captured while the async writer renders */
+    Debug::startAsync();
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        Debug::logDeferred(Debug::INFO, __FILE__, __LINE__, "bench", "value %zu %d\n", i, 7);
+    }
+    Debug::flush();
+    Debug::stopAsync();
+}
+
+BENCH_CASE("debug/log-async")
+{
+    DebugSetup setup;
+    Debug::startAsync();
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        DEBUG_INFO("value %zu %d\n", i, 7);
+    }
+    Debug::flush();
+    Debug::stopAsync();
+}
+
+BENCH_CASE("debug/log-contended-4")
+{
+    contended(state, 4);
+}
+
+BENCH_CASE("debug/log-null-sink")
+{
+    DebugSetup setup;
+    std::shared_ptr<DebugSink> sink = std::make_shared<NullSink>();
+    Debug::addSink(sink);
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        Debug::info(__FILE__, __LINE__, "bench", "value %zu %s\n", i, "payload");
+    }
+    Debug::removeSink(sink);
+}
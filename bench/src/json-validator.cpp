@@ -0,0 +1,50 @@
+#include "bench.hpp"
+#include "json-validator.hpp"
+#include "nlohmann/json.hpp"
+
+namespace
+{
+    const nlohmann::json document = nlohmann::json::parse(R"({
+        "name": "utils",
+        "port": 8080,
+        "ratio": 0.75,
+        "enabled": true,
+        "server": {"host": "localhost", "timeout": 30}
+    })");
+}
+
+BENCH_CASE("json-validator/get")
+{
+    JSONValidator validator(__FILE__, __LINE__, __func__);
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        unsigned int port = validator.get<unsigned int>(document, "port");
+        std::string name = validator.get<std::string>(document, "name");
+        Bench::doNotOptimize(port);
+        Bench::doNotOptimize(name);
+    }
+}
+
+BENCH_CASE("json-validator/validate-nested")
+{
+    JSONValidator validator(__FILE__, __LINE__, __func__);
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        unsigned int timeout = 0;
+        validator.object(document, "server").onValid([&](const nlohmann::json &server)
+                                                     { timeout = validator.get<unsigned int>(server, "timeout", "server"); });
+        Bench::doNotOptimize(timeout);
+    }
+}
+
+BENCH_CASE("json-validator/missing-field")
+{
+    JSONValidator validator(__FILE__, __LINE__, __func__);
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        bool missing = false;
+        validator.validate<int>(document, "absent").onNotFound([&](const nlohmann::json &, const std::string &)
+                                                               { missing = true; });
+        Bench::doNotOptimize(missing);
+    }
+}
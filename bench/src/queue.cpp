@@ -0,0 +1,31 @@
+#include "bench.hpp"
+#include "queue.hpp"
+
+BENCH_CASE("queue/enqueue-dequeue")
+{
+    Queue<int> queue;
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        queue.enqueue(static_cast<int>(i));
+        int value = queue.dequeue();
+        Bench::doNotOptimize(value);
+    }
+}
+
+BENCH_CASE("queue/iteration-1k")
+{
+    Queue<int> queue;
+    for (int i = 0; i < 1024; i++)
+    {
+        queue.enqueue(i);
+    }
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        long sum = 0;
+        queue.iteration([&sum](int &value)
+                        {
+                            sum += value;
+                            return true; });
+        Bench::doNotOptimize(sum);
+    }
+}
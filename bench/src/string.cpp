@@ -0,0 +1,81 @@
+#include "bench.hpp"
+#include "string.hpp"
+
+namespace
+{
+    std::string sample(std::size_t size)
+    {
+        std::string out;
+        for (std::size_t i = 0; i < size; i++)
+        {
+            out += static_cast<char>('a' + (i % 26));
+        }
+        return out;
+    }
+}
+
+BENCH_CASE("string/toHexString")
+{
+    const std::string input = sample(256);
+    state.setBytesPerOp(input.size());
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        std::string out = StringUtils::toHexString(input);
+        Bench::doNotOptimize(out);
+    }
+}
+
+BENCH_CASE("string/fromHexString")
+{
+    const std::string input = StringUtils::toHexString(sample(256));
+    state.setBytesPerOp(input.size());
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        std::string out = StringUtils::fromHexString(input);
+        Bench::doNotOptimize(out);
+    }
+}
+
+BENCH_CASE("string/toHexBin")
+{
+    const std::string input = StringUtils::toHexString(sample(256));
+    state.setBytesPerOp(input.size());
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        std::vector<unsigned char> out = StringUtils::toHexBin(input);
+        Bench::doNotOptimize(out);
+    }
+}
+
+BENCH_CASE("string/split")
+{
+    const std::string input = "alpha,beta,gamma,delta,epsilon,zeta,eta,theta,iota,kappa,lambda,mu";
+    state.setBytesPerOp(input.size());
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        std::vector<std::string> out = StringUtils::split(input, ',');
+        Bench::doNotOptimize(out);
+    }
+}
+
+BENCH_CASE("string/replaceAll")
+{
+    const std::string input = "the cat sat on the mat with the other cat near the door of the house";
+    state.setBytesPerOp(input.size());
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        std::string out = input;
+        StringUtils::replaceAll(out, "the", "a");
+        Bench::doNotOptimize(out);
+    }
+}
+
+BENCH_CASE("string/replacePlaceholder")
+{
+    const std::map<std::string, std::string> values = {{"name", "utils"}, {"version", "1.1.0"}, {"user", "bench"}};
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        std::string out = StringUtils::replacePlaceholder("hello {user}, {name} is at {version}", values);
+        Bench::doNotOptimize(out);
+    }
+}
@@ -0,0 +1,33 @@
+#include "bench.hpp"
+#include "time.hpp"
+
+BENCH_CASE("time/format")
+{
+    std::tm now;
+    TimeUtils::nowLocal(&now);
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        std::string out = TimeUtils::format(&now, TimeUtils::TIME_FORMAT_ISO_DATETIME);
+        Bench::doNotOptimize(out);
+    }
+}
+
+BENCH_CASE("time/parse")
+{
+    std::tm result;
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        bool ok = TimeUtils::parse(&result, "2025-09-28 14:45:12", TimeUtils::TIME_FORMAT_ISO_DATETIME);
+        Bench::doNotOptimize(ok);
+    }
+}
+
+BENCH_CASE("time/nowLocal")
+{
+    std::tm now;
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        TimeUtils::nowLocal(&now);
+        Bench::clobberMemory();
+    }
+}
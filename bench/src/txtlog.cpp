@@ -0,0 +1,188 @@
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+#include "txtlog.hpp"
+#include "txtlog-codec.hpp"
+
+namespace
+{
+    const std::string line = "[260101_120000.000] [I]: bench.cpp:42 → bench: the quick brown fox jumps over the lazy dog\n";
+    const std::string criticalLine = "[260101_120000.000] [C]: bench.cpp:42 → bench: the quick brown fox jumps over the lazy dog\n";
+
+    /* every run starts from an empty directory so earlier runs do not trigger rotations */
+    void resetDirectory()
+    {
+        ::mkdir("./bench-log", 0755);
+        DIR *dir = ::opendir("./bench-log");
+        if (!dir)
+            return;
+        struct dirent *entry;
+        while ((entry = ::readdir(dir)) != nullptr)
+        {
+            std::string name(entry->d_name);
+            if (name != "." && name != "..")
+                ::unlink(("./bench-log/" + name).c_str());
+        }
+        ::closedir(dir);
+    }
+
+    /* one record in a hundred is critical, the rest are info */
+    void durable(Bench::State &state, TXTLog::DurabilityPolicy policy, std::size_t value)
+    {
+        resetDirectory();
+        TXTLog log("./bench-log", "durable", 64 * 1024 * 1024, 1, 1);
+        log.setDurability(policy, value);
+        state.setBytesPerOp(line.size());
+        for (std::size_t i = 0; i < state.iterations; i++)
+        {
+            log.write((i % 100 == 99) ? criticalLine : line);
+        }
+    }
+
+    void contended(Bench::State &state, std::size_t threads, void (*configure)(TXTLog &))
+    {
+        resetDirectory();
+        TXTLog log("./bench-log", "contended", 64 * 1024 * 1024, 1, 1);
+        configure(log);
+        state.setBytesPerOp(line.size());
+        state.setThreads(threads);
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&state, &log, threads, t]()
+                                 {
+                                     for (std::size_t i = t; i < state.iterations; i += threads)
+                                     {
+                                         log.write(line);
+                                     } });
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+}
+
+BENCH_CASE("txtlog/write")
+{
+    resetDirectory();
+    TXTLog log("./bench-log", "write", 64 * 1024 * 1024, 1, 1);
+    state.setBytesPerOp(line.size());
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        log.write(line);
+    }
+}
+
+BENCH_CASE("txtlog/write-size-or-hourly")
+{
+    /* same as txtlog/write plus the deadline check */
+    resetDirectory();
+    TXTLog log("./bench-log", "hourly", 64 * 1024 * 1024, 1, 1);
+    log.setRotationPolicy(TXTLog::ROTATE_SIZE_OR_HOURLY);
+    state.setBytesPerOp(line.size());
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        log.write(line);
+    }
+}
+
+BENCH_CASE("txtlog/write-io-uring")
+{
+    resetDirectory();
+    TXTLog log("./bench-log", "uring", 64 * 1024 * 1024, 1, 1);
+    log.setIoUring(true);
+    state.setBytesPerOp(line.size());
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        log.write(line);
+    }
+}
+
+BENCH_CASE("txtlog/write-mapped")
+{
+    resetDirectory();
+    TXTLog log("./bench-log", "mapped", 64 * 1024 * 1024, 1, 1);
+    log.setMappedFile(true);
+    state.setBytesPerOp(line.size());
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        log.write(line);
+    }
+}
+
+BENCH_CASE("txtlog/write-buffered")
+{
+    resetDirectory();
+    TXTLog log("./bench-log", "buffered", 64 * 1024 * 1024, 1, 1, 64 * 1024);
+    state.setBytesPerOp(line.size());
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        log.write(line);
+    }
+}
+
+BENCH_CASE("txtlog/write-compressed")
+{
+    resetDirectory();
+    TXTLog log("./bench-log", "compressed", 64 * 1024 * 1024, 1, 1, 256 * 1024);
+    log.setCodec(std::make_shared<XzCodec>(0));
+    log.setCompressedStreaming(true);
+    state.setBytesPerOp(line.size());
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        log.write(line);
+    }
+}
+
+BENCH_CASE("txtlog/write-rotation")
+{
+    /* small files so the measurement includes backup and xz archiving */
+    resetDirectory();
+    TXTLog log("./bench-log", "rotate", 256 * 1024, 2, 3);
+    state.setBytesPerOp(line.size());
+    for (std::size_t i = 0; i < state.iterations; i++)
+    {
+        log.write(line);
+    }
+}
+
+BENCH_CASE("txtlog/write-contended-32")
+{
+    contended(state, 32, [](TXTLog &) {});
+}
+
+BENCH_CASE("txtlog/write-group-commit-32")
+{
+    contended(state, 32, [](TXTLog &log)
+              { log.setGroupCommit(true); });
+}
+
+BENCH_CASE("txtlog/write-mapped-32")
+{
+    contended(state, 32, [](TXTLog &log)
+              { log.setMappedFile(true); });
+}
+
+BENCH_CASE("txtlog/durability-none")
+{
+    durable(state, TXTLog::DURABILITY_NONE, 0);
+}
+
+BENCH_CASE("txtlog/durability-interval-100ms")
+{
+    durable(state, TXTLog::DURABILITY_INTERVAL, 100);
+}
+
+BENCH_CASE("txtlog/durability-bytes-1mb")
+{
+    durable(state, TXTLog::DURABILITY_BYTES, 1024 * 1024);
+}
+
+BENCH_CASE("txtlog/durability-critical")
+{
+    durable(state, TXTLog::DURABILITY_CRITICAL, 0);
+}
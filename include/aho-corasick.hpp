@@ -0,0 +1,48 @@
+#ifndef __AHO_CORASICK_HPP__
+#define __AHO_CORASICK_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <functional>
+
+/**
+ * Multi-pattern matcher compiled into a deterministic automaton.
+ *
+ * Patterns are collected with add() and compiled with build(). The
+ * automaton uses a compressed alphabet (only bytes that occur in some
+ * pattern get their own column), so a scan is one table lookup per input
+ * byte regardless of how many patterns are registered.
+ */
+class AhoCorasick
+{
+private:
+    std::vector<std::string> patterns;
+    std::array<uint16_t, 256> byteClass;
+    std::size_t classes;
+    std::vector<int32_t> transitions;
+    std::vector<uint32_t> matchLength;
+
+public:
+    AhoCorasick();
+    ~AhoCorasick();
+
+    void add(const std::string &pattern);
+    void clear();
+    void build();
+
+    bool isEmpty() const;
+
+    /**
+     * @brief Scan the input once and report every match.
+     *
+     * For each position where at least one pattern ends, the callback
+     * receives the start offset and length of the longest such pattern.
+     * Shorter patterns ending at the same position are covered by it.
+     */
+    void scan(const char *data, std::size_t size, const std::function<void(std::size_t, std::size_t)> &callback) const;
+};
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef __BYTE_RING_HPP__
+#define __BYTE_RING_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <functional>
+
+/**
+ * Fixed-size contiguous ring of length-prefixed byte records.
+ *
+ * Layout of a record: [uint32_t length][payload][\0] padded to 4 bytes.
+ * Records never straddle the end of the buffer; when a record does not
+ * fit in the tail space the writer wraps to offset 0 and remembers where
+ * the valid data ended. Oldest records are evicted to make room, so a
+ * steady-state push performs no allocation and iteration is a sequential
+ * scan. Payloads are NUL terminated and can be handed out as C strings.
+ * A record larger than the whole ring keeps its beginning, and its line
+ * break if it ended with one.
+ */
+class ByteRing
+{
+private:
+    std::vector<char> buffer;
+    size_t head;
+    size_t tail;
+    size_t wrapAt;
+    size_t count;
+    size_t payload;
+    size_t maxRecords;
+
+    static const size_t HEADER_SIZE = sizeof(uint32_t);
+
+    static size_t footprint(size_t length)
+    {
+        return (HEADER_SIZE + length + 1 + 3) & ~static_cast<size_t>(3);
+    }
+
+    uint32_t lengthAt(size_t offset) const
+    {
+        uint32_t length;
+        std::memcpy(&length, buffer.data() + offset, HEADER_SIZE);
+        return length;
+    }
+
+    bool isWrapped() const
+    {
+        return count > 0 && tail <= head;
+    }
+
+    void place(size_t offset, const char *data, size_t length, bool newline = false)
+    {
+        uint32_t len = static_cast<uint32_t>(length);
+        std::memcpy(buffer.data() + offset, &len, HEADER_SIZE);
+        std::memcpy(buffer.data() + offset + HEADER_SIZE, data, length);
+        if (newline)
+            buffer[offset + HEADER_SIZE + length - 1] = '\n';
+        buffer[offset + HEADER_SIZE + length] = '\0';
+        tail = offset + footprint(length);
+        payload += length;
+        count++;
+    }
+
+public:
+    explicit ByteRing(size_t capacity = 0, size_t maxRecords = 0) : buffer(),
+                                                                    head(0),
+                                                                    tail(0),
+                                                                    wrapAt(0),
+                                                                    count(0),
+                                                                    payload(0),
+                                                                    maxRecords(maxRecords)
+    {
+        buffer.resize(capacity & ~static_cast<size_t>(3));
+    }
+
+    /* change the byte capacity, the newest records that still fit are kept */
+    void setCapacity(size_t capacity)
+    {
+        capacity &= ~static_cast<size_t>(3);
+        if (capacity == buffer.size())
+            return;
+
+        ByteRing resized(capacity, maxRecords);
+        iteration([&](const char *data, size_t length)
+                  {
+                      resized.push(data, length);
+                      return true; });
+        *this = std::move(resized);
+    }
+
+    /* limit the number of records, 0 means bounded by bytes only */
+    void setMaxRecords(size_t max)
+    {
+        maxRecords = max;
+        while (maxRecords && count > maxRecords)
+        {
+            pop();
+        }
+    }
+
+    void push(const char *data, size_t length)
+    {
+        if (buffer.size() <= HEADER_SIZE + 4)
+            return;
+
+        bool newline = false;
+        if (footprint(length) > buffer.size())
+        {
+            /* keep the start of an oversized record, that is where a log line has its header */
+            newline = data[length - 1] == '\n';
+            length = buffer.size() - HEADER_SIZE - 4;
+        }
+        size_t total = footprint(length);
+
+        while (maxRecords && count >= maxRecords)
+        {
+            pop();
+        }
+
+        for (;;)
+        {
+            if (count == 0)
+            {
+                head = tail = wrapAt = 0;
+                place(0, data, length, newline);
+                return;
+            }
+            if (!isWrapped())
+            {
+                if (buffer.size() - tail >= total)
+                {
+                    place(tail, data, length, newline);
+                    return;
+                }
+                if (head >= total)
+                {
+                    wrapAt = tail;
+                    place(0, data, length, newline);
+                    return;
+                }
+            }
+            else if (head - tail >= total)
+            {
+                place(tail, data, length, newline);
+                return;
+            }
+            pop();
+        }
+    }
+
+    void pop()
+    {
+        if (count == 0)
+            return;
+
+        uint32_t length = lengthAt(head);
+        bool wrapped = isWrapped();
+        head += footprint(length);
+        payload -= length;
+        count--;
+        if (count == 0)
+        {
+            head = tail = wrapAt = 0;
+        }
+        else if (wrapped && head >= wrapAt)
+        {
+            head = 0;
+        }
+    }
+
+    void clear()
+    {
+        head = tail = wrapAt = 0;
+        count = 0;
+        payload = 0;
+    }
+
+    /* visit records from oldest to newest, stop when callback returns false */
+    void iteration(const std::function<bool(const char *, size_t)> &callback) const
+    {
+        size_t offset = head;
+        bool wrapped = isWrapped();
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (wrapped && offset >= wrapAt)
+            {
+                offset = 0;
+                wrapped = false;
+            }
+            uint32_t length = lengthAt(offset);
+            if (callback(buffer.data() + offset + HEADER_SIZE, length) == false)
+                return;
+            offset += footprint(length);
+        }
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    /* payload bytes currently stored, without headers and padding */
+    size_t bytes() const
+    {
+        return payload;
+    }
+
+    size_t capacity() const
+    {
+        return buffer.size();
+    }
+
+    bool isEmpty() const
+    {
+        return count == 0;
+    }
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * $Id: debug-sink.hpp, v 1.0.0 2026/10/16 10:00:00 Jaya Wikrama Exp $
+ *
+ * Copyright (c) 2024 Jaya Wikrama
+ * jayawikrama89@gmail.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *  claim that you wrote the original software. If you use this software
+ *  in a product, an acknowledgment in the product documentation would be
+ *  appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *  misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+/**
+ * @file
+ * @brief Output destinations for Debug records.
+ *
+ * Every record is formatted once and the same payload is handed to each
+ * registered sink whose level filter accepts it. A stdout sink is
+ * registered by default, see Debug::addSink() and Debug::clearSinks().
+ *
+ * @version 1.0.0
+ * @date 2026-10-16
+ * @author Jaya Wikrama
+ */
+
+#ifndef __DEBUG_SINK_HPP__
+#define __DEBUG_SINK_HPP__
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include "debug.hpp"
+#include "byte-ring.hpp"
+
+class TXTLog;
+
+class DebugSink
+{
+private:
+    std::atomic<int> level;
+
+public:
+    DebugSink();
+    virtual ~DebugSink();
+
+    void setLevel(Debug::LogType_t level);
+    Debug::LogType_t getLevel() const;
+    bool accepts(Debug::LogType_t type) const
+    {
+        return static_cast<int>(type) >= this->level.load(std::memory_order_relaxed);
+    }
+
+    virtual void write(Debug::LogType_t type, const std::string &payload) = 0;
+    virtual void flush();
+};
+
+class StdoutSink : public DebugSink
+{
+public:
+    StdoutSink();
+    ~StdoutSink();
+
+    void write(Debug::LogType_t type, const std::string &payload) override;
+    void flush() override;
+};
+
+class NullSink : public DebugSink
+{
+public:
+    NullSink();
+    ~NullSink();
+
+    void write(Debug::LogType_t type, const std::string &payload) override;
+};
+
+/* writes into its own TXTLog, whose size/age bounded buffer is drained by its worker */
+class FileSink : public DebugSink
+{
+private:
+    std::unique_ptr<TXTLog> txtlog;
+
+    static thread_local bool writing;
+
+public:
+    FileSink(const std::string &workingDirectory = ".",
+             const std::string &baseFileName = "log",
+             std::size_t maxFileSize = 20971520,
+             std::size_t maxTxtBackups = 3,
+             std::size_t maxArchiveFiles = 10,
+             std::size_t bufferSize = 65536,
+             long maxBufferAgeMs = 1000);
+    ~FileSink();
+
+    void write(Debug::LogType_t type, const std::string &payload) override;
+    void flush() override;
+};
+
+/* keeps the newest records in a preallocated byte ring */
+class MemorySink : public DebugSink
+{
+private:
+    mutable std::mutex mutex;
+    ByteRing ring;
+
+public:
+    explicit MemorySink(std::size_t capacity = 65536, std::size_t maxRecords = 0);
+    ~MemorySink();
+
+    void write(Debug::LogType_t type, const std::string &payload) override;
+
+    std::string getContent() const;
+    void iteration(const std::function<bool(const char *, std::size_t)> &callback) const;
+    std::size_t size() const;
+    void clear();
+};
+
+/* sends each record as one datagram to a Unix-domain socket, never blocks */
+class UnixDatagramSink : public DebugSink
+{
+private:
+    int socketDescriptor;
+    std::string socketPath;
+    std::atomic<std::size_t> dropped;
+
+public:
+    explicit UnixDatagramSink(const std::string &socketPath);
+    ~UnixDatagramSink();
+
+    bool isOpen() const;
+    std::size_t getDropped() const;
+
+    void write(Debug::LogType_t type, const std::string &payload) override;
+};
+
+#endif
@@ -41,20 +41,190 @@
 #include <mutex>
 #include <functional>
 #include <cstdarg>
-#include <deque>
 #include <memory>
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include "byte-ring.hpp"
+#include "aho-corasick.hpp"
 
 class TXTLog;
+class DebugSink;
+
+namespace DebugDetail
+{
+    /*
+     * Raw argument codec for deferred records. Scalars and pointers are
+     * copied by value, C strings are copied with their terminator so the
+     * caller buffer may be gone by the time the record is formatted.
+     */
+    template <typename T>
+    struct DeferredArg
+    {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value ||
+                          std::is_same<T, std::nullptr_t>::value,
+                      "deferred log arguments must be printf compatible scalars, pointers or C strings");
+
+        typedef T Decoded;
+
+        static std::size_t size(const T &)
+        {
+            return sizeof(T);
+        }
+
+        static unsigned char *encode(unsigned char *out, const T &value)
+        {
+            std::memcpy(out, &value, sizeof(T));
+            return out + sizeof(T);
+        }
+
+        static const unsigned char *decode(const unsigned char *in, Decoded &value)
+        {
+            std::memcpy(&value, in, sizeof(T));
+            return in + sizeof(T);
+        }
+    };
+
+    struct DeferredString
+    {
+        typedef const char *Decoded;
+
+        static std::size_t size(const char *value)
+        {
+            return (value ? std::strlen(value) : 6) + 1;
+        }
+
+        static unsigned char *encode(unsigned char *out, const char *value)
+        {
+            std::size_t sz = DeferredString::size(value);
+            std::memcpy(out, value ? value : "(null)", sz);
+            return out + sz;
+        }
+
+        static const unsigned char *decode(const unsigned char *in, Decoded &value)
+        {
+            value = reinterpret_cast<const char *>(in);
+            return in + std::strlen(value) + 1;
+        }
+    };
+
+    template <>
+    struct DeferredArg<const char *> : DeferredString
+    {
+    };
+
+    template <>
+    struct DeferredArg<char *> : DeferredString
+    {
+    };
+
+    inline std::size_t deferredSize()
+    {
+        return 0;
+    }
+
+    template <typename T, typename... Rest>
+    std::size_t deferredSize(const T &value, const Rest &...rest)
+    {
+        return DeferredArg<typename std::decay<T>::type>::size(value) + deferredSize(rest...);
+    }
+
+    inline unsigned char *deferredEncode(unsigned char *out)
+    {
+        return out;
+    }
+
+    template <typename T, typename... Rest>
+    unsigned char *deferredEncode(unsigned char *out, const T &value, const Rest &...rest)
+    {
+        out = DeferredArg<typename std::decay<T>::type>::encode(out, value);
+        return deferredEncode(out, rest...);
+    }
+
+    template <typename... Pending>
+    struct DeferredFormatter;
+
+    template <>
+    struct DeferredFormatter<>
+    {
+        template <typename... Values>
+        static int apply(char *buffer, std::size_t size, const char *format, const unsigned char *, Values... values)
+        {
+            return std::snprintf(buffer, size, format, values...);
+        }
+    };
+
+    template <typename T, typename... Rest>
+    struct DeferredFormatter<T, Rest...>
+    {
+        template <typename... Values>
+        static int apply(char *buffer, std::size_t size, const char *format, const unsigned char *in, Values... values)
+        {
+            typename DeferredArg<T>::Decoded value;
+            in = DeferredArg<T>::decode(in, value);
+            return DeferredFormatter<Rest...>::apply(buffer, size, format, in, values..., value);
+        }
+    };
+
+    template <typename... Args>
+    int deferredFormat(char *buffer, std::size_t size, const char *format, const unsigned char *args)
+    {
+        return DeferredFormatter<Args...>::apply(buffer, size, format, args);
+    }
+}
 
 class Debug
 {
 private:
+    class AsyncWriter;
+    class StreamRegistry;
+    class RateLimiter;
+
+    struct Record
+    {
+        typedef int (*Formatter)(char *buffer, std::size_t size, const char *format, const unsigned char *args);
+
+        /* rendered payload, filled lazily for deferred records */
+        std::string text;
+        Formatter formatter;
+        int type;
+        const char *sourceName;
+        int line;
+        const char *functionName;
+        const char *format;
+        std::chrono::system_clock::time_point timestamp;
+        std::array<unsigned char, 192> args;
+
+        Record() : text(), formatter(nullptr), type(0), sourceName(nullptr), line(0), functionName(nullptr), format(nullptr), timestamp(), args() {}
+        Record(int type, std::string &&payload) : text(std::move(payload)), formatter(nullptr), type(type), sourceName(nullptr), line(0), functionName(nullptr), format(nullptr), timestamp(), args() {}
+    };
+
     std::vector<std::string> confidential;
+    AhoCorasick confidentialMatcher;
+    std::atomic<int> level;
 
+    static std::atomic<int> minLevel;
     static std::size_t maxLineLogs;
-    static std::deque<std::string> history;
-    static std::unique_ptr<TXTLog> txtlog;
+    static std::size_t maxCacheBytes;
+    static ByteRing history;
+    static std::shared_ptr<TXTLog> txtlog; /* read with std::atomic_load, replaced by setupTXTLogFile() */
     static std::mutex mutex;
+    static std::atomic<AsyncWriter *> asyncWriter;
+    static std::atomic<std::size_t> asyncProducers;
+    static std::unique_ptr<AsyncWriter> asyncOwner;
+    static std::atomic<bool> streaming;
+    static std::atomic<std::size_t> streamBatchSize;
+    static std::atomic<long> streamBatchAge;
+    static std::unique_ptr<StreamRegistry> streamRegistry;
+    static thread_local bool streamFlushing;
+    static std::mutex sinkMutex;
+    static std::shared_ptr<const std::vector<std::shared_ptr<DebugSink>>> sinks;
+    static std::atomic<std::size_t> rateBurst;
+    static std::atomic<long> rateInterval;
+    static RateLimiter rateLimiter;
 
 public:
     enum LogType_t
@@ -66,6 +236,8 @@ public:
     };
 
     Debug();
+    Debug(const Debug &other);
+    Debug &operator=(const Debug &other);
     ~Debug();
 
     void log(LogType_t type, const char *functionName, const char *format, ...);
@@ -73,11 +245,42 @@ public:
     void warning(const char *functionName, const char *format, ...);
     void error(const char *functionName, const char *format, ...);
     void critical(const char *functionName, const char *format, ...);
+    /*
+     * Per-logger entry point carrying the call site, used by the
+     * DEBUG_LOGGER_* macros: honours this logger's level and confidential
+     * masking and stamps the record with file:line like the static log().
+     */
+    void logAt(LogType_t type, const char *sourceName, int line, const char *functionName, const char *format, ...);
 
     void setConfidential(const std::string &confidential);
 
+    /*
+     * Level thresholds. Records below the global or the per-logger minimum
+     * level are dropped before any formatting; the check is a single relaxed
+     * atomic load so it is cheap enough to guard every call site.
+     */
+    void setLevel(LogType_t level);
+    LogType_t getLevel() const;
+    bool isLoggable(LogType_t type) const
+    {
+        return static_cast<int>(type) >= this->level.load(std::memory_order_relaxed) && Debug::isEnabled(type);
+    }
+
+    static void setLogLevel(LogType_t level);
+    static LogType_t getLogLevel();
+    static bool isEnabled(LogType_t type)
+    {
+        return static_cast<int>(type) >= Debug::minLevel.load(std::memory_order_relaxed);
+    }
+
     static void cache(const std::string &payload);
     static void setMaxLinesLogCache(std::size_t max);
+    /*
+     * The history lives in one preallocated byte ring. Its size defaults to
+     * 512 bytes per cached line; lines are evicted when either the line
+     * limit or the byte budget is reached. 0 restores the default.
+     */
+    static void setLogCacheSize(std::size_t bytes);
     static void clearLogHistory();
     static std::string getLogHistory();
     static void historyIteration(const std::function<bool(const char *)> &callback);
@@ -109,7 +312,122 @@ public:
 
     static void moveLogHistoryToFile();
 
+    /*
+     * Continuous file logging. Every published record is appended to a
+     * per-thread batch which is handed to TXTLog::write once it reaches
+     * batchSize bytes or becomes older than maxBatchAgeMs. A timer thread,
+     * started with the first batch, writes batches that age out while their
+     * thread stays quiet; flush() and thread exit write them right away.
+     * Streamed lines are not kept in the log history; moveLogHistoryToFile()
+     * writes the lines cached before streaming started.
+     */
+    static void setTXTLogStreaming(bool enable, std::size_t batchSize = 65536, long maxBatchAgeMs = 1000);
+    static bool isTXTLogStreaming();
+
+    /*
+     * Deferred logging entry point. Only the call-site pointers, the
+     * timestamp and a raw copy of the arguments are captured on the calling
+     * thread; the text is rendered by the asynchronous writer (or right away
+     * when async mode is off). format, sourceName and functionName must have
+     * static storage duration, e.g. string literals, __FILE__ and __func__.
+     */
+    template <typename... Args>
+    static void logDeferred(LogType_t type,
+                            const char *sourceName,
+                            int line,
+                            const char *functionName,
+                            const char *format,
+                            const Args &...args)
+    {
+        if (!Debug::isEnabled(type) || !Debug::admit(type, sourceName ? sourceName : format, line, sourceName, functionName))
+            return;
+
+        if (!Debug::isAsync())
+        {
+            Debug::dispatch(type, Debug::generate(type, sourceName, line, functionName, format, args...));
+            return;
+        }
+        std::size_t argsSize = DebugDetail::deferredSize(args...);
+
+        Record record;
+        record.timestamp = std::chrono::system_clock::now();
+        record.type = type;
+        record.sourceName = sourceName;
+        record.line = line;
+        record.functionName = functionName;
+        record.format = format;
+        if (argsSize <= record.args.size())
+        {
+            DebugDetail::deferredEncode(record.args.data(), args...);
+            record.formatter = &DebugDetail::deferredFormat<typename std::decay<Args>::type...>;
+        }
+        else
+        {
+            /* too large for the inline arena, format right away */
+            record.text = Debug::generate(type, sourceName, line, functionName, format, args...);
+        }
+        Debug::dispatch(std::move(record));
+    }
+
+    /*
+     * Opt-in asynchronous mode. Log calls only enqueue the generated record
+     * into a bounded lock-free queue, a background writer thread drains it
+     * to stdout and the history cache. When the queue is full, producers
+     * wait for free space instead of dropping records.
+     */
+    static bool startAsync(std::size_t queueCapacity = 8192);
+    static void stopAsync();
+    static bool isAsync();
+    static void flush();
+
+    /*
+     * Output sinks (see debug-sink.hpp). Each record is formatted once and
+     * handed to every sink whose level accepts it; the history cache and
+     * the TXTLog stream are fed independently of the sink list. A stdout
+     * sink is registered by default, resetSinks() restores that state.
+     */
+    static void addSink(const std::shared_ptr<DebugSink> &sink);
+    static void removeSink(const std::shared_ptr<DebugSink> &sink);
+    static void clearSinks();
+    static void resetSinks();
+    static std::size_t getSinksNumber();
+
+    /*
+     * Per call-site rate limiting. Each call site (source file and line, or
+     * the format string for logger instances) gets a token bucket of burst
+     * records refilled every intervalMs. Records over the limit are counted
+     * and reported as a single "last message repeated N times" line once
+     * the bucket refills, by flush(), or by a sweep other records trigger
+     * at most once per interval when the site has gone quiet. burst = 0
+     * disables the limiter.
+     */
+    static void setRateLimit(std::size_t burst, long intervalMs = 1000);
+
 protected:
+    static bool admit(LogType_t type, const void *site, int line, const char *sourceName, const char *functionName)
+    {
+        return Debug::rateBurst.load(std::memory_order_relaxed) == 0 ||
+               Debug::admitSlow(type, site, line, sourceName, functionName);
+    }
+    static bool admitSlow(LogType_t type, const void *site, int line, const char *sourceName, const char *functionName);
+    static void reportSuppressed(bool onlyExpired);
+
+    static void dispatch(LogType_t type, std::string &&payload);
+    static void dispatch(Record &&record);
+    static void render(Record &record);
+    static void publish(LogType_t type, const std::string &payload);
+    static void flushSinks();
+    static bool stream(const std::string &payload);
+    static void flushStream(bool onlyExpired);
+    static void formatTimestamp(char *buffer, const std::chrono::system_clock::time_point &timestamp);
+    static std::size_t generateHeader(char *buffer,
+                                      std::size_t size,
+                                      LogType_t type,
+                                      const char *sourceName,
+                                      int line,
+                                      const char *functionName,
+                                      const std::chrono::system_clock::time_point &timestamp);
+
     std::string hideConfidential(const std::string &input) const;
 
     size_t getMaxLineLogs();
@@ -122,4 +440,37 @@ protected:
     static const char *extractFileName(const char *fileName);
 };
 
+/*
+ * Compile-time floor: call sites below DEBUG_COMPILE_LEVEL are folded away
+ * entirely, e.g. build with -DDEBUG_COMPILE_LEVEL=1 to drop every INFO
+ * statement from release binaries. Values follow Debug::LogType_t.
+ */
+#ifndef DEBUG_COMPILE_LEVEL
+#define DEBUG_COMPILE_LEVEL 0
+#endif
+
+#define DEBUG_LOG(type, ...)                                                         \
+    do                                                                               \
+    {                                                                                \
+        if (static_cast<int>(type) >= DEBUG_COMPILE_LEVEL && Debug::isEnabled(type)) \
+            Debug::log(type, __FILE__, __LINE__, __func__, __VA_ARGS__);             \
+    } while (0)
+
+#define DEBUG_INFO(...) DEBUG_LOG(Debug::INFO, __VA_ARGS__)
+#define DEBUG_WARNING(...) DEBUG_LOG(Debug::WARNING, __VA_ARGS__)
+#define DEBUG_ERROR(...) DEBUG_LOG(Debug::ERROR, __VA_ARGS__)
+#define DEBUG_CRITICAL(...) DEBUG_LOG(Debug::CRITICAL, __VA_ARGS__)
+
+#define DEBUG_LOGGER_LOG(logger, type, ...)                                             \
+    do                                                                                  \
+    {                                                                                   \
+        if (static_cast<int>(type) >= DEBUG_COMPILE_LEVEL && (logger).isLoggable(type)) \
+            (logger).logAt(type, __FILE__, __LINE__, __func__, __VA_ARGS__);            \
+    } while (0)
+
+#define DEBUG_LOGGER_INFO(logger, ...) DEBUG_LOGGER_LOG(logger, Debug::INFO, __VA_ARGS__)
+#define DEBUG_LOGGER_WARNING(logger, ...) DEBUG_LOGGER_LOG(logger, Debug::WARNING, __VA_ARGS__)
+#define DEBUG_LOGGER_ERROR(logger, ...) DEBUG_LOGGER_LOG(logger, Debug::ERROR, __VA_ARGS__)
+#define DEBUG_LOGGER_CRITICAL(logger, ...) DEBUG_LOGGER_LOG(logger, Debug::CRITICAL, __VA_ARGS__)
+
 #endif
\ No newline at end of file
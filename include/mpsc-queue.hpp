@@ -0,0 +1,114 @@
+#ifndef __MPSC_QUEUE_TEMPLATE_HPP__
+#define __MPSC_QUEUE_TEMPLATE_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/**
+ * Bounded lock-free multi-producer single-consumer ring.
+ *
+ * Every cell carries a sequence number which tells producers whether the
+ * cell is free for the current lap and tells the consumer whether the cell
+ * has been published. Producers only contend on one fetch/CAS of the
+ * enqueue cursor, the consumer never takes a lock.
+ */
+template <typename T>
+class MPSCQueue
+{
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) size_t dequeuePos;
+
+    static size_t roundUp(size_t capacity)
+    {
+        size_t result = 2;
+        while (result < capacity)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+public:
+    explicit MPSCQueue(size_t capacity) : cells(), mask(0), enqueuePos(0), dequeuePos(0)
+    {
+        size_t sz = roundUp(capacity);
+        cells.reset(new Cell[sz]);
+        mask = sz - 1;
+        for (size_t i = 0; i < sz; ++i)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPSCQueue(const MPSCQueue &) = delete;
+    MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+    bool tryEnqueue(T &&value)
+    {
+        Cell *cell;
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                /* queue full */
+                return false;
+            }
+            else
+            {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* must only be called from the consumer thread */
+    bool tryDequeue(T &result)
+    {
+        Cell *cell = &cells[dequeuePos & mask];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        if (seq != dequeuePos + 1)
+            return false;
+        result = std::move(cell->data);
+        cell->sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+        dequeuePos++;
+        return true;
+    }
+
+    /* must only be called from the consumer thread */
+    bool isEmpty() const
+    {
+        Cell *cell = &cells[dequeuePos & mask];
+        return cell->sequence.load(std::memory_order_acquire) != dequeuePos + 1;
+    }
+
+    size_t capacity() const
+    {
+        return mask + 1;
+    }
+};
+
+#endif
@@ -0,0 +1,304 @@
+/*
+ * $Id: txtlog-codec.hpp, v 1.0.0 2026/10/16 10:00:00 Jaya Wikrama Exp $
+ *
+ * Copyright (c) 2024 Jaya Wikrama
+ * jayawikrama89@gmail.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+/**
+ * @file txtlog-codec.hpp
+ * @brief Compression codecs used by TXTLog to archive rotated backups.
+ *
+ * A codec turns a rotated .log file into an archive and back. TXTLog asks
+ * its codec for the archive extension, so the codec also decides how
+ * archives are named and recognised. Codecs shipped with the library:
+ * - XzCodec, liblzma, optionally multi-threaded.
+ * - GzipCodec, zlib deflate in gzip framing (unless built with __DISABLE_ZLIB).
+ *
+ * @version 1.0.0
+ * @date 2026-10-16
+ * @author Jaya Wikrama
+ */
+
+#ifndef TXT_LOG_CODEC_HPP
+#define TXT_LOG_CODEC_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * @class TXTLogCodec
+ * @brief Base class of the archive codecs.
+ *
+ * Besides a fixed preset a codec can run in automatic mode (PRESET_AUTO).
+ * After every archived file TXTLog reports the measured compression
+ * throughput and the rate at which log data arrives; the codec then steps
+ * its effective preset down when compression cannot keep up and back up
+ * when there is plenty of headroom.
+ */
+class TXTLogCodec
+{
+private:
+    std::atomic<int> preset;
+    std::atomic<int> effectivePreset;
+
+protected:
+    /**
+     * @brief Construct a codec.
+     *
+     * @param preset Initial preset, or PRESET_AUTO.
+     */
+    explicit TXTLogCodec(int preset);
+
+    /**
+     * @brief Preset used when automatic mode starts.
+     */
+    virtual int defaultPreset() const = 0;
+
+public:
+    static const int PRESET_AUTO = -1;
+
+    /**
+     * @brief Receives decoded bytes, returns false to stop decoding.
+     */
+    typedef std::function<bool(const char *, std::size_t)> Consumer;
+
+    virtual ~TXTLogCodec();
+
+    /**
+     * @brief Short codec name, e.g. "xz".
+     */
+    virtual const char *name() const = 0;
+
+    /**
+     * @brief Archive file extension including the dot, e.g. ".xz".
+     */
+    virtual const char *extension() const = 0;
+
+    /**
+     * @brief Lowest (fastest) supported preset.
+     */
+    virtual int minPreset() const = 0;
+
+    /**
+     * @brief Highest (strongest) supported preset.
+     */
+    virtual int maxPreset() const = 0;
+
+    /**
+     * @brief Compress a file into an archive.
+     *
+     * @param inputFile  Source file.
+     * @param outputFile Destination archive.
+     * @param threads    Threads the codec may use, codecs without threading ignore it.
+     * @return true if the archive was written completely, false otherwise.
+     */
+    virtual bool compress(const std::string &inputFile, const std::string &outputFile, std::uint32_t threads) = 0;
+
+    /**
+     * @brief Restore the original file from an archive.
+     *
+     * Archives made of several concatenated streams are decoded completely.
+     *
+     * @param inputFile  Source archive.
+     * @param outputFile Destination file.
+     * @return true if success, false otherwise.
+     */
+    virtual bool decompress(const std::string &inputFile, const std::string &outputFile) = 0;
+
+    /**
+     * @brief Decode an archive chunk by chunk without an intermediate file.
+     *
+     * @param inputFile Source archive.
+     * @param consumer  Called with every decoded chunk, in order.
+     * @return true if the archive decoded completely, false on error or when the consumer stopped.
+     */
+    virtual bool decompressStream(const std::string &inputFile, const Consumer &consumer) = 0;
+
+    /**
+     * @brief Compress a memory buffer into one complete, self-contained stream.
+     *
+     * Used by the compress-as-you-write mode of TXTLog: every flush appends
+     * one stream to the active file, and concatenated streams decode as one.
+     *
+     * @param data   Input bytes.
+     * @param size   Number of input bytes.
+     * @param output Compressed stream is appended here.
+     * @return true if success, false otherwise.
+     */
+    virtual bool compressBuffer(const char *data, std::size_t size, std::string &output) = 0;
+
+    /**
+     * @brief Decode one or more concatenated streams held in memory, chunk by chunk.
+     *
+     * @param data     Compressed bytes.
+     * @param size     Number of compressed bytes.
+     * @param consumer Called with every decoded chunk, in order.
+     * @return true if every stream decoded completely, false on error or when the consumer stopped.
+     */
+    virtual bool decompressBuffer(const char *data, std::size_t size, const Consumer &consumer) = 0;
+
+    /**
+     * @brief Decode one or more concatenated streams held in memory.
+     *
+     * Used to read single blocks of seekable archives without touching the
+     * rest of the file.
+     *
+     * @param data   Compressed bytes.
+     * @param size   Number of compressed bytes.
+     * @param output Decoded bytes are appended here.
+     * @return true if every stream decoded completely, false otherwise.
+     */
+    bool decompressBuffer(const char *data, std::size_t size, std::string &output);
+
+    /**
+     * @brief Select the preset, out of range values are clamped.
+     *
+     * @param preset Preset value or PRESET_AUTO.
+     */
+    void setPreset(int preset);
+
+    /**
+     * @brief Get the configured preset, PRESET_AUTO in automatic mode.
+     */
+    int getPreset() const;
+
+    /**
+     * @brief Get the preset the next compression will use.
+     */
+    int getEffectivePreset() const;
+
+    /**
+     * @brief Adapt the effective preset in automatic mode.
+     *
+     * Steps one preset faster when the codec compresses less than twice the
+     * incoming rate and one preset stronger when it compresses more than
+     * eight times the incoming rate. Does nothing for a fixed preset.
+     *
+     * @param incomingBytesPerSecond Rate at which log data is written.
+     * @param compressBytesPerSecond Measured input throughput of the last compression.
+     */
+    void tune(double incomingBytesPerSecond, double compressBytesPerSecond);
+
+    /**
+     * @brief Pick a codec able to read an archive from its file name.
+     *
+     * @param archiveFile Archive path.
+     * @return A codec instance, or nullptr if the extension is unknown.
+     */
+    static std::shared_ptr<TXTLogCodec> forArchive(const std::string &archiveFile);
+
+    /**
+     * @brief Check whether a file name ends with the extension of a known codec.
+     */
+    static bool isArchiveName(const std::string &fileName);
+};
+
+/**
+ * @class XzCodec
+ * @brief xz archives through liblzma.
+ *
+ * With more than one thread liblzma's multi-threaded block encoder is used.
+ * Each encoder thread at preset 6 needs roughly 100 MB of memory.
+ */
+class XzCodec : public TXTLogCodec
+{
+public:
+    typedef enum _CHECK
+    {
+        CHECK_NONE = 0,
+        CHECK_CRC32,
+        CHECK_CRC64,
+        CHECK_SHA256
+    } CHECK;
+
+private:
+    std::atomic<int> check;
+    std::atomic<std::size_t> blockSize;
+
+protected:
+    int defaultPreset() const override;
+
+public:
+    /**
+     * @brief Construct an xz codec.
+     *
+     * @param preset    0 (fastest) to 9 (strongest), or PRESET_AUTO.
+     * @param check     Integrity check stored in the archive.
+     * @param blockSize Block size for the threaded encoder, 0 splits each file evenly (at least 1 MB).
+     */
+    explicit XzCodec(int preset = 6, CHECK check = CHECK_CRC64, std::size_t blockSize = 0);
+    ~XzCodec();
+
+    const char *name() const override;
+    const char *extension() const override;
+    int minPreset() const override;
+    int maxPreset() const override;
+    bool compress(const std::string &inputFile, const std::string &outputFile, std::uint32_t threads) override;
+    bool decompress(const std::string &inputFile, const std::string &outputFile) override;
+    bool decompressStream(const std::string &inputFile, const Consumer &consumer) override;
+    bool compressBuffer(const char *data, std::size_t size, std::string &output) override;
+    bool decompressBuffer(const char *data, std::size_t size, const Consumer &consumer) override;
+    using TXTLogCodec::decompressBuffer;
+
+    void setCheck(CHECK check);
+    CHECK getCheck() const;
+    void setBlockSize(std::size_t blockSize);
+    std::size_t getBlockSize() const;
+};
+
+#ifndef __DISABLE_ZLIB
+/**
+ * @class GzipCodec
+ * @brief gzip archives through zlib deflate.
+ *
+ * Much faster than xz at a lower ratio, readable with any gzip tool.
+ */
+class GzipCodec : public TXTLogCodec
+{
+protected:
+    int defaultPreset() const override;
+
+public:
+    /**
+     * @brief Construct a gzip codec.
+     *
+     * @param preset 1 (fastest) to 9 (strongest), or PRESET_AUTO.
+     */
+    explicit GzipCodec(int preset = 6);
+    ~GzipCodec();
+
+    const char *name() const override;
+    const char *extension() const override;
+    int minPreset() const override;
+    int maxPreset() const override;
+    bool compress(const std::string &inputFile, const std::string &outputFile, std::uint32_t threads) override;
+    bool decompress(const std::string &inputFile, const std::string &outputFile) override;
+    bool decompressStream(const std::string &inputFile, const Consumer &consumer) override;
+    bool compressBuffer(const char *data, std::size_t size, std::string &output) override;
+    bool decompressBuffer(const char *data, std::size_t size, const Consumer &consumer) override;
+    using TXTLogCodec::decompressBuffer;
+};
+#endif
+
+#endif
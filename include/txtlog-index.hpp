@@ -0,0 +1,153 @@
+/*
+ * $Id: txtlog-index.hpp, v 1.0.0 2026/10/16 10:00:00 Jaya Wikrama Exp $
+ *
+ * Copyright (c) 2024 Jaya Wikrama
+ * jayawikrama89@gmail.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+/**
+ * @file txtlog-index.hpp
+ * @brief Sidecar block index of seekable TXTLog archives.
+ *
+ * A seekable archive is a sequence of independently compressed codec
+ * streams (blocks), each holding whole lines. Next to the archive a text
+ * file "<archive>.idx" lists one block per line:
+ *
+ *   <offset> <compressed size> <raw size> <first ms> <last ms>
+ *
+ * Offsets and sizes are in bytes, times are epoch milliseconds taken from
+ * the Debug line header "[YYMMDD_HHMMSS.mmm]" (local time). A block without
+ * any timestamped line stores 0 for both times and matches every range.
+ *
+ * @version 1.0.0
+ * @date 2026-10-16
+ * @author Jaya Wikrama
+ */
+
+#ifndef TXT_LOG_INDEX_HPP
+#define TXT_LOG_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class TXTLogIndex
+ * @brief Reading, writing and time parsing helpers of the block index.
+ */
+class TXTLogIndex
+{
+public:
+    /**
+     * @brief One compressed block of an archive.
+     */
+    struct Entry
+    {
+        std::uint64_t offset;
+        std::uint64_t compressedSize;
+        std::uint64_t rawSize;
+        std::int64_t firstMs;
+        std::int64_t lastMs;
+
+        /**
+         * @brief Check whether the block may hold lines inside [fromMs, toMs].
+         */
+        bool overlaps(std::int64_t fromMs, std::int64_t toMs) const;
+    };
+
+    /**
+     * @class TimeParser
+     * @brief Parses the Debug line header, caching the per-second part.
+     *
+     * Consecutive lines usually share the same second, so mktime() runs
+     * once per distinct second instead of once per line.
+     */
+    class TimeParser
+    {
+    private:
+        char prefix[13];
+        std::int64_t prefixMs;
+        bool cached;
+
+    public:
+        TimeParser();
+
+        /**
+         * @brief Parse the timestamp at the start of a line.
+         *
+         * @param line   Line start.
+         * @param length Bytes available.
+         * @param ms     Epoch milliseconds on success.
+         * @return true if the line starts with a Debug timestamp.
+         */
+        bool parse(const char *line, std::size_t length, std::int64_t &ms);
+    };
+
+    static const char *EXTENSION;
+
+    /**
+     * @brief Find the first and last timestamp of the lines in a buffer.
+     *
+     * @param data    Buffer holding whole lines.
+     * @param size    Buffer size.
+     * @param parser  Parser to use, keeps its cache across calls.
+     * @param firstMs First timestamp, 0 if none.
+     * @param lastMs  Last timestamp, 0 if none.
+     */
+    static void scanTimes(const char *data, std::size_t size, TimeParser &parser, std::int64_t &firstMs, std::int64_t &lastMs);
+
+    /**
+     * @brief Format one index line, terminated by a newline.
+     */
+    static std::string format(const Entry &entry);
+
+    /**
+     * @brief Load an index file.
+     *
+     * @param path    Index path.
+     * @param entries Parsed blocks in file order.
+     * @return true if the file exists and every line parsed.
+     */
+    static bool load(const std::string &path, std::vector<Entry> &entries);
+
+    /**
+     * @brief Load the index of an archive and check that it is usable.
+     *
+     * An index is only trusted when its blocks tile the whole archive, an
+     * archive written before indexing was enabled fails this check.
+     *
+     * @param archiveFile Archive path.
+     * @param entries     Parsed blocks in file order.
+     * @return true if the index covers every byte of the archive.
+     */
+    static bool loadFor(const std::string &archiveFile, std::vector<Entry> &entries);
+
+    /**
+     * @brief Index path of an archive.
+     */
+    static std::string pathFor(const std::string &archiveFile);
+
+    /**
+     * @brief Check whether a file name is an index sidecar.
+     */
+    static bool isIndexName(const std::string &fileName);
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * $Id: txtlog-ring.hpp, v 1.0.0 2026/10/16 10:00:00 Jaya Wikrama Exp $
+ *
+ * Copyright (c) 2024 Jaya Wikrama
+ * jayawikrama89@gmail.com
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+/**
+ * @file txtlog-ring.hpp
+ * @brief Asynchronous TXTLog writes through a Linux io_uring instance.
+ *
+ * The ring is driven with the raw io_uring_setup / io_uring_enter /
+ * io_uring_register system calls, no liburing is needed. Data is copied
+ * into a pool of buffers registered with the kernel and written at explicit
+ * file offsets, so the order in which the kernel completes the writes does
+ * not matter. Completions are reaped from the shared completion queue
+ * whenever the owner submits, without an extra system call.
+ *
+ * Building with __DISABLE_IO_URING (or on a kernel without io_uring)
+ * leaves open() failing, callers then keep their synchronous path.
+ *
+ * @version 1.0.0
+ * @date 2026-10-16
+ * @author Jaya Wikrama
+ */
+
+#ifndef TXT_LOG_RING_HPP
+#define TXT_LOG_RING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * @class TXTLogRing
+ * @brief Submission and completion handling of one io_uring instance.
+ *
+ * Not thread-safe, the owner serializes every call (TXTLog holds its
+ * writer lock).
+ */
+class TXTLogRing
+{
+private:
+    /* one operation in flight, its index is the user_data of the SQE */
+    struct Request
+    {
+        std::uint64_t offset;
+        char *address;
+        std::uint32_t length;
+        int fd;
+        int slot; /* pool buffer of a write, negative for fsync and rename */
+        bool done;
+        int result;
+    };
+
+    /* one registered buffer, filled front to back and reused once every write from it completed */
+    struct Slot
+    {
+        std::size_t used;
+        std::size_t pending;
+    };
+
+    int ringDescriptor;
+    void *submissionMap;
+    std::size_t submissionMapSize;
+    void *completionMap;
+    std::size_t completionMapSize;
+    io_uring_sqe *submissionEntries;
+    std::size_t submissionEntriesSize;
+
+    unsigned *submissionHead;
+    unsigned *submissionTail;
+    unsigned submissionMask;
+    unsigned *submissionArray;
+    unsigned submissionCapacity;
+    unsigned *completionHead;
+    unsigned *completionTail;
+    unsigned completionMask;
+    io_uring_cqe *completionEntries;
+    unsigned queued;         /* prepared but not handed to the kernel yet */
+    std::size_t queuedBytes; /* data of the queued writes */
+
+    char *pool;
+    std::size_t poolSize;
+    std::size_t slotSize;
+    std::vector<Slot> slots;
+    std::size_t currentSlot;
+    bool fixedBuffers;
+    bool renameSupported;
+
+    std::vector<Request> requests;
+    std::vector<std::uint32_t> freeRequests;
+    std::size_t inFlight;
+    int lastWrite; /* queued write a contiguous append may still extend, -1 if none */
+    io_uring_sqe *lastWriteEntry;
+    bool failed;
+
+    io_uring_sqe *nextEntry();
+    void pushEntry();
+    std::uint32_t acquireRequest();
+    void queueWrite(std::uint32_t index);
+    void queueWriteFrom(int fd, std::uint64_t offset, std::size_t slot, std::size_t position, std::size_t length);
+    bool enter(unsigned minComplete); /* submits everything queued */
+    void reap();
+    void complete(std::uint32_t index, int result);
+    void waitOne();
+    void nextSlot();
+    void release();
+
+public:
+    TXTLogRing();
+
+    /**
+     * @brief Destructor, waits for every operation in flight.
+     */
+    ~TXTLogRing();
+
+    TXTLogRing(const TXTLogRing &) = delete;
+    TXTLogRing &operator=(const TXTLogRing &) = delete;
+
+    /**
+     * @brief Create the ring and its buffer pool.
+     *
+     * The pool is registered as fixed buffers when the memory lock limit
+     * allows it, plain writes from the same memory are used otherwise.
+     *
+     * @param bufferSize  Size of one pool buffer in bytes.
+     * @param bufferCount Number of pool buffers.
+     * @return true if io_uring is available and supports the needed operations.
+     */
+    bool open(std::size_t bufferSize, std::size_t bufferCount);
+
+    /**
+     * @brief Wait for every operation in flight and release the ring.
+     */
+    void close();
+
+    /**
+     * @brief Check whether the ring is usable.
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Queue a write of a copy of the data at an explicit offset.
+     *
+     * Nothing reaches the kernel before submit(). Blocks only while every
+     * pool buffer is still being written.
+     *
+     * @param fd     Destination, opened without O_APPEND.
+     * @param offset File offset of the first byte.
+     * @param data   Bytes to write.
+     * @param size   Number of bytes.
+     */
+    void write(int fd, std::uint64_t offset, const char *data, std::size_t size);
+
+    /**
+     * @brief Bytes written since the last submission.
+     */
+    std::size_t pendingBytes() const;
+
+    /**
+     * @brief Size of one pool buffer.
+     */
+    std::size_t bufferSize() const;
+
+    /**
+     * @brief Queue an fdatasync() that starts once every earlier operation completed.
+     *
+     * @param fd File to sync.
+     */
+    void sync(int fd);
+
+    /**
+     * @brief Rename a file after every earlier operation completed.
+     *
+     * Blocks until the rename is done, the caller usually creates a new
+     * file under the old name next. Falls back to rename() after draining
+     * the ring on kernels without IORING_OP_RENAMEAT.
+     *
+     * @return true if the file was renamed.
+     */
+    bool rename(const char *from, const char *to);
+
+    /**
+     * @brief Hand the queued operations to the kernel and reap finished ones.
+     *
+     * @return false if an operation failed since the last check.
+     */
+    bool submit();
+
+    /**
+     * @brief Submit and wait until nothing is in flight.
+     *
+     * @return false if an operation failed since the last check.
+     */
+    bool drain();
+};
+
+#endif
@@ -32,8 +32,8 @@
  *
  * The class maintains:
  * - A fixed number of plain text backup files.
- * - Older backup files are automatically archived into xz files,
- *   with a fixed maximum number of archive files.
+ * - Older backup files are automatically archived (xz by default, see
+ *   txtlog-codec.hpp), with a fixed maximum number of archive files.
  *
  * @version 1.0.0
  * @date 2025-12-26
@@ -45,9 +45,24 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <cstddef>
 #include <cstdint>
+#include <ctime>
+#include <chrono>
 #include <mutex>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <iosfwd>
+#include <sys/uio.h>
+
+#include "debug.hpp"
+
+class TXTLogCodec;
+class TXTLogRing;
 
 /**
  * @class TXTLog
@@ -67,7 +82,60 @@
  */
 class TXTLog
 {
+public:
+    /**
+     * @brief Filter of query().
+     *
+     * Every condition must hold; an empty or zero field does not filter.
+     */
+    struct Query
+    {
+        std::time_t from;                  /* first second, 0 for no lower bound */
+        std::time_t to;                    /* last second (inclusive), 0 for no upper bound */
+        Debug::LogType_t minLevel;         /* lowest level returned */
+        std::vector<std::string> contains; /* record must contain at least one of them */
+        std::string pattern;               /* ECMAScript regular expression searched in the record */
+
+        Query();
+    };
+
+    /**
+     * @brief One log record: a timestamped line and its continuation lines.
+     */
+    struct Record
+    {
+        std::int64_t timeMs;    /* epoch milliseconds, 0 when the record has no timestamp */
+        Debug::LogType_t level; /* INFO when the record has no level tag */
+        std::string text;       /* the lines as written, including newlines */
+    };
+
+    /**
+     * @brief When written data is made durable with fdatasync().
+     */
+    enum DurabilityPolicy
+    {
+        DURABILITY_NONE = 0, /* the kernel decides, flush() syncs on request */
+        DURABILITY_INTERVAL, /* every N milliseconds, on the maintenance worker */
+        DURABILITY_BYTES,    /* once N bytes were written, on the maintenance worker */
+        DURABILITY_CRITICAL  /* before write() returns, for writes holding a CRITICAL record */
+    };
+
+    /**
+     * @brief When the active file is rotated.
+     */
+    enum RotationPolicy
+    {
+        ROTATE_SIZE = 0,       /* once the maximum file size is reached */
+        ROTATE_HOURLY,         /* at every full hour of local time, whatever the size */
+        ROTATE_DAILY,          /* at local midnight, whatever the size */
+        ROTATE_SIZE_OR_HOURLY, /* at the maximum size or the next full hour */
+        ROTATE_SIZE_OR_DAILY,  /* at the maximum size or the next midnight */
+        ROTATE_SIZE_OR_AGE     /* at the maximum size or once the file is N seconds old */
+    };
+
 private:
+    class QueryScanner;
+
     int fileDescriptor;
 
     std::string workingDirectory;
@@ -78,8 +146,102 @@ private:
     std::size_t maxTxtBackups;
     std::size_t maxArchiveFiles;
 
+    /* size of the active file, taken from fstat at open and advanced by every write */
+    std::uintmax_t currentFileSize;
+
+    std::string writeBuffer;
+    std::size_t writeBufferSize;
+    std::chrono::milliseconds maxBufferAge;
+    std::chrono::steady_clock::time_point bufferSince;
+
     mutable std::mutex mutex;
 
+    /* backup archiving and retention run on a worker so rotation only renames */
+    bool backgroundMaintenance;
+    bool maintenancePending;
+    bool maintenanceRunning;
+    bool maintenanceStop;
+    std::thread maintenanceThread;
+    mutable std::mutex maintenanceMutex;
+    std::condition_variable maintenanceCondition;
+
+    /* durability policy, writers read it without a lock */
+    std::atomic<int> durabilityPolicy;
+    std::atomic<std::size_t> durabilityValue;
+    std::atomic<std::size_t> unsyncedBytes;
+    bool syncPending; /* guarded by maintenanceMutex */
+
+    /* when the worker next drains aged buffer or ring data, zero without a timer; guarded by maintenanceMutex */
+    std::chrono::steady_clock::time_point flushDeadline;
+
+    std::atomic<std::uint32_t> archiveThreads;
+    std::shared_ptr<TXTLogCodec> codec;
+
+    /* time-based rotation: writers compare a precomputed deadline with a coarse clock */
+    int rotationPolicy;                         /* guarded by mutex */
+    std::time_t rotationAge;                    /* guarded by mutex */
+    std::atomic<std::int64_t> rotationDeadline; /* epoch seconds, 0 without a time limit */
+
+    /* bytes per second of the last rotated file, input of the automatic preset */
+    std::atomic<double> incomingRate;
+    std::chrono::steady_clock::time_point rotationSince;
+
+    /* compress-as-you-write: the active file is a sequence of codec streams */
+    std::atomic<bool> compressedStreaming;
+    std::string compressedBuffer;
+
+    /* seekable archives: independently compressed blocks plus a sidecar index */
+    std::atomic<bool> indexedArchives;
+    std::atomic<std::size_t> indexBlockSize;
+
+    /* backups and archives of this log, sorted oldest first; built once, then kept up to date */
+    struct ManifestEntry
+    {
+        std::string path;
+        std::string key; /* "YYYYMMDD.HHMMSS" plus an optional "_NNN" */
+        std::uintmax_t size;
+    };
+    std::vector<ManifestEntry> manifestBackups;
+    std::vector<ManifestEntry> manifestArchives;
+    mutable std::mutex manifestMutex;
+
+    /* failed archiving passes per backup, only touched by maintenance */
+    std::map<std::string, unsigned int> archiveFailures;
+
+    /* group commit: the first waiting writer writes the queued records of all others */
+    struct GroupCommitRequest
+    {
+        const std::string *data;
+        bool done;
+        bool result;
+    };
+    std::atomic<bool> groupCommit;
+    bool groupLeader;
+    std::vector<GroupCommitRequest *> groupQueue;
+    std::vector<GroupCommitRequest *> groupBatch; /* owned by the leader, reused to avoid allocations */
+    std::vector<struct iovec> groupVectors;       /* guarded by mutex */
+    std::mutex groupMutex;
+    std::condition_variable groupCondition;
+
+    /* io_uring backend: appends go through the ring at explicit offsets of a second, non-O_APPEND descriptor */
+    std::unique_ptr<TXTLogRing> ring;
+    int ringFileDescriptor;
+    std::chrono::steady_clock::time_point ringSince; /* first write not submitted yet */
+
+    /* memory-mapped mode: writers reserve space with a CAS on mappedOffset and copy without the mutex */
+    std::atomic<bool> mappedFile;
+    std::atomic<char *> mappedBase; /* nullptr while no mapping is open */
+    std::atomic<std::uint64_t> mappedOffset;
+    std::atomic<std::size_t> mappedWriters;
+    std::size_t mappedCapacity;
+
+    /* multi-process mode: processes writing the same log coordinate through "<base>.lock" */
+    struct SharedControl;
+    std::atomic<bool> multiProcess;
+    int controlFileDescriptor;
+    SharedControl *control;          /* mapped from the lock file, guarded by mutex */
+    std::uint64_t controlGeneration; /* rotation generation of the file this process has open */
+
     /* ================= File Handling ================= */
 
     /**
@@ -91,16 +253,376 @@ private:
 
     /**
      * @brief Rotate the log file if size limit is exceeded.
+     *
+     * Only the rename and reopen happen here. Archiving and retention are
+     * handed to the maintenance worker unless background maintenance is off.
      */
     void rotateIfNeeded();
 
+    /**
+     * @brief Rotate the log file now.
+     *
+     * The caller must hold the mutex and own a valid file descriptor.
+     */
+    void rotateLocked();
+
+    /**
+     * @brief Turn the closed active file into a backup.
+     *
+     * A plain file becomes a timestamped txt backup, a compressed one is
+     * renamed straight into an archive together with its index.
+     */
+    void retireActiveFile();
+
+    /**
+     * @brief Close the descriptors of the active file.
+     *
+     * Writes queued on the ring are submitted first; once submitted they
+     * keep the file open in the kernel and complete normally. The caller
+     * must hold the mutex.
+     */
+    void closeActiveFileLocked();
+
+    /**
+     * @brief Open the descriptor the ring writes to.
+     *
+     * On failure the ring is dropped and writes continue synchronously.
+     * The caller must hold the mutex.
+     */
+    void openRingFileLocked();
+
+    /**
+     * @brief Wait until every ring write has reached the file.
+     *
+     * Needed before the file is read or handed to maintenance. Does nothing
+     * without the ring. The caller must hold the mutex.
+     *
+     * @return false if a write failed.
+     */
+    bool completeWritesLocked();
+
+    /**
+     * @brief Rename a file, through the ring when it is active.
+     *
+     * The caller must hold the mutex.
+     */
+    bool renameLocked(const std::string &from, const std::string &to);
+
+    /**
+     * @brief Path of the lock file shared by the processes writing this log.
+     *
+     * @return "<base>.lock".
+     */
+    std::string generateLockName() const;
+
+    /**
+     * @brief Map the shared control block and join the other processes.
+     *
+     * The active file is reopened and the shared size taken from it while
+     * no process appends. The caller must hold the mutex.
+     *
+     * @return true if successful, false otherwise.
+     */
+    bool openControlLocked();
+
+    /**
+     * @brief Unmap the control block and close the lock file.
+     *
+     * The caller must hold the mutex.
+     */
+    void closeControlLocked();
+
+    /**
+     * @brief Take the shared append lock before a write.
+     *
+     * Reopens the active file first if another process rotated it. The
+     * caller must hold the mutex and call endSharedAppendLocked() after a
+     * successful return.
+     *
+     * @return false if no active file could be opened.
+     */
+    bool beginSharedAppendLocked();
+
+    /**
+     * @brief Account the appended bytes and release the append lock.
+     *
+     * @param size Bytes written since beginSharedAppendLocked().
+     */
+    void endSharedAppendLocked(std::size_t size);
+
+    /**
+     * @brief Reopen the active file if another process rotated it.
+     *
+     * The caller must hold the mutex and one of the append locks.
+     */
+    void followRotationLocked();
+
+    /**
+     * @brief Decide under the exclusive append lock whether this process rotates.
+     *
+     * Returns false, with the lock released, when another process rotated
+     * first or the file turns out to be smaller than the shared size says.
+     * Otherwise the lock stays held until releaseRotationLocked().
+     *
+     * @return true if this process must rotate the file.
+     */
+    bool claimRotationLocked();
+
+    /**
+     * @brief Publish the new generation and release the exclusive append lock.
+     */
+    void releaseRotationLocked();
+
+    /**
+     * @brief Path of the active file for the current mode and codec.
+     *
+     * @return "<base>.log", or "<base>.log<ext>" when writing compressed.
+     */
+    std::string generateActiveName() const;
+
+    /**
+     * @brief Flush, close and reopen the active file under its current name.
+     *
+     * A non-empty file of the previous mode or codec is retired like on
+     * rotation. The caller must hold the mutex.
+     */
+    void reopenActiveFileLocked();
+
+    /* ================= Maintenance ================= */
+
+    /**
+     * @brief Request a maintenance pass, starting the worker on first use.
+     */
+    void scheduleMaintenance();
+
+    /**
+     * @brief Start the worker thread if it is not running.
+     *
+     * The caller must hold the maintenance mutex.
+     */
+    void startWorkerLocked();
+
+    /**
+     * @brief Ask the worker for an fdatasync() of the active file.
+     */
+    void requestSync();
+
+    /**
+     * @brief Have the worker call flushExpired() at @p deadline.
+     *
+     * Armed whenever the buffer or the ring receives its first pending
+     * record, so idle data does not wait for the next write. An earlier timer is
+     * kept. The caller may hold the writer mutex.
+     */
+    void scheduleFlush(std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief fdatasync() the active file without holding the writer lock.
+     *
+     * The user-space buffer is written first. With io_uring the sync is
+     * either queued on the ring or, with @p waitForRing, run after every
+     * pending ring write completed.
+     *
+     * @param waitForRing true if the data must be on disk on return.
+     * @return false if the sync failed.
+     */
+    bool syncData(bool waitForRing);
+
+    /**
+     * @brief Apply the durability policy after a write.
+     *
+     * @param data The data just written.
+     * @return false if a sync required before returning failed.
+     */
+    bool applyDurability(const std::string &data);
+
+    /**
+     * @brief Worker loop, runs maintenance passes until stopped.
+     */
+    void maintenanceLoop();
+
+    /**
+     * @brief Archive excess txt backups and prune excess archives.
+     */
+    void runMaintenance();
+
+    /**
+     * @brief Finish pending maintenance and join the worker.
+     */
+    void stopMaintenance();
+
     /**
      * @brief Check whether file rotation is required.
      *
+     * An empty file whose deadline passed is not rotated; it starts the
+     * next period instead. The caller must hold the mutex.
+     *
      * @param incomingDataSize Size of data to be written.
      * @return true if rotation is required, false otherwise.
      */
-    bool isRotationRequired(std::size_t incomingDataSize) const;
+    bool isRotationRequired(std::size_t incomingDataSize);
+
+    /**
+     * @brief Check the rotation deadline without the mutex.
+     *
+     * @return true if a time limit is set and has passed.
+     */
+    bool isRotationDeadlinePassed() const;
+
+    /**
+     * @brief Compute the rotation deadline of the active file.
+     *
+     * Aligned periods count from the last modification of a non-empty
+     * file, so a file left over from an earlier hour or day is rotated on
+     * the first write. The caller must hold the mutex.
+     */
+    void updateRotationDeadlineLocked();
+
+    /**
+     * @brief Append raw bytes to the active file.
+     *
+     * Retries partial writes and keeps the in-memory file size in sync.
+     * The caller must hold the mutex and own a valid file descriptor.
+     *
+     * @param data Pointer to the bytes to append.
+     * @param size Number of bytes.
+     * @return true if every byte was written, false otherwise.
+     */
+    bool appendLocked(const char *data, std::size_t size);
+
+    /**
+     * @brief Append several buffers to the active file with writev().
+     *
+     * Partial writes resume where they stopped; the vectors are consumed.
+     * The caller must hold the mutex and own a valid file descriptor.
+     *
+     * @param vectors Buffers in file order.
+     * @return true if every byte was written, false otherwise.
+     */
+    bool appendvLocked(std::vector<struct iovec> &vectors);
+
+    /**
+     * @brief Queue an unbuffered record on the ring.
+     *
+     * Records are submitted once a pool buffer's worth is queued or the
+     * oldest one exceeded the maximum buffer age. The caller must hold the
+     * mutex and the ring must be active.
+     *
+     * @param data Pointer to the bytes to append.
+     * @param size Number of bytes.
+     * @return false if a write reaped here failed.
+     */
+    bool queueRingLocked(const char *data, std::size_t size);
+
+    /**
+     * @brief Body of write() once the mutex is held.
+     *
+     * @param data Text data to be written.
+     * @return true if the write operation succeeds, false otherwise.
+     */
+    bool writeLocked(const std::string &data);
+
+    /**
+     * @brief write() in group-commit mode.
+     *
+     * Queues the record, then either waits for the current leader to write
+     * it or becomes the leader and writes every queued record at once.
+     *
+     * @param data Text data to be written.
+     * @return Result of the batch that carried the record.
+     */
+    bool writeGrouped(const std::string &data);
+
+    /**
+     * @brief write() in memory-mapped mode.
+     *
+     * Copies into the mapping without the mutex; only a full or missing
+     * mapping takes the mutex to rotate and map the next file.
+     *
+     * @param data Text data to be written.
+     * @return true if the write operation succeeds, false otherwise.
+     */
+    bool writeMapped(const std::string &data);
+
+    /**
+     * @brief Reserve space in the mapping and copy the data into it.
+     *
+     * Lock-free. Fails without reserving anything when no mapping is open
+     * or the data does not fit.
+     *
+     * @return true if the data was copied.
+     */
+    bool copyMapped(const char *data, std::size_t size);
+
+    /**
+     * @brief Make room in the mapping for a record.
+     *
+     * Closes a full mapping, rotates when the record does not fit in the
+     * current file and maps the next one. The caller must hold the mutex.
+     *
+     * @param size Record size.
+     * @return false if the record cannot go through a mapping.
+     */
+    bool prepareMappingLocked(std::size_t size);
+
+    /**
+     * @brief Preallocate the active file to the maximum size and map it.
+     *
+     * The caller must hold the mutex.
+     *
+     * @param size Bytes that must fit after the data already in the file.
+     * @return true if a mapping with room for @p size bytes is open.
+     */
+    bool openMappingLocked(std::size_t size);
+
+    /**
+     * @brief Unmap the active file and truncate it to the bytes written.
+     *
+     * Waits for writers still copying into the mapping. The caller must
+     * hold the mutex.
+     */
+    void closeMappingLocked();
+
+    /**
+     * @brief Cut the zero tail a crash leaves in a preallocated file.
+     *
+     * The caller must hold the mutex and own a valid file descriptor.
+     */
+    void trimPreallocatedLocked();
+
+    /**
+     * @brief Write one group-commit batch.
+     *
+     * Without a user-space buffer the batch goes out with a single
+     * writev() after one rotation check; otherwise the records are added
+     * to the buffer one by one. The caller must hold the mutex.
+     *
+     * @param batch Queued records, in arrival order.
+     */
+    void commitGroupLocked(const std::vector<GroupCommitRequest *> &batch);
+
+    /**
+     * @brief Move the user-space buffer into the active file.
+     *
+     * Rotation is checked once per flushed buffer, not per record.
+     * The caller must hold the mutex.
+     *
+     * @return true if the buffer is empty or was written, false otherwise.
+     */
+    bool flushBufferLocked();
+
+    /**
+     * @brief Record one compressed block of the active file in its index.
+     *
+     * The caller must hold the mutex.
+     *
+     * @param offset         Offset of the block in the active file.
+     * @param data           Uncompressed block.
+     * @param size           Uncompressed size.
+     * @param compressedSize Size of the block in the file.
+     * @return true if the index line was written, false otherwise.
+     */
+    bool appendIndexLocked(std::uint64_t offset, const char *data, std::size_t size, std::size_t compressedSize);
 
     /* ================= Backup Handling ================= */
 
@@ -123,6 +645,17 @@ private:
      */
     void maintainTxtBackups();
 
+    /**
+     * @brief Count a failed archiving pass of a backup.
+     *
+     * The backup stays for the next pass; after a few failed passes it is
+     * renamed to "<backup>.failed" and leaves the manifest, so one bad
+     * file cannot make backups pile up.
+     *
+     * @param txtFile Backup that could not be archived.
+     */
+    void handleArchiveFailure(const std::string &txtFile);
+
     /* ================= Archive Handling ================= */
 
     /**
@@ -135,13 +668,48 @@ private:
      */
     std::string generateArchiveName(const std::string &fileName = "", const std::string ext = ".xz") const;
 
+    /**
+     * @brief Compress a single file with the active codec.
+     *
+     * The measured throughput is reported back to the codec so an automatic
+     * preset can follow the incoming data rate.
+     *
+     * @param txtFile Source file.
+     * @param archiveFile Destination archive.
+     * @param threads Threads the codec may use.
+     * @return true if the archive was written completely, false otherwise.
+     */
+    bool compressFile(const std::string &txtFile, const std::string &archiveFile, std::uint32_t threads);
+
+    /**
+     * @brief Compress a file into a seekable archive and write its index.
+     *
+     * The file is cut into blocks of about the index block size at line
+     * boundaries and every block becomes one codec stream, so the archive
+     * still decodes as a whole. With several threads, consecutive blocks are
+     * compressed in parallel.
+     *
+     * @param codec       Codec to use.
+     * @param txtFile     Source file.
+     * @param archiveFile Destination archive, the index goes to "<archiveFile>.idx".
+     * @param threads     Blocks compressed at once.
+     * @return true if archive and index were written, false otherwise.
+     */
+    bool compressFileIndexed(TXTLogCodec &codec, const std::string &txtFile, const std::string &archiveFile, std::uint32_t threads);
+
     /**
      * @brief Create archive from the given files.
      *
-     * @param files List of files to be archived.
-     * @return true if archive creation succeeds, false otherwise.
+     * When several files are given and more than one archive thread is
+     * configured, the files are compressed in parallel and the threads are
+     * shared between them. Each file is removed as soon as its own archive
+     * is written.
+     *
+     * @param files  List of files to be archived.
+     * @param failed Receives the files that could not be archived.
+     * @return true if every archive was written, false otherwise.
      */
-    bool createArchive(const std::vector<std::string> &files);
+    bool createArchive(const std::vector<std::string> &files, std::vector<std::string> &failed);
 
     /**
      * @brief Maintain the number of archived backup files.
@@ -161,6 +729,100 @@ private:
      */
     bool extractXzToFile(const std::string &xzFile, const std::string &outputFile);
 
+    /**
+     * @brief Extract an archive of any known codec, chosen by its extension.
+     *
+     * @param archiveFile The archive file path.
+     * @param outputFile The txt file name as output file name.
+     *
+     * @return true if success.
+     * @return false on fail.
+     */
+    bool extractArchiveToFile(const std::string &archiveFile, const std::string &outputFile);
+
+    /**
+     * @brief Append the lines of an archive inside a time window to a stream.
+     *
+     * With a complete index only the overlapping blocks are read and
+     * decoded; otherwise the whole archive is decoded in chunks.
+     *
+     * @param archiveFile Archive path.
+     * @param fromMs      Window start, epoch milliseconds.
+     * @param toMs        Window end, epoch milliseconds, inclusive.
+     * @param output      Destination stream.
+     * @return true if the archive was read, false otherwise.
+     */
+    bool extractArchiveRange(const std::string &archiveFile, std::int64_t fromMs, std::int64_t toMs, std::ostream &output);
+
+    /**
+     * @brief Append the lines of a plain text file inside a time window to a stream.
+     *
+     * @param txtFile Text file path.
+     * @param fromMs  Window start, epoch milliseconds.
+     * @param toMs    Window end, epoch milliseconds, inclusive.
+     * @param output  Destination stream.
+     * @return true if the file was read, false otherwise.
+     */
+    bool extractTextRange(const std::string &txtFile, std::int64_t fromMs, std::int64_t toMs, std::ostream &output);
+
+    /**
+     * @brief Feed the records of one file to a query scanner.
+     *
+     * Archives are decoded in chunks without a temporary file; with a
+     * complete index and a time bound only the overlapping blocks are read.
+     *
+     * @param file    File path.
+     * @param archive true if the file is an archive.
+     * @param scanner Scanner collecting the matching records.
+     * @return true if the file was read completely, false otherwise.
+     */
+    static bool queryFile(const std::string &file, bool archive, QueryScanner &scanner);
+
+    /**
+     * @brief Pin a file with a hard link so rotation and retention cannot remove it while it is read.
+     *
+     * The link is named "./.snapshot-<pid>-<sequence>-<name>" and appended to
+     * @p links; the caller removes it with removeFiles(). If the link cannot
+     * be created the file is read in place.
+     *
+     * @param file  File path.
+     * @param links Pinning links created so far.
+     * @return Path to read the file from.
+     */
+    std::string pinFile(const std::string &file, std::vector<std::string> &links);
+
+    /**
+     * @brief Pass the first bytes of a file to a consumer, decoded if it is an archive.
+     *
+     * Used for the active file, which keeps growing after its length was
+     * captured under the writer mutex.
+     *
+     * @param file     File path.
+     * @param archive  true if the file is a compressed stream.
+     * @param limit    Number of file bytes to read.
+     * @param consumer Receives the (decoded) data; returning false stops the read.
+     * @return true if the data was read completely, false otherwise.
+     */
+    static bool readFilePrefix(const std::string &file, bool archive, std::uint64_t limit, const std::function<bool(const char *, std::size_t)> &consumer);
+
+    /* one file of a query; the active file is read up to limit bytes, the others completely */
+    struct QuerySource
+    {
+        std::string path;
+        bool archive;
+        std::uint64_t limit; /* max() for a complete file */
+    };
+
+    /**
+     * @brief Scan files with one worker each and merge the matching records in time order.
+     *
+     * @param query   Filter.
+     * @param sources Files, oldest first.
+     * @param records Matching records are appended here.
+     * @return true on success, false if the pattern is not a valid regular expression.
+     */
+    static bool queryFiles(const Query &query, const std::vector<QuerySource> &sources, std::vector<Record> &records);
+
 #ifndef __DISABLE_MINIZIP
     /**
      * @brief Adds a single file from the filesystem into an opened ZIP archive.
@@ -238,6 +900,9 @@ private:
     /**
      * @brief Get the current size of the active log file.
      *
+     * The size is tracked in memory, no stat() is performed. Data still held
+     * in the user-space buffer is not included.
+     *
      * @return File size in bytes.
      */
     std::uintmax_t getCurrentFileSize() const;
@@ -245,24 +910,85 @@ private:
     /**
      * @brief List all existing backup files.
      *
-     * @return Vector of backup file paths.
+     * Read from the manifest, the directory is not scanned.
+     *
+     * @return Vector of backup file paths, oldest first.
      */
     std::vector<std::string> listBackupFiles() const;
 
     /**
      * @brief List all existing archive files.
      *
-     * @return Vector of archive file paths.
+     * Read from the manifest, the directory is not scanned.
+     *
+     * @return Vector of archive file paths, oldest first.
      */
     std::vector<std::string> listArchiveFiles() const;
 
     /**
-     * @brief Remove specified files from filesystem.
+     * @brief Remove specified files from filesystem and manifest.
      *
      * @param files List of file paths to remove.
      */
     void removeFiles(const std::vector<std::string> &files);
 
+    /* ================= Manifest ================= */
+
+    /**
+     * @brief Check a txt backup name exactly: "<base>_YYYYMMDD.HHMMSS[_NNN].log".
+     *
+     * @param baseFileName Base name of the log.
+     * @param name         File name without directory.
+     * @param key          Timestamp part used for ordering.
+     * @return true if the name belongs to this log.
+     */
+    static bool parseBackupName(const std::string &baseFileName, const std::string &name, std::string &key);
+
+    /**
+     * @brief Check an archive name exactly: "archive_<base>_YYYYMMDD.HHMMSS[_NNN]<ext>".
+     *
+     * @param baseFileName Base name of the log.
+     * @param name         File name without directory.
+     * @param key          Timestamp part used for ordering.
+     * @return true if the name belongs to this log and has a known codec extension.
+     */
+    static bool parseArchiveName(const std::string &baseFileName, const std::string &name, std::string &key);
+
+    /**
+     * @brief Find the backups, archives and active files of a log with one directory scan.
+     *
+     * @param workingDirectory Directory of the log.
+     * @param baseFileName     Base name of the log.
+     * @param backups          Txt backups, sorted oldest first.
+     * @param archives         Archives, sorted oldest first.
+     * @param activeFiles      "<base>.log" and "<base>.log<ext>" if present.
+     */
+    static void scanDirectory(const std::string &workingDirectory,
+                              const std::string &baseFileName,
+                              std::vector<ManifestEntry> &backups,
+                              std::vector<ManifestEntry> &archives,
+                              std::vector<std::string> &activeFiles);
+
+    /**
+     * @brief Build the manifest with a single directory scan.
+     */
+    void loadManifest();
+
+    /**
+     * @brief Add or update a backup or archive in the manifest.
+     *
+     * @param path File path, names of neither kind are ignored.
+     * @param size File size in bytes.
+     */
+    void recordFile(const std::string &path, std::uintmax_t size);
+
+    /**
+     * @brief Drop a file from the manifest.
+     *
+     * @param path File path.
+     */
+    void forgetFile(const std::string &path);
+
 public:
     /**
      * @brief Construct a TXTLog instance.
@@ -272,12 +998,18 @@ public:
      * @param maxFileSize        Maximum allowed size of a log file in bytes.
      * @param maxTxtBackups      Number of .txt backup files to keep.
      * @param maxArchiveFiles    Maximum number of backup archive files.
+     * @param bufferSize         User-space write buffer in bytes, 0 writes through.
+     * @param maxBufferAgeMs     Maximum time data may stay in the buffer.
+     * @param multiProcess       Share the files with other processes from the start, see setMultiProcess().
      */
     TXTLog(const std::string &workingDirectory = ".",
            const std::string &baseFileName = "log.log",
            std::size_t maxFileSize = 20971520,
            std::size_t maxTxtBackups = 3,
-           std::size_t maxArchiveFiles = 10);
+           std::size_t maxArchiveFiles = 10,
+           std::size_t bufferSize = 0,
+           long maxBufferAgeMs = 1000,
+           bool multiProcess = false);
 
     /**
      * @brief Destructor.
@@ -292,6 +1024,11 @@ public:
      * If writing the data causes the file to exceed the maximum size,
      * file rotation will be performed automatically.
      *
+     * With a user-space buffer configured the data is appended to the buffer
+     * and only reaches the file once the buffer is full, once the oldest
+     * buffered byte is older than the maximum buffer age, or on an explicit
+     * flush. A file may then exceed the maximum size by up to one buffer.
+     *
      * @param data Text data to be written.
      * @return true if the write operation succeeds, false otherwise.
      */
@@ -299,9 +1036,390 @@ public:
 
     /**
      * @brief Flush buffered data to disk.
+     *
+     * Drains the user-space buffer and then calls fsync(). The sync runs
+     * on a duplicate of the descriptor after the writer lock is released,
+     * so other writers are not blocked while the disk catches up. A
+     * memory-mapped file is msync()ed the same way, up to the offset
+     * reached when the lock was held.
      */
     void flush();
 
+    /**
+     * @brief Choose when written data is made durable.
+     *
+     * DURABILITY_NONE (default) leaves it to the kernel and to explicit
+     * flush() calls. DURABILITY_INTERVAL runs fdatasync() every @p value
+     * milliseconds on the maintenance worker, together with a buffer flush,
+     * so at most that much data is lost on a power failure.
+     * DURABILITY_BYTES asks the worker for an fdatasync() each time
+     * @p value more bytes were written. In neither case does a writer wait
+     * for the disk. DURABILITY_CRITICAL syncs before write() returns, but
+     * only for writes holding a Debug record with the CRITICAL level tag
+     * ("[C]"): everything written up to and including such a record is on
+     * disk when its write() returns, while other records cost nothing
+     * extra.
+     *
+     * With io_uring the worker's syncs are queued on the ring like
+     * flush(). In the memory-mapped mode fdatasync() also writes back the
+     * pages copied into the mapping.
+     *
+     * @param policy Durability policy.
+     * @param value  Milliseconds for DURABILITY_INTERVAL, bytes for
+     *               DURABILITY_BYTES, ignored otherwise.
+     */
+    void setDurability(DurabilityPolicy policy, std::size_t value = 0);
+
+    /**
+     * @brief Get the durability policy.
+     *
+     * @return Active policy.
+     */
+    DurabilityPolicy getDurability() const;
+
+    /**
+     * @brief Drain the user-space buffer into the file without fsync().
+     *
+     * @return true if the buffer is empty or was written, false otherwise.
+     */
+    bool flushBuffer();
+
+    /**
+     * @brief Drain the user-space buffer if its oldest data exceeded the maximum age.
+     *
+     * The maintenance worker calls it when the oldest pending data reaches
+     * the maximum age, so records reach the file even if no other write
+     * follows. Data queued on the io_uring backend is submitted the same way.
+     *
+     * @return true if nothing was pending or the buffer was written, false otherwise.
+     */
+    bool flushExpired();
+
+    /**
+     * @brief Configure the user-space write buffer.
+     *
+     * Pending data is flushed before the new configuration applies.
+     *
+     * @param bufferSize     Buffer size in bytes, 0 disables buffering.
+     * @param maxBufferAgeMs Maximum time data may stay in the buffer.
+     */
+    void setBufferSize(std::size_t bufferSize, long maxBufferAgeMs = 1000);
+
+    /**
+     * @brief Get the user-space write buffer size.
+     *
+     * @return Buffer size in bytes, 0 when writes go straight to the file.
+     */
+    std::size_t getBufferSize() const;
+
+    /**
+     * @brief Choose where archiving and retention run after a rotation.
+     *
+     * Enabled by default: rotation renames and reopens the file under the
+     * writer lock and a worker thread compresses and prunes backups while
+     * writes continue. When disabled the work runs inline in the writing
+     * thread, as before.
+     *
+     * @param enable true to use the worker thread.
+     */
+    void setBackgroundMaintenance(bool enable);
+
+    /**
+     * @brief Check whether archiving runs on the worker thread.
+     *
+     * @return true if background maintenance is enabled.
+     */
+    bool isBackgroundMaintenance() const;
+
+    /**
+     * @brief Block until no maintenance pass is pending or running.
+     */
+    void waitForMaintenance();
+
+    /**
+     * @brief Configure the threads used to compress backups.
+     *
+     * With more than one thread a burst of backups is compressed in parallel
+     * and codecs that support it (xz) compress a single backup with several
+     * threads.
+     *
+     * @param threads Number of threads, 0 uses every available core, 1 (default) is single-threaded.
+     */
+    void setArchiveThreads(std::uint32_t threads);
+
+    /**
+     * @brief Get the configured number of archive threads.
+     *
+     * @return Number of threads, 0 means every available core.
+     */
+    std::uint32_t getArchiveThreads() const;
+
+    /**
+     * @brief Select the codec used for new archives.
+     *
+     * The codec decides the archive extension. Existing archives of other
+     * known codecs are still counted for retention and extracted for
+     * snapshots. The default is XzCodec at preset 6 with CRC64.
+     *
+     * @param codec Codec instance, nullptr is ignored.
+     */
+    void setCodec(const std::shared_ptr<TXTLogCodec> &codec);
+
+    /**
+     * @brief Get the codec used for new archives.
+     *
+     * @return Active codec.
+     */
+    std::shared_ptr<TXTLogCodec> getCodec() const;
+
+    /**
+     * @brief Compress data while writing instead of after rotation.
+     *
+     * The active file becomes "<base>.log<ext>" and every buffer flush
+     * appends one complete, independent codec stream to it, so all flushed
+     * data can be decoded after a crash (a stream cut short by the crash is
+     * the only loss). On rotation the file is renamed straight into an
+     * archive; no plain text backup is written and nothing is compressed a
+     * second time. The maximum file size applies to the compressed size.
+     *
+     * Small flushes compress poorly, so enabling this mode without a
+     * user-space buffer sets a 256 KB buffer.
+     *
+     * @param enable true to write compressed streams.
+     */
+    void setCompressedStreaming(bool enable);
+
+    /**
+     * @brief Write through a preallocated, memory-mapped active file.
+     *
+     * The active file is sized to the maximum file size up front with
+     * fallocate() and mapped shared. A writer reserves its range by
+     * advancing an atomic offset and copies into the mapping, with no
+     * lock and no system call; only the writer finding the file full takes
+     * the lock to rotate. On rotation, on close() and before query(),
+     * extractTimeRange() or a snapshot read the file, it is truncated to
+     * the bytes actually written; the next write maps it again. Everything
+     * copied survives a crash of the process (the page cache belongs to
+     * the kernel); flush() calls msync().
+     *
+     * Until it is truncated the file ends with zeros, which other readers
+     * of the live file see. After a crash the zero tail is cut when the
+     * file is opened in this mode again. The user-space buffer, group
+     * commit and io_uring are bypassed while the mode is on, and it cannot
+     * be combined with the compress-as-you-write mode. If preallocating or
+     * mapping fails the mode switches itself off and writes continue with
+     * write().
+     *
+     * @param enable true to map the active file.
+     * @return false if the mode cannot be enabled.
+     */
+    bool setMappedFile(bool enable);
+
+    /**
+     * @brief Check whether the memory-mapped mode is on.
+     *
+     * @return true if writes copy into a mapping.
+     */
+    bool isMappedFile() const;
+
+    /**
+     * @brief Let concurrent writers share write() system calls.
+     *
+     * In group-commit mode a writer queues its record and the first writer
+     * to find no leader becomes one: it takes the writer lock, collects
+     * every record queued so far and writes them with one writev(). The
+     * others sleep until their batch is written and return its result, or
+     * take over as the next leader. No extra thread is involved. Rotation
+     * is checked once per batch, so a file may exceed the maximum size by
+     * up to one batch.
+     *
+     * A single writer gains nothing; the mode pays off with many threads
+     * logging without a user-space buffer.
+     *
+     * @param enable true to enable group commit.
+     */
+    void setGroupCommit(bool enable);
+
+    /**
+     * @brief Check whether group commit is enabled.
+     *
+     * @return true if writes are grouped.
+     */
+    bool isGroupCommit() const;
+
+    /**
+     * @brief Write through a Linux io_uring instance instead of write().
+     *
+     * Appends are copied into a pool of registered buffers and submitted as
+     * asynchronous writes at explicit offsets; completions are reaped in
+     * batches on later writes without extra system calls. Without a
+     * user-space buffer records are submitted once a pool buffer's worth is
+     * queued or the oldest exceeded the maximum buffer age, by the
+     * maintenance worker's timer if no write follows, and on
+     * flushBuffer(), flushExpired() and flush(). flush() queues
+     * an fdatasync() behind the pending writes and returns without waiting
+     * for it. The rotation rename runs through the ring after the writes of
+     * the old file completed. Data is on disk, and visible to readers of
+     * the file, once its write completed: close(), rotation, query(),
+     * extractTimeRange() and snapshots wait for that.
+     *
+     * A write error is reported by the write() or flush() that reaps its
+     * completion, not necessarily by the call that queued the data.
+     *
+     * When io_uring is unavailable (old kernel, seccomp, or a build with
+     * __DISABLE_IO_URING) the call fails and writes stay synchronous.
+     *
+     * @param enable      true to use io_uring, false to go back to write().
+     * @param bufferSize  Size of one pool buffer in bytes.
+     * @param bufferCount Number of pool buffers.
+     * @return true if the requested backend is active.
+     */
+    bool setIoUring(bool enable, std::size_t bufferSize = 65536, std::size_t bufferCount = 16);
+
+    /**
+     * @brief Check whether writes go through io_uring.
+     *
+     * @return true if the io_uring backend is active.
+     */
+    bool isIoUring() const;
+
+    /**
+     * @brief Share the log files with other processes.
+     *
+     * Processes pointing at the same working directory and base name then
+     * append to one active file instead of each keeping its own. They
+     * coordinate through "<base>.lock", whose first bytes hold a small
+     * control block with the size of the active file and a rotation
+     * generation. Every append is one write() to an O_APPEND descriptor,
+     * done under a shared byte lock of that file, so records of different
+     * processes never interleave as long as each record goes out in a
+     * single call (on Linux this holds for regular files of any size,
+     * like writes up to PIPE_BUF do for pipes). The process that finds the
+     * file full takes the lock exclusively, checks the size again and
+     * rotates; the others reopen the new file on their next write. Archiving
+     * and retention run in one process at a time and rescan the directory,
+     * so each backup is archived once. The locks belong to open file
+     * descriptions, a crashed process releases them.
+     *
+     * A process joining files that others may already be writing passes
+     * multiProcess to the constructor, so its first size check, and the
+     * rotation it may trigger, already run under the shared lock. Enabling
+     * the mode here afterwards suits a file nobody else writes yet. It
+     * cannot be combined with the memory-mapped, io_uring or
+     * compress-as-you-write modes, which write at offsets only one process
+     * knows.
+     *
+     * @param enable true to coordinate with other processes.
+     * @return false if the mode cannot be enabled.
+     */
+    bool setMultiProcess(bool enable);
+
+    /**
+     * @brief Check whether the log files are shared with other processes.
+     *
+     * @return true if the multi-process mode is on.
+     */
+    bool isMultiProcess() const;
+
+    /**
+     * @brief Check whether the compress-as-you-write mode is active.
+     *
+     * @return true if the active file holds compressed streams.
+     */
+    bool isCompressedStreaming() const;
+
+    /**
+     * @brief Write seekable archives with a sidecar time index.
+     *
+     * New archives are made of independently compressed blocks of about
+     * @p blockSize bytes, cut at line boundaries, and "<archive>.idx" maps
+     * every block to its byte range and to the first and last Debug
+     * timestamp it holds. Such archives still decode as a whole with any
+     * xz or gzip tool. In the compress-as-you-write mode every flushed
+     * stream is one block and the index grows with the active file.
+     *
+     * Smaller blocks make range extraction read less at a small cost in
+     * compression ratio.
+     *
+     * @param enable    true to index new archives.
+     * @param blockSize Uncompressed bytes per block, at least 4 KB.
+     */
+    void setIndexedArchives(bool enable, std::size_t blockSize = 1048576);
+
+    /**
+     * @brief Check whether new archives are written seekable with an index.
+     *
+     * @return true if archives are indexed.
+     */
+    bool isIndexedArchives() const;
+
+    /**
+     * @brief Extract every log line written inside a time window.
+     *
+     * Archives, txt backups and the active file are searched from oldest to
+     * newest. Indexed archives only decode the blocks overlapping the window;
+     * archives without a usable index are decoded completely. Lines are
+     * matched by their Debug timestamp "[YYMMDD_HHMMSS.mmm]" (local time);
+     * lines without one follow the closest timestamped line before them, and
+     * lines before any timestamp are always included. Writers only wait
+     * while the file set and the active file length are captured; the files
+     * are pinned and read after the writer mutex is released, so lines
+     * written meanwhile are not included.
+     *
+     * @param from       Window start, inclusive.
+     * @param to         Window end, inclusive up to the last millisecond of that second.
+     * @param outputFile File receiving the matching lines.
+     * @return true if the output was written, false otherwise.
+     */
+    bool extractTimeRange(std::time_t from, std::time_t to, const std::string &outputFile);
+
+    /**
+     * @brief Search the archives, txt backups and active file for records.
+     *
+     * Every file is scanned by its own worker (up to one per core) and the
+     * results are merged in time order; records of equal time keep file
+     * order. A record is a line starting with a Debug header
+     * "[YYMMDD_HHMMSS.mmm] [L]: " together with the lines that follow it
+     * without a header. Lines before the first header of a file are
+     * separate records without time or level, returned only when the query
+     * has neither a time bound nor a minimum level above INFO.
+     * Writers only wait while the file set and the active file length are
+     * captured; the pinned files are scanned after the writer mutex is
+     * released, so records written meanwhile are not returned.
+     *
+     * @param query   Filter.
+     * @param records Matching records are appended here.
+     * @return true on success, false if the pattern is not a valid regular expression.
+     */
+    bool query(const Query &query, std::vector<Record> &records);
+
+    /**
+     * @brief Search the log files of a directory without opening it as a writer.
+     *
+     * Nothing is created, locked or rotated: the directory is scanned once
+     * and every file is opened read-only, so it is safe to use next to a
+     * running logger. The active file is "<base>.log" or, in
+     * compress-as-you-write mode, "<base>.log<ext>"; a memory-mapped one is
+     * read up to its last record. Files the logger archives or removes
+     * while the search runs may be missed.
+     *
+     * @param workingDirectory Directory of the log.
+     * @param baseFileName     Base name of the log.
+     * @param query            Filter, see query().
+     * @param records          Matching records are appended here.
+     * @return true on success, false if the pattern is not a valid regular expression.
+     */
+    static bool queryDirectory(const std::string &workingDirectory, const std::string &baseFileName, const Query &query, std::vector<Record> &records);
+
+    /**
+     * @brief Get the total size of the txt backups and archives.
+     *
+     * Taken from the manifest, no file is touched.
+     *
+     * @return Size in bytes, the active file is not included.
+     */
+    std::uintmax_t getStoredSize() const;
+
     /**
      * @brief Close the active log file.
      */
@@ -321,6 +1439,33 @@ public:
      */
     std::size_t getMaxFileSize() const;
 
+    /**
+     * @brief Choose when the active file is rotated.
+     *
+     * Time limits are turned into a deadline, in epoch seconds, whenever
+     * the active file is opened; writes only compare it with a coarse
+     * clock, and skip even that under ROTATE_SIZE. Hourly and daily
+     * deadlines are aligned to local time, so files cover whole hours or
+     * days. Like the size, the deadline is checked when data reaches the
+     * file: a file is rotated by the first write after its deadline, never
+     * while idle, and a file that stayed empty is kept for the next period.
+     * Records held in the user-space buffer may land in the next file, by
+     * at most the maximum buffer age. Backups keep their usual timestamped
+     * names, the time of rotation. The memory-mapped mode still cuts files
+     * at the maximum size under ROTATE_HOURLY and ROTATE_DAILY.
+     *
+     * @param policy        When to rotate.
+     * @param maxAgeSeconds Age limit for ROTATE_SIZE_OR_AGE, at least 1 second.
+     */
+    void setRotationPolicy(RotationPolicy policy, long maxAgeSeconds = 0);
+
+    /**
+     * @brief Get the rotation policy.
+     *
+     * @return The current policy.
+     */
+    RotationPolicy getRotationPolicy() const;
+
 #ifndef __DISABLE_MINIZIP
     /**
      * @brief Creates a ZIP snapshot containing all currently stored log files.
@@ -329,22 +1474,25 @@ public:
      *
      * 1. All active and rotated plain-text log files (.log) currently present
      *    in the working directory.
-     * 2. All archived log files (.xz), which are first decompressed into
-     *    temporary .log files before being added into the ZIP archive.
+     * 2. All archived log files (.xz, .gz), decompressed into .log entries.
      *
      * Workflow:
-     * - Acquire internal mutex to ensure thread safety during snapshot creation.
-     * - Enumerate all available .log files (including the active log file).
-     * - Add each .log file directly into the ZIP archive.
-     * - Enumerate all .xz archive files.
-     * - For each .xz file:
-     *      a. Decompress into a temporary .log file.
-     *      b. Add the temporary file into the ZIP archive.
-     *      c. Remove the temporary extracted file immediately after insertion.
-     * - Close the ZIP archive.
+     * - Under the writer mutex: drain the write buffer, enumerate the files,
+     *   pin each one with a hard link (see pinFile()) and note
+     *   the current length of the active file. Writers are released as soon
+     *   as this is done.
+     * - Worker threads decode the archives in snapshot order, each at most a
+     *   few chunks ahead of the ZIP writer, so decoded data is never stored
+     *   on disk and memory stays bounded.
+     * - The calling thread writes the entries in order: archives first, then
+     *   txt backups, then the active file up to the noted length.
+     * - The pinning links are removed.
+     *
+     * Rotation and retention may run meanwhile; pinned files stay readable
+     * until the snapshot is done.
      *
      * The resulting ZIP archive will contain only .log entries,
-     * regardless of whether their source was a plain log file or an .xz archive.
+     * regardless of whether their source was a plain log file or an archive.
      *
      * @param zipFilePath Absolute or relative path where the resulting ZIP archive will be created.
      *
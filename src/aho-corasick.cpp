@@ -0,0 +1,128 @@
+#include <queue>
+#include <algorithm>
+#include "aho-corasick.hpp"
+
+AhoCorasick::AhoCorasick() : patterns(), byteClass(), classes(1), transitions(), matchLength()
+{
+    this->byteClass.fill(0);
+}
+
+AhoCorasick::~AhoCorasick() {}
+
+void AhoCorasick::add(const std::string &pattern)
+{
+    if (pattern.empty())
+        return;
+    this->patterns.push_back(pattern);
+}
+
+void AhoCorasick::clear()
+{
+    this->patterns.clear();
+    this->byteClass.fill(0);
+    this->classes = 1;
+    this->transitions.clear();
+    this->matchLength.clear();
+}
+
+bool AhoCorasick::isEmpty() const
+{
+    return this->transitions.empty();
+}
+
+void AhoCorasick::build()
+{
+    this->byteClass.fill(0);
+    this->classes = 1;
+    this->transitions.clear();
+    this->matchLength.clear();
+    if (this->patterns.empty())
+        return;
+
+    /* class 0 is shared by every byte that never occurs in a pattern */
+    for (const std::string &pattern : this->patterns)
+    {
+        for (unsigned char c : pattern)
+        {
+            if (this->byteClass[c] == 0)
+                this->byteClass[c] = static_cast<uint16_t>(this->classes++);
+        }
+    }
+
+    const std::size_t width = this->classes;
+    this->transitions.assign(width, -1);
+    this->matchLength.assign(1, 0);
+
+    /* trie */
+    for (const std::string &pattern : this->patterns)
+    {
+        int32_t state = 0;
+        for (unsigned char c : pattern)
+        {
+            std::size_t idx = static_cast<std::size_t>(state) * width + this->byteClass[c];
+            if (this->transitions[idx] < 0)
+            {
+                this->transitions[idx] = static_cast<int32_t>(this->matchLength.size());
+                this->transitions.resize(this->transitions.size() + width, -1);
+                this->matchLength.push_back(0);
+            }
+            state = this->transitions[static_cast<std::size_t>(state) * width + this->byteClass[c]];
+        }
+        this->matchLength[state] = std::max(this->matchLength[state], static_cast<uint32_t>(pattern.size()));
+    }
+
+    /* failure links folded into a full transition table (breadth first) */
+    std::vector<int32_t> fail(this->matchLength.size(), 0);
+    std::queue<int32_t> pending;
+    for (std::size_t c = 0; c < width; c++)
+    {
+        int32_t &next = this->transitions[c];
+        if (next < 0)
+        {
+            next = 0;
+        }
+        else
+        {
+            fail[next] = 0;
+            pending.push(next);
+        }
+    }
+
+    while (!pending.empty())
+    {
+        int32_t state = pending.front();
+        pending.pop();
+        this->matchLength[state] = std::max(this->matchLength[state], this->matchLength[fail[state]]);
+        for (std::size_t c = 0; c < width; c++)
+        {
+            std::size_t idx = static_cast<std::size_t>(state) * width + c;
+            int32_t fallback = this->transitions[static_cast<std::size_t>(fail[state]) * width + c];
+            if (this->transitions[idx] < 0)
+            {
+                this->transitions[idx] = fallback;
+            }
+            else
+            {
+                fail[this->transitions[idx]] = fallback;
+                pending.push(this->transitions[idx]);
+            }
+        }
+    }
+}
+
+void AhoCorasick::scan(const char *data, std::size_t size, const std::function<void(std::size_t, std::size_t)> &callback) const
+{
+    if (this->transitions.empty())
+        return;
+
+    const std::size_t width = this->classes;
+    const int32_t *table = this->transitions.data();
+    int32_t state = 0;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        state = table[static_cast<std::size_t>(state) * width + this->byteClass[static_cast<unsigned char>(data[i])]];
+        uint32_t length = this->matchLength[state];
+        if (length)
+            callback(i + 1 - length, length);
+    }
+}
@@ -0,0 +1,192 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <iostream>
+#include <cstring>
+
+#include "debug-sink.hpp"
+#include "txtlog.hpp"
+
+/* ================= DebugSink ================= */
+
+DebugSink::DebugSink() : level(Debug::INFO) {}
+
+DebugSink::~DebugSink() {}
+
+void DebugSink::setLevel(Debug::LogType_t level)
+{
+    this->level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+Debug::LogType_t DebugSink::getLevel() const
+{
+    return static_cast<Debug::LogType_t>(this->level.load(std::memory_order_relaxed));
+}
+
+void DebugSink::flush() {}
+
+/* ================= StdoutSink ================= */
+
+StdoutSink::StdoutSink() {}
+
+StdoutSink::~StdoutSink() {}
+
+void StdoutSink::write(Debug::LogType_t type, const std::string &payload)
+{
+    (void)type;
+    std::cout.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+}
+
+void StdoutSink::flush()
+{
+    std::cout.flush();
+}
+
+/* ================= NullSink ================= */
+
+NullSink::NullSink() {}
+
+NullSink::~NullSink() {}
+
+void NullSink::write(Debug::LogType_t type, const std::string &payload)
+{
+    (void)type;
+    (void)payload;
+}
+
+/* ================= FileSink ================= */
+
+thread_local bool FileSink::writing = false;
+
+FileSink::FileSink(const std::string &workingDirectory,
+                   const std::string &baseFileName,
+                   std::size_t maxFileSize,
+                   std::size_t maxTxtBackups,
+                   std::size_t maxArchiveFiles,
+                   std::size_t bufferSize,
+                   long maxBufferAgeMs) : txtlog(new TXTLog(workingDirectory, baseFileName, maxFileSize, maxTxtBackups, maxArchiveFiles,
+                                                            bufferSize, maxBufferAgeMs))
+{
+}
+
+FileSink::~FileSink()
+{
+    this->flush();
+}
+
+void FileSink::write(Debug::LogType_t type, const std::string &payload)
+{
+    if (FileSink::writing)
+        return;
+    /* TXTLog reports through Debug, do not feed those lines back into this sink */
+    FileSink::writing = true;
+    this->txtlog->write(payload);
+    /* a critical record is not held back */
+    if (type == Debug::CRITICAL)
+        this->txtlog->flushBuffer();
+    FileSink::writing = false;
+}
+
+void FileSink::flush()
+{
+    if (FileSink::writing)
+        return;
+    FileSink::writing = true;
+    this->txtlog->flushBuffer();
+    FileSink::writing = false;
+}
+
+/* ================= MemorySink ================= */
+
+MemorySink::MemorySink(std::size_t capacity, std::size_t maxRecords) : mutex(), ring(capacity, maxRecords) {}
+
+MemorySink::~MemorySink() {}
+
+void MemorySink::write(Debug::LogType_t type, const std::string &payload)
+{
+    (void)type;
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->ring.push(payload.data(), payload.size());
+}
+
+std::string MemorySink::getContent() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::string result;
+    result.reserve(this->ring.bytes());
+    this->ring.iteration([&](const char *data, std::size_t length)
+                         {
+                             result.append(data, length);
+                             return true; });
+    return result;
+}
+
+void MemorySink::iteration(const std::function<bool(const char *, std::size_t)> &callback) const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->ring.iteration(callback);
+}
+
+std::size_t MemorySink::size() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->ring.size();
+}
+
+void MemorySink::clear()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->ring.clear();
+}
+
+/* ================= UnixDatagramSink ================= */
+
+UnixDatagramSink::UnixDatagramSink(const std::string &socketPath) : socketDescriptor(-1),
+                                                                    socketPath(socketPath),
+                                                                    dropped(0)
+{
+    if (socketPath.size() >= sizeof(sockaddr_un::sun_path))
+        return;
+
+    this->socketDescriptor = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (this->socketDescriptor < 0)
+        return;
+
+    /* not connected: the receiver may come and go, every datagram is addressed */
+}
+
+UnixDatagramSink::~UnixDatagramSink()
+{
+    if (this->socketDescriptor >= 0)
+        ::close(this->socketDescriptor);
+}
+
+bool UnixDatagramSink::isOpen() const
+{
+    return this->socketDescriptor >= 0;
+}
+
+std::size_t UnixDatagramSink::getDropped() const
+{
+    return this->dropped.load(std::memory_order_relaxed);
+}
+
+void UnixDatagramSink::write(Debug::LogType_t type, const std::string &payload)
+{
+    (void)type;
+    if (this->socketDescriptor < 0)
+    {
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, this->socketPath.c_str(), this->socketPath.size() + 1);
+    ssize_t sent = ::sendto(this->socketDescriptor, payload.data(), payload.size(), MSG_DONTWAIT | MSG_NOSIGNAL,
+                            reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    if (sent != static_cast<ssize_t>(payload.size()))
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+}
@@ -22,7 +22,6 @@
  */
 
 #include <iostream>
-#include <sstream>
 #include <string>
 #include <vector>
 #include <chrono>
@@ -30,29 +29,412 @@
 #include <iomanip>
 #include <algorithm>
 #include <array>
+#include <cstdint>
+#include <thread>
+#include <condition_variable>
 #include "debug.hpp"
+#include "debug-sink.hpp"
 #include "txtlog.hpp"
+#include "mpsc-queue.hpp"
 
+class Debug::AsyncWriter
+{
+private:
+    MPSCQueue<Record> queue;
+    std::thread worker;
+    std::mutex waitMutex;
+    std::condition_variable wakeup;
+    std::condition_variable drained;
+    std::atomic<bool> running;
+    std::atomic<bool> sleeping;
+    std::atomic<std::size_t> pushed;
+    std::atomic<std::size_t> written;
+
+    void run();
+
+public:
+    static thread_local bool isConsumer;
+
+    explicit AsyncWriter(std::size_t capacity);
+    ~AsyncWriter();
+
+    void push(Record &&record);
+    void flush();
+    void stop();
+};
+
+thread_local bool Debug::AsyncWriter::isConsumer = false;
+
+class Debug::StreamRegistry
+{
+public:
+    struct Batch
+    {
+        std::mutex mutex;
+        std::string data;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Batch>> batches;
+    /* writes batches that age out while their thread stays quiet, started with the first batch */
+    std::thread timer;
+    std::condition_variable timerCondition;
+    std::chrono::steady_clock::time_point deadline;
+    bool stopping;
+
+    StreamRegistry() : mutex(), batches(), timer(), timerCondition(), deadline(std::chrono::steady_clock::time_point::max()), stopping(false) {}
+
+    ~StreamRegistry()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->timerCondition.notify_all();
+        if (this->timer.joinable())
+            this->timer.join();
+        this->flushAll(false);
+    }
+
+    std::shared_ptr<Batch> acquire()
+    {
+        std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->batches.push_back(batch);
+        return batch;
+    }
+
+    void release(const std::shared_ptr<Batch> &batch)
+    {
+        {
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            StreamRegistry::write(*batch);
+        }
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->batches.erase(std::remove(this->batches.begin(), this->batches.end(), batch), this->batches.end());
+    }
+
+    /* called when a batch starts, wakes the timer if it is due earlier than the current wakeup */
+    void schedule(std::chrono::steady_clock::time_point due)
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (this->stopping || due >= this->deadline)
+                return;
+            this->deadline = due;
+            if (!this->timer.joinable())
+                this->timer = std::thread(&StreamRegistry::run, this);
+        }
+        this->timerCondition.notify_one();
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (!this->stopping)
+        {
+            if (this->deadline == std::chrono::steady_clock::time_point::max())
+            {
+                this->timerCondition.wait(lock);
+                continue;
+            }
+            if (std::chrono::steady_clock::now() < this->deadline)
+            {
+                this->timerCondition.wait_until(lock, this->deadline);
+                continue;
+            }
+            this->deadline = std::chrono::steady_clock::time_point::max();
+            lock.unlock();
+            std::chrono::steady_clock::time_point next = this->flushAll(true);
+            lock.lock();
+            this->deadline = std::min(this->deadline, next);
+        }
+    }
+
+    /* returns when the oldest batch left behind expires */
+    std::chrono::steady_clock::time_point flushAll(bool onlyExpired)
+    {
+        std::vector<std::shared_ptr<Batch>> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            snapshot = this->batches;
+        }
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point next = std::chrono::steady_clock::time_point::max();
+        std::chrono::milliseconds age(Debug::streamBatchAge.load(std::memory_order_relaxed));
+        for (const std::shared_ptr<Batch> &batch : snapshot)
+        {
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            if (!onlyExpired || now - batch->since >= age)
+                StreamRegistry::write(*batch);
+            else if (!batch->data.empty())
+                next = std::min(next, batch->since + age);
+        }
+        return next;
+    }
+
+    /* caller must hold batch.mutex */
+    static void write(Batch &batch)
+    {
+        if (batch.data.empty())
+            return;
+        /* a reference keeps the file alive if setupTXTLogFile() replaces it meanwhile */
+        std::shared_ptr<TXTLog> txtlog = std::atomic_load(&Debug::txtlog);
+        if (txtlog)
+        {
+            /* TXTLog logs through Debug itself, keep those lines out of the batch */
+            Debug::streamFlushing = true;
+            txtlog->write(batch.data);
+            Debug::streamFlushing = false;
+        }
+        batch.data.clear();
+    }
+};
+
+std::atomic<int> Debug::minLevel(Debug::INFO);
 std::size_t Debug::maxLineLogs = 0;
-std::deque<std::string> Debug::history;
-std::unique_ptr<TXTLog> Debug::txtlog;
+std::size_t Debug::maxCacheBytes = 0;
+ByteRing Debug::history;
+std::shared_ptr<TXTLog> Debug::txtlog;
 std::mutex Debug::mutex;
+std::atomic<Debug::AsyncWriter *> Debug::asyncWriter(nullptr);
+std::atomic<std::size_t> Debug::asyncProducers(0);
+std::atomic<bool> Debug::streaming(false);
+std::atomic<std::size_t> Debug::streamBatchSize(65536);
+std::atomic<long> Debug::streamBatchAge(1000);
+thread_local bool Debug::streamFlushing = false;
+std::mutex Debug::sinkMutex;
+std::shared_ptr<const std::vector<std::shared_ptr<DebugSink>>> Debug::sinks(
+    new std::vector<std::shared_ptr<DebugSink>>(1, std::make_shared<StdoutSink>()));
+class Debug::RateLimiter
+{
+public:
+    static const std::size_t SLOTS = 1024;
+    static const std::size_t PROBES = 8;
 
-Debug::Debug() : confidential() {}
+    struct Slot
+    {
+        std::atomic<std::uint64_t> key;
+        std::atomic<long long> windowStart;
+        std::atomic<std::uint32_t> used;
+        std::atomic<std::uint32_t> suppressed;
 
-Debug::~Debug() {}
+        /* where the summary line points, published before the first suppressed count; the names are static strings */
+        std::atomic<bool> described;
+        std::atomic<int> type;
+        std::atomic<int> line;
+        std::atomic<const char *> sourceName;
+        std::atomic<const char *> functionName;
+    };
 
-std::string Debug::hideConfidential(const std::string &input) const
+    std::array<Slot, SLOTS> slots;
+    std::atomic<long long> lastSweep;
+
+    static std::uint64_t hash(const void *site, int line)
+    {
+        std::uint64_t h = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(site));
+        h ^= static_cast<std::uint64_t>(static_cast<unsigned int>(line)) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 32;
+        return h | 1;
+    }
+
+    Slot *find(const void *site, int line)
+    {
+        std::uint64_t key = RateLimiter::hash(site, line);
+        for (std::size_t i = 0; i < PROBES; i++)
+        {
+            Slot &slot = this->slots[(key + i) & (SLOTS - 1)];
+            std::uint64_t current = slot.key.load(std::memory_order_acquire);
+            if (current == key)
+                return &slot;
+            if (current == 0)
+            {
+                if (slot.key.compare_exchange_strong(current, key) || current == key)
+                    return &slot;
+            }
+        }
+        /* table crowded, this call site stays unlimited */
+        return nullptr;
+    }
+
+    void reset()
+    {
+        for (Slot &slot : this->slots)
+        {
+            slot.key.store(0);
+            slot.windowStart.store(0);
+            slot.used.store(0);
+            slot.suppressed.store(0);
+            slot.described.store(false);
+        }
+        this->lastSweep.store(0);
+    }
+};
+
+std::atomic<std::size_t> Debug::rateBurst(0);
+std::atomic<long> Debug::rateInterval(1000);
+Debug::RateLimiter Debug::rateLimiter;
+
+namespace
+{
+    /* sinks may log through Debug while they are torn down, detach them first */
+    struct SinkShutdown
+    {
+        ~SinkShutdown()
+        {
+            Debug::clearSinks();
+        }
+    } sinkShutdown;
+}
+/* destroyed before txtlog, pending batches are written on the way out */
+std::unique_ptr<Debug::StreamRegistry> Debug::streamRegistry(new Debug::StreamRegistry());
+/* defined last so the writer is drained before the sinks above are destroyed */
+std::unique_ptr<Debug::AsyncWriter> Debug::asyncOwner;
+
+Debug::AsyncWriter::AsyncWriter(std::size_t capacity) : queue(capacity),
+                                                         worker(),
+                                                         waitMutex(),
+                                                         wakeup(),
+                                                         drained(),
+                                                         running(true),
+                                                         sleeping(false),
+                                                         pushed(0),
+                                                         written(0)
+{
+    this->worker = std::thread(&Debug::AsyncWriter::run, this);
+}
+
+Debug::AsyncWriter::~AsyncWriter()
+{
+    Debug::asyncWriter.store(nullptr);
+    /* producers that already picked up the writer must finish their push */
+    while (Debug::asyncProducers.load() != 0)
+    {
+        std::this_thread::yield();
+    }
+    this->stop();
+}
+
+void Debug::AsyncWriter::push(Record &&record)
 {
-    std::string result = input;
-    for (const std::string &conf : this->confidential)
+    while (!this->queue.tryEnqueue(std::move(record)))
     {
-        size_t pos = input.find(conf);
-        if (pos != std::string::npos)
+        /* queue full, let the writer catch up */
+        this->wakeup.notify_one();
+        std::this_thread::yield();
+    }
+    this->pushed.fetch_add(1);
+    if (this->sleeping.load())
+    {
+        std::lock_guard<std::mutex> lock(this->waitMutex);
+        this->wakeup.notify_one();
+    }
+}
+
+void Debug::AsyncWriter::flush()
+{
+    std::size_t target = this->pushed.load();
+    std::unique_lock<std::mutex> lock(this->waitMutex);
+    this->wakeup.notify_one();
+    this->drained.wait(lock, [&]()
+                       { return this->written.load() >= target; });
+}
+
+void Debug::AsyncWriter::stop()
+{
+    if (!this->worker.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(this->waitMutex);
+        this->running.store(false);
+        this->wakeup.notify_one();
+    }
+    this->worker.join();
+}
+
+void Debug::AsyncWriter::run()
+{
+    AsyncWriter::isConsumer = true;
+
+    Record record;
+    for (;;)
+    {
+        std::size_t n = 0;
+        while (n < 1024 && this->queue.tryDequeue(record))
         {
-            result.replace(pos, conf.length(), "*****");
+            Debug::render(record);
+            Debug::publish(static_cast<LogType_t>(record.type), record.text);
+            n++;
         }
+
+        if (n)
+        {
+            this->written.fetch_add(n);
+            std::lock_guard<std::mutex> lock(this->waitMutex);
+            this->drained.notify_all();
+            continue;
+        }
+
+        Debug::flushSinks();
+        if (Debug::streaming.load(std::memory_order_relaxed))
+            Debug::flushStream(true);
+        std::unique_lock<std::mutex> lock(this->waitMutex);
+        if (!this->running.load() && this->queue.isEmpty())
+            break;
+        this->sleeping.store(true);
+        /* the timeout bounds the latency of a wakeup racing with sleeping */
+        this->wakeup.wait_for(lock, std::chrono::milliseconds(10), [&]()
+                              { return !this->queue.isEmpty() || !this->running.load(); });
+        this->sleeping.store(false);
     }
+}
+
+Debug::Debug() : confidential(), confidentialMatcher(), level(Debug::INFO) {}
+
+Debug::Debug(const Debug &other) : confidential(other.confidential),
+                                   confidentialMatcher(other.confidentialMatcher),
+                                   level(other.level.load()) {}
+
+Debug &Debug::operator=(const Debug &other)
+{
+    this->confidential = other.confidential;
+    this->confidentialMatcher = other.confidentialMatcher;
+    this->level.store(other.level.load());
+    return *this;
+}
+
+Debug::~Debug() {}
+
+std::string Debug::hideConfidential(const std::string &input) const
+{
+    /* merge overlapping matches, then replace each covered range once */
+    std::vector<std::pair<std::size_t, std::size_t>> ranges;
+    this->confidentialMatcher.scan(input.data(), input.size(), [&](std::size_t start, std::size_t length)
+                                   {
+                                       std::size_t end = start + length;
+                                       while (!ranges.empty() && ranges.back().second > start)
+                                       {
+                                           start = std::min(start, ranges.back().first);
+                                           ranges.pop_back();
+                                       }
+                                       ranges.emplace_back(start, end); });
+
+    if (ranges.empty())
+        return input;
+
+    std::string result;
+    result.reserve(input.size());
+    std::size_t pos = 0;
+    for (const std::pair<std::size_t, std::size_t> &range : ranges)
+    {
+        result.append(input, pos, range.first - pos);
+        result.append("*****");
+        pos = range.second;
+    }
+    result.append(input, pos, std::string::npos);
     return result;
 }
 
@@ -98,14 +480,15 @@ void Debug::cache(const std::string &payload)
     if (Debug::maxLineLogs)
     {
         std::lock_guard<std::mutex> lock(mutex);
-        if (Debug::history.size() >= Debug::maxLineLogs)
-            Debug::history.pop_front();
-        Debug::history.emplace_back(payload);
+        Debug::history.push(payload.data(), payload.size());
     }
 }
 
 void Debug::log(LogType_t type, const char *functionName, const char *format, ...)
 {
+    if (!this->isLoggable(type) || !Debug::admit(type, format, 0, nullptr, functionName))
+        return;
+
     va_list args;
     va_start(args, format);
     std::string logPayload = this->generate(type, functionName, format, args);
@@ -113,73 +496,99 @@ void Debug::log(LogType_t type, const char *functionName, const char *format, ..
 
     if (this->confidential.empty())
     {
-        std::cout << logPayload;
-        this->cache(logPayload);
+        Debug::dispatch(type, std::move(logPayload));
+    }
+    else
+    {
+        Debug::dispatch(type, this->hideConfidential(logPayload));
+    }
+}
+
+void Debug::logAt(LogType_t type, const char *sourceName, int line, const char *functionName, const char *format, ...)
+{
+    if (!this->isLoggable(type) || !Debug::admit(type, sourceName ? sourceName : format, line, sourceName, functionName))
+        return;
+
+    va_list args;
+    va_start(args, format);
+    std::string logPayload = Debug::generate(type, sourceName, line, functionName, format, args);
+    va_end(args);
+
+    if (this->confidential.empty())
+    {
+        Debug::dispatch(type, std::move(logPayload));
     }
     else
     {
-        std::string logEntry = this->hideConfidential(logPayload);
-        std::cout << logEntry;
-        this->cache(logEntry);
+        Debug::dispatch(type, this->hideConfidential(logPayload));
     }
 }
 
 void Debug::info(const char *functionName, const char *format, ...)
 {
+    if (!this->isLoggable(Debug::INFO) || !Debug::admit(Debug::INFO, format, 0, nullptr, functionName))
+        return;
+
     va_list args;
     va_start(args, format);
     std::string logPayload = this->generate(Debug::INFO, functionName, format, args);
     va_end(args);
 
-    std::cout << logPayload;
-    this->cache(logPayload);
+    Debug::dispatch(Debug::INFO, std::move(logPayload));
 }
 
 void Debug::warning(const char *functionName, const char *format, ...)
 {
+    if (!this->isLoggable(Debug::WARNING) || !Debug::admit(Debug::WARNING, format, 0, nullptr, functionName))
+        return;
+
     va_list args;
     va_start(args, format);
     std::string logPayload = this->generate(Debug::WARNING, functionName, format, args);
     va_end(args);
 
-    std::cout << logPayload;
-    this->cache(logPayload);
+    Debug::dispatch(Debug::WARNING, std::move(logPayload));
 }
 
 void Debug::error(const char *functionName, const char *format, ...)
 {
+    if (!this->isLoggable(Debug::ERROR) || !Debug::admit(Debug::ERROR, format, 0, nullptr, functionName))
+        return;
+
     va_list args;
     va_start(args, format);
     std::string logPayload = this->generate(Debug::ERROR, functionName, format, args);
     va_end(args);
 
-    std::cout << logPayload;
-    this->cache(logPayload);
+    Debug::dispatch(Debug::ERROR, std::move(logPayload));
 }
 
 void Debug::critical(const char *functionName, const char *format, ...)
 {
+    if (!this->isLoggable(Debug::CRITICAL) || !Debug::admit(Debug::CRITICAL, format, 0, nullptr, functionName))
+        return;
+
     va_list args;
     va_start(args, format);
     std::string logPayload = this->generate(Debug::CRITICAL, functionName, format, args);
     va_end(args);
 
-    std::cout << logPayload;
-    this->cache(logPayload);
+    Debug::dispatch(Debug::CRITICAL, std::move(logPayload));
 }
 
 std::string Debug::getLogHistory()
 {
-    std::ostringstream oss;
+    std::string result;
     if (Debug::maxLineLogs)
     {
         std::lock_guard<std::mutex> lock(mutex);
-        for (const std::string &s : Debug::history)
-        {
-            oss << s;
-        }
+        result.reserve(Debug::history.bytes());
+        Debug::history.iteration([&](const char *line, std::size_t length)
+                                 {
+                                     result.append(line, length);
+                                     return true; });
     }
-    return oss.str();
+    return result;
 }
 
 void Debug::historyIteration(const std::function<bool(const char *)> &callback)
@@ -187,144 +596,230 @@ void Debug::historyIteration(const std::function<bool(const char *)> &callback)
     if (Debug::maxLineLogs)
     {
         std::lock_guard<std::mutex> lock(mutex);
-        for (const std::string &s : Debug::history)
-        {
-            callback(s.c_str());
-        }
+        Debug::history.iteration([&](const char *line, std::size_t)
+                                 {
+                                     callback(line);
+                                     return true; });
     }
 }
 
 void Debug::clearLogHistory()
 {
+    std::lock_guard<std::mutex> lock(mutex);
     Debug::history.clear();
 }
 
 void Debug::setConfidential(const std::string &confidential)
 {
     this->confidential.push_back(confidential);
+    this->confidentialMatcher.add(confidential);
+    this->confidentialMatcher.build();
+}
+
+void Debug::setLevel(LogType_t level)
+{
+    this->level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+Debug::LogType_t Debug::getLevel() const
+{
+    return static_cast<LogType_t>(this->level.load(std::memory_order_relaxed));
+}
+
+void Debug::setLogLevel(LogType_t level)
+{
+    Debug::minLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+Debug::LogType_t Debug::getLogLevel()
+{
+    return static_cast<LogType_t>(Debug::minLevel.load(std::memory_order_relaxed));
 }
 
 void Debug::setMaxLinesLogCache(std::size_t max)
 {
+    std::lock_guard<std::mutex> lock(mutex);
     Debug::maxLineLogs = max;
     if (Debug::maxLineLogs == 0)
+    {
         Debug::history.clear();
-    else if (Debug::maxLineLogs == Debug::history.size())
-        Debug::history.pop_front();
-    else if (Debug::maxLineLogs < Debug::history.size())
+        Debug::history.setCapacity(0);
+        return;
+    }
+    Debug::history.setMaxRecords(Debug::maxLineLogs);
+    /* leave room for the next line like before */
+    while (!(Debug::history.size() < Debug::maxLineLogs))
     {
-        while (!(Debug::history.size() < Debug::maxLineLogs))
-        {
-            Debug::history.pop_front();
-        }
+        Debug::history.pop();
     }
+    Debug::history.setCapacity(Debug::maxCacheBytes ? Debug::maxCacheBytes : Debug::maxLineLogs * 512);
+}
+
+void Debug::setLogCacheSize(std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Debug::maxCacheBytes = bytes;
+    if (Debug::maxLineLogs)
+        Debug::history.setCapacity(bytes ? bytes : Debug::maxLineLogs * 512);
 }
 
 void Debug::log(Debug::LogType_t type, const char *sourceName, int line, const char *functionName, const char *format, ...)
 {
+    if (!Debug::isEnabled(type) || !Debug::admit(type, sourceName ? sourceName : format, line, sourceName, functionName))
+        return;
+
     va_list args;
     va_start(args, format);
     std::string logPayload = Debug::generate(type, sourceName, line, functionName, format, args);
     va_end(args);
 
-    std::cout << logPayload;
-    Debug::cache(logPayload);
+    Debug::dispatch(type, std::move(logPayload));
 }
 
 void Debug::info(const char *sourceName, int line, const char *functionName, const char *format, ...)
 {
+    if (!Debug::isEnabled(Debug::INFO) || !Debug::admit(Debug::INFO, sourceName ? sourceName : format, line, sourceName, functionName))
+        return;
+
     va_list args;
     va_start(args, format);
     std::string logPayload = Debug::generate(Debug::INFO, sourceName, line, functionName, format, args);
     va_end(args);
 
-    std::cout << logPayload;
-    Debug::cache(logPayload);
+    Debug::dispatch(Debug::INFO, std::move(logPayload));
 }
 
 void Debug::warning(const char *sourceName, int line, const char *functionName, const char *format, ...)
 {
+    if (!Debug::isEnabled(Debug::WARNING) || !Debug::admit(Debug::WARNING, sourceName ? sourceName : format, line, sourceName, functionName))
+        return;
+
     va_list args;
     va_start(args, format);
     std::string logPayload = Debug::generate(Debug::WARNING, sourceName, line, functionName, format, args);
     va_end(args);
 
-    std::cout << logPayload;
-    Debug::cache(logPayload);
+    Debug::dispatch(Debug::WARNING, std::move(logPayload));
 }
 
 void Debug::error(const char *sourceName, int line, const char *functionName, const char *format, ...)
 {
+    if (!Debug::isEnabled(Debug::ERROR) || !Debug::admit(Debug::ERROR, sourceName ? sourceName : format, line, sourceName, functionName))
+        return;
+
     va_list args;
     va_start(args, format);
     std::string logPayload = Debug::generate(Debug::ERROR, sourceName, line, functionName, format, args);
     va_end(args);
 
-    std::cout << logPayload;
-    Debug::cache(logPayload);
+    Debug::dispatch(Debug::ERROR, std::move(logPayload));
 }
 
 void Debug::critical(const char *sourceName, int line, const char *functionName, const char *format, ...)
 {
+    if (!Debug::isEnabled(Debug::CRITICAL) || !Debug::admit(Debug::CRITICAL, sourceName ? sourceName : format, line, sourceName, functionName))
+        return;
+
     va_list args;
     va_start(args, format);
     std::string logPayload = Debug::generate(Debug::CRITICAL, sourceName, line, functionName, format, args);
     va_end(args);
 
-    std::cout << logPayload;
-    Debug::cache(logPayload);
+    Debug::dispatch(Debug::CRITICAL, std::move(logPayload));
 }
 
-std::string Debug::generate(Debug::LogType_t type,
-                            const char *sourceName,
-                            int line,
-                            const char *functionName,
-                            const char *format,
-                            va_list args)
+void Debug::formatTimestamp(char *buffer, const std::chrono::system_clock::time_point &timestamp)
 {
-    std::chrono::time_point<std::chrono::system_clock> tnow = std::chrono::system_clock::now();
-    std::time_t now = std::chrono::system_clock::to_time_t(tnow);
-    std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(tnow.time_since_epoch()) % 1000;
-    std::tm localTime{};
-#if defined(_MSC_VER)
-    localtime_s(&localTime, &now);
-#else
-    localtime_r(&now, &localTime);
-#endif
-
-    std::array<char, 1024> localBuf{};
-    std::size_t offset = 27 + strlen(functionName);
+    /* "[YYMMDD_HHMMSS." only changes once per second, keep it per thread */
+    struct PrefixCache
+    {
+        std::time_t second;
+        char prefix[15];
+    };
+    static thread_local PrefixCache cached = {static_cast<std::time_t>(-1), {}};
 
-    if (sourceName)
+    std::time_t now = std::chrono::system_clock::to_time_t(timestamp);
+    long ms = static_cast<long>((std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()) % 1000).count());
+    if (ms < 0)
     {
-        char sourcen[128]{};
-        snprintf(sourcen, 127, "%s:%d → ", Debug::extractFileName(sourceName), line);
-        offset += strlen(sourcen);
+        ms += 1000;
+        now -= 1;
+    }
 
-        std::snprintf(localBuf.data(), offset + 1,
-                      "[%02d%02d%02d_%02d%02d%02d.%03ld] [%c]: %s%s: ",
+    if (now != cached.second)
+    {
+        std::tm localTime{};
+#if defined(_MSC_VER)
+        localtime_s(&localTime, &now);
+#else
+        localtime_r(&now, &localTime);
+#endif
+        /* sized for six full ints so the compiler can prove nothing is cut, the fields take two digits */
+        char prefix[72];
+        std::snprintf(prefix, sizeof(prefix), "[%02d%02d%02d_%02d%02d%02d.",
                       (localTime.tm_year % 100),
                       (localTime.tm_mon + 1),
                       localTime.tm_mday,
                       localTime.tm_hour,
                       localTime.tm_min,
-                      localTime.tm_sec,
-                      static_cast<long>(ms.count()),
-                      Debug::logTypeToChar(type), sourcen, functionName);
+                      localTime.tm_sec);
+        std::memcpy(cached.prefix, prefix, sizeof(cached.prefix));
+        cached.second = now;
     }
-    else
+
+    std::memcpy(buffer, cached.prefix, sizeof(cached.prefix));
+    buffer[15] = static_cast<char>('0' + ms / 100);
+    buffer[16] = static_cast<char>('0' + (ms / 10) % 10);
+    buffer[17] = static_cast<char>('0' + ms % 10);
+    buffer[18] = ']';
+}
+
+std::size_t Debug::generateHeader(char *buffer,
+                                  std::size_t size,
+                                  Debug::LogType_t type,
+                                  const char *sourceName,
+                                  int line,
+                                  const char *functionName,
+                                  const std::chrono::system_clock::time_point &timestamp)
+{
+    char header[32];
+    Debug::formatTimestamp(header, timestamp);
+    std::memcpy(header + 19, " [?]: ", 6);
+    header[21] = Debug::logTypeToChar(type);
+
+    char sourcen[128]{};
+    std::size_t sourceLength = 0;
+    if (sourceName)
     {
-        std::snprintf(localBuf.data(), offset + 1,
-                      "[%02d%02d%02d_%02d%02d%02d.%03ld] [%c]: %s: ",
-                      (localTime.tm_year % 100),
-                      (localTime.tm_mon + 1),
-                      localTime.tm_mday,
-                      localTime.tm_hour,
-                      localTime.tm_min,
-                      localTime.tm_sec,
-                      static_cast<long>(ms.count()),
-                      Debug::logTypeToChar(type), functionName);
+        snprintf(sourcen, 127, "%s:%d → ", Debug::extractFileName(sourceName), line);
+        sourceLength = strlen(sourcen);
     }
+    std::size_t functionLength = strlen(functionName);
+
+    /* same layout as "%s%s%s: " with header, source and function name */
+    std::size_t limit = size - 1;
+    std::size_t offset = 0;
+    const char *parts[4] = {header, sourcen, functionName, ": "};
+    std::size_t lengths[4] = {25, sourceLength, functionLength, 2};
+    for (int i = 0; i < 4 && offset < limit; i++)
+    {
+        std::size_t n = std::min(lengths[i], limit - offset);
+        std::memcpy(buffer + offset, parts[i], n);
+        offset += n;
+    }
+    buffer[offset] = '\0';
+    return offset;
+}
+
+std::string Debug::generate(Debug::LogType_t type,
+                            const char *sourceName,
+                            int line,
+                            const char *functionName,
+                            const char *format,
+                            va_list args)
+{
+    std::array<char, 1024> localBuf{};
+    std::size_t offset = Debug::generateHeader(localBuf.data(), localBuf.size(), type, sourceName, line, functionName, std::chrono::system_clock::now());
 
     va_list argsCopy;
     va_copy(argsCopy, args);
@@ -336,7 +831,7 @@ std::string Debug::generate(Debug::LogType_t type,
     if (needed < 0)
     {
         std::copy_n("[format-error]\n", 15, localBuf.data() + offset);
-        result.assign(localBuf.data(), strlen(localBuf.data()));
+        result.assign(localBuf.data(), offset + 15);
     }
     else if (static_cast<size_t>(needed + offset) < localBuf.size())
     {
@@ -347,10 +842,46 @@ std::string Debug::generate(Debug::LogType_t type,
         result.resize(static_cast<size_t>(needed) + offset + 1);
         std::copy_n(localBuf.begin(), offset, result.begin());
         std::vsnprintf((char *)(result.data() + offset), result.size() - offset, format, args);
+        result.pop_back();
     }
     return result;
 }
 
+void Debug::render(Record &record)
+{
+    if (!record.formatter)
+        return;
+
+    std::array<char, 1024> localBuf{};
+    std::size_t offset = Debug::generateHeader(localBuf.data(),
+                                               localBuf.size(),
+                                               static_cast<LogType_t>(record.type),
+                                               record.sourceName,
+                                               record.line,
+                                               record.functionName,
+                                               record.timestamp);
+
+    int needed = record.formatter(localBuf.data() + offset, localBuf.size() - offset, record.format, record.args.data());
+
+    if (needed < 0)
+    {
+        record.text.assign(localBuf.data(), offset);
+        record.text.append("[format-error]\n");
+    }
+    else if (static_cast<size_t>(needed + offset) < localBuf.size())
+    {
+        record.text.assign(localBuf.data(), static_cast<std::size_t>(needed + offset));
+    }
+    else
+    {
+        record.text.resize(static_cast<size_t>(needed) + offset + 1);
+        std::copy_n(localBuf.begin(), offset, record.text.begin());
+        record.formatter(&record.text[offset], record.text.size() - offset, record.format, record.args.data());
+        record.text.pop_back();
+    }
+    record.formatter = nullptr;
+}
+
 std::string Debug::generate(LogType_t type,
                             const char *sourceName,
                             int line,
@@ -371,15 +902,282 @@ void Debug::setupTXTLogFile(const std::string &workingDirectory,
                             std::size_t maxTxtBackups,
                             std::size_t maxArchiveFiles)
 {
-    Debug::txtlog.reset(new TXTLog(workingDirectory, baseFileName, maxFileSize, maxTxtBackups, maxArchiveFiles));
+    Debug::flushStream(false);
+    std::atomic_store(&Debug::txtlog, std::make_shared<TXTLog>(workingDirectory, baseFileName, maxFileSize, maxTxtBackups, maxArchiveFiles));
 }
 
 void Debug::moveLogHistoryToFile()
 {
-    if (Debug::txtlog.get())
+    std::shared_ptr<TXTLog> txtlog = std::atomic_load(&Debug::txtlog);
+    if (txtlog)
     {
+        /* streamed lines are not cached, what is left predates streaming */
+        if (Debug::streaming.load())
+            Debug::flushStream(false);
         std::string toWrite = Debug::getLogHistory();
         Debug::clearLogHistory();
-        Debug::txtlog->write(toWrite);
+        Debug::streamFlushing = true;
+        txtlog->write(toWrite);
+        Debug::streamFlushing = false;
+    }
+}
+
+void Debug::setTXTLogStreaming(bool enable, std::size_t batchSize, long maxBatchAgeMs)
+{
+    Debug::streamBatchSize.store(batchSize);
+    Debug::streamBatchAge.store(maxBatchAgeMs);
+    Debug::streaming.store(enable);
+    if (!enable)
+        Debug::flushStream(false);
+}
+
+bool Debug::isTXTLogStreaming()
+{
+    return Debug::streaming.load(std::memory_order_relaxed);
+}
+
+bool Debug::stream(const std::string &payload)
+{
+    struct ThreadBatch
+    {
+        std::shared_ptr<StreamRegistry::Batch> batch;
+
+        ~ThreadBatch()
+        {
+            if (this->batch && Debug::streamRegistry.get())
+                Debug::streamRegistry->release(this->batch);
+        }
+    };
+    static thread_local ThreadBatch local;
+
+    if (Debug::streamFlushing || !std::atomic_load(&Debug::txtlog) || !Debug::streamRegistry.get())
+        return false;
+    if (!local.batch)
+        local.batch = Debug::streamRegistry->acquire();
+
+    StreamRegistry::Batch &batch = *local.batch;
+    std::chrono::milliseconds age(Debug::streamBatchAge.load(std::memory_order_relaxed));
+    std::chrono::steady_clock::time_point due = std::chrono::steady_clock::time_point::max();
+    {
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (batch.data.empty())
+        {
+            batch.since = now;
+            due = now + age;
+        }
+        batch.data += payload;
+        if (batch.data.size() >= Debug::streamBatchSize.load(std::memory_order_relaxed) || now - batch.since >= age)
+        {
+            StreamRegistry::write(batch);
+            due = std::chrono::steady_clock::time_point::max();
+        }
+    }
+    /* the timer writes the batch if this thread goes quiet before it is full */
+    if (due != std::chrono::steady_clock::time_point::max())
+        Debug::streamRegistry->schedule(due);
+    return true;
+}
+
+void Debug::flushStream(bool onlyExpired)
+{
+    if (Debug::streamRegistry.get() && !Debug::streamFlushing)
+        Debug::streamRegistry->flushAll(onlyExpired);
+}
+
+bool Debug::startAsync(std::size_t queueCapacity)
+{
+    if (Debug::asyncOwner.get())
+        return false;
+    Debug::asyncOwner.reset(new AsyncWriter(queueCapacity));
+    Debug::asyncWriter.store(Debug::asyncOwner.get());
+    return true;
+}
+
+void Debug::stopAsync()
+{
+    Debug::asyncOwner.reset();
+}
+
+bool Debug::isAsync()
+{
+    return Debug::asyncWriter.load(std::memory_order_relaxed) != nullptr;
+}
+
+void Debug::flush()
+{
+    if (Debug::rateBurst.load(std::memory_order_relaxed) != 0)
+        Debug::reportSuppressed(false);
+    Debug::asyncProducers.fetch_add(1);
+    AsyncWriter *writer = Debug::asyncWriter.load();
+    if (writer && !AsyncWriter::isConsumer)
+        writer->flush();
+    Debug::asyncProducers.fetch_sub(1);
+    Debug::flushSinks();
+    Debug::flushStream(false);
+}
+
+void Debug::setRateLimit(std::size_t burst, long intervalMs)
+{
+    Debug::rateBurst.store(0);
+    Debug::rateLimiter.reset();
+    Debug::rateInterval.store(intervalMs > 0 ? intervalMs : 1);
+    Debug::rateBurst.store(burst);
+}
+
+bool Debug::admitSlow(LogType_t type, const void *site, int line, const char *sourceName, const char *functionName)
+{
+    RateLimiter::Slot *slot = Debug::rateLimiter.find(site, line);
+    if (!slot)
+        return true;
+
+    long long now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    long long windowStart = slot->windowStart.load(std::memory_order_relaxed);
+    if (now - windowStart >= Debug::rateInterval.load(std::memory_order_relaxed) &&
+        slot->windowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed))
+    {
+        /* bucket refilled, the thread that wins the refill reports the storm */
+        slot->used.store(0, std::memory_order_relaxed);
+        std::uint32_t suppressed = slot->suppressed.exchange(0, std::memory_order_relaxed);
+        if (suppressed)
+        {
+            Debug::dispatch(type, Debug::generate(type, sourceName, line, functionName ? functionName : "",
+                                                  "last message repeated %u times\n", static_cast<unsigned int>(suppressed)));
+        }
+    }
+
+    /* storms at sites that went quiet are reported by whoever logs next */
+    long long interval = Debug::rateInterval.load(std::memory_order_relaxed);
+    long long lastSweep = Debug::rateLimiter.lastSweep.load(std::memory_order_relaxed);
+    if (now - lastSweep >= interval &&
+        Debug::rateLimiter.lastSweep.compare_exchange_strong(lastSweep, now, std::memory_order_relaxed))
+    {
+        Debug::reportSuppressed(true);
+    }
+
+    if (slot->used.fetch_add(1, std::memory_order_relaxed) < Debug::rateBurst.load(std::memory_order_relaxed))
+        return true;
+    if (!slot->described.load(std::memory_order_acquire))
+    {
+        slot->type.store(type, std::memory_order_relaxed);
+        slot->line.store(line, std::memory_order_relaxed);
+        slot->sourceName.store(sourceName, std::memory_order_relaxed);
+        slot->functionName.store(functionName, std::memory_order_relaxed);
+        slot->described.store(true, std::memory_order_release);
+    }
+    /* released so the summary that takes this count also sees the site above */
+    slot->suppressed.fetch_add(1, std::memory_order_release);
+    return false;
+}
+
+void Debug::reportSuppressed(bool onlyExpired)
+{
+    long long now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    long long interval = Debug::rateInterval.load(std::memory_order_relaxed);
+    for (RateLimiter::Slot &slot : Debug::rateLimiter.slots)
+    {
+        if (slot.suppressed.load(std::memory_order_relaxed) == 0 ||
+            (onlyExpired && now - slot.windowStart.load(std::memory_order_relaxed) < interval))
+            continue;
+        std::uint32_t suppressed = slot.suppressed.exchange(0, std::memory_order_acquire);
+        if (!suppressed)
+            continue;
+
+        LogType_t type = static_cast<LogType_t>(slot.type.load(std::memory_order_relaxed));
+        const char *functionName = slot.functionName.load(std::memory_order_relaxed);
+        Debug::dispatch(type, Debug::generate(type, slot.sourceName.load(std::memory_order_relaxed), slot.line.load(std::memory_order_relaxed),
+                                              functionName ? functionName : "",
+                                              "last message repeated %u times\n", static_cast<unsigned int>(suppressed)));
     }
-}
\ No newline at end of file
+}
+
+void Debug::dispatch(LogType_t type, std::string &&payload)
+{
+    if (Debug::asyncWriter.load(std::memory_order_relaxed) && !AsyncWriter::isConsumer)
+    {
+        Debug::dispatch(Record(type, std::move(payload)));
+        return;
+    }
+    Debug::publish(type, payload);
+}
+
+void Debug::dispatch(Record &&record)
+{
+    if (Debug::asyncWriter.load(std::memory_order_relaxed) && !AsyncWriter::isConsumer)
+    {
+        Debug::asyncProducers.fetch_add(1);
+        AsyncWriter *writer = Debug::asyncWriter.load();
+        if (writer)
+        {
+            writer->push(std::move(record));
+            Debug::asyncProducers.fetch_sub(1);
+            return;
+        }
+        Debug::asyncProducers.fetch_sub(1);
+    }
+    /* async mode went away meanwhile, render on the calling thread */
+    Debug::render(record);
+    Debug::publish(static_cast<LogType_t>(record.type), record.text);
+}
+
+void Debug::publish(LogType_t type, const std::string &payload)
+{
+    /* a streamed line is on its way to the file, only the others wait in the history */
+    if (!Debug::streaming.load(std::memory_order_relaxed) || !Debug::stream(payload))
+        Debug::cache(payload);
+
+    std::shared_ptr<const std::vector<std::shared_ptr<DebugSink>>> current = std::atomic_load(&Debug::sinks);
+    for (const std::shared_ptr<DebugSink> &sink : *current)
+    {
+        if (sink->accepts(type))
+            sink->write(type, payload);
+    }
+}
+
+void Debug::flushSinks()
+{
+    std::shared_ptr<const std::vector<std::shared_ptr<DebugSink>>> current = std::atomic_load(&Debug::sinks);
+    for (const std::shared_ptr<DebugSink> &sink : *current)
+    {
+        sink->flush();
+    }
+}
+
+void Debug::addSink(const std::shared_ptr<DebugSink> &sink)
+{
+    if (!sink)
+        return;
+    std::lock_guard<std::mutex> lock(Debug::sinkMutex);
+    std::shared_ptr<std::vector<std::shared_ptr<DebugSink>>> updated(
+        new std::vector<std::shared_ptr<DebugSink>>(*std::atomic_load(&Debug::sinks)));
+    updated->push_back(sink);
+    std::atomic_store(&Debug::sinks, std::shared_ptr<const std::vector<std::shared_ptr<DebugSink>>>(updated));
+}
+
+void Debug::removeSink(const std::shared_ptr<DebugSink> &sink)
+{
+    std::lock_guard<std::mutex> lock(Debug::sinkMutex);
+    std::shared_ptr<std::vector<std::shared_ptr<DebugSink>>> updated(
+        new std::vector<std::shared_ptr<DebugSink>>(*std::atomic_load(&Debug::sinks)));
+    updated->erase(std::remove(updated->begin(), updated->end(), sink), updated->end());
+    std::atomic_store(&Debug::sinks, std::shared_ptr<const std::vector<std::shared_ptr<DebugSink>>>(updated));
+}
+
+void Debug::clearSinks()
+{
+    std::lock_guard<std::mutex> lock(Debug::sinkMutex);
+    std::atomic_store(&Debug::sinks, std::shared_ptr<const std::vector<std::shared_ptr<DebugSink>>>(
+                                         new std::vector<std::shared_ptr<DebugSink>>()));
+}
+
+void Debug::resetSinks()
+{
+    std::lock_guard<std::mutex> lock(Debug::sinkMutex);
+    std::atomic_store(&Debug::sinks, std::shared_ptr<const std::vector<std::shared_ptr<DebugSink>>>(
+                                         new std::vector<std::shared_ptr<DebugSink>>(1, std::make_shared<StdoutSink>())));
+}
+
+std::size_t Debug::getSinksNumber()
+{
+    return std::atomic_load(&Debug::sinks)->size();
+}
@@ -0,0 +1,590 @@
+#include <sys/stat.h>
+
+#include <lzma.h>
+#ifndef __DISABLE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "debug.hpp"
+#include "txtlog-codec.hpp"
+
+namespace
+{
+    const std::size_t BUFFER_SIZE = 256 * 1024;
+
+    bool endsWith(const std::string &value, const char *suffix)
+    {
+        std::size_t length = std::strlen(suffix);
+        return value.size() >= length && value.compare(value.size() - length, length, suffix) == 0;
+    }
+
+    lzma_check toLzmaCheck(XzCodec::CHECK check)
+    {
+        switch (check)
+        {
+        case XzCodec::CHECK_NONE:
+            return LZMA_CHECK_NONE;
+        case XzCodec::CHECK_CRC32:
+            return LZMA_CHECK_CRC32;
+        case XzCodec::CHECK_SHA256:
+            return LZMA_CHECK_SHA256;
+        default:
+            return LZMA_CHECK_CRC64;
+        }
+    }
+}
+
+/* ================= TXTLogCodec ================= */
+
+const int TXTLogCodec::PRESET_AUTO;
+
+TXTLogCodec::TXTLogCodec(int preset) : preset(preset), effectivePreset(0) {}
+
+TXTLogCodec::~TXTLogCodec() {}
+
+void TXTLogCodec::setPreset(int preset)
+{
+    if (preset == TXTLogCodec::PRESET_AUTO)
+    {
+        this->preset.store(preset);
+        this->effectivePreset.store(this->defaultPreset());
+        return;
+    }
+    preset = std::min(std::max(preset, this->minPreset()), this->maxPreset());
+    this->preset.store(preset);
+    this->effectivePreset.store(preset);
+}
+
+int TXTLogCodec::getPreset() const
+{
+    return this->preset.load();
+}
+
+int TXTLogCodec::getEffectivePreset() const
+{
+    return this->effectivePreset.load();
+}
+
+void TXTLogCodec::tune(double incomingBytesPerSecond, double compressBytesPerSecond)
+{
+    if (this->preset.load() != TXTLogCodec::PRESET_AUTO || incomingBytesPerSecond <= 0 || compressBytesPerSecond <= 0)
+        return;
+
+    int current = this->effectivePreset.load();
+    int next = current;
+    if (compressBytesPerSecond < incomingBytesPerSecond * 2.0)
+        next = std::max(current - 1, this->minPreset());
+    else if (compressBytesPerSecond > incomingBytesPerSecond * 8.0)
+        next = std::min(current + 1, this->maxPreset());
+
+    if (next != current)
+    {
+        this->effectivePreset.store(next);
+        Debug::info(__FILE__, __LINE__, __func__, "%s preset %d -> %d (in %.0f B/s, compress %.0f B/s)\n",
+                    this->name(), current, next, incomingBytesPerSecond, compressBytesPerSecond);
+    }
+}
+
+std::shared_ptr<TXTLogCodec> TXTLogCodec::forArchive(const std::string &archiveFile)
+{
+    if (endsWith(archiveFile, ".xz"))
+        return std::make_shared<XzCodec>();
+#ifndef __DISABLE_ZLIB
+    if (endsWith(archiveFile, ".gz"))
+        return std::make_shared<GzipCodec>();
+#endif
+    return nullptr;
+}
+
+bool TXTLogCodec::isArchiveName(const std::string &fileName)
+{
+    return endsWith(fileName, ".xz") || endsWith(fileName, ".gz");
+}
+
+bool TXTLogCodec::decompressBuffer(const char *data, std::size_t size, std::string &output)
+{
+    return this->decompressBuffer(data, size, [&output](const char *chunk, std::size_t length)
+                                  {
+                                      output.append(chunk, length);
+                                      return true; });
+}
+
+/* ================= XzCodec ================= */
+
+XzCodec::XzCodec(int preset, CHECK check, std::size_t blockSize) : TXTLogCodec(preset),
+                                                                   check(check),
+                                                                   blockSize(blockSize)
+{
+    this->setPreset(preset);
+}
+
+XzCodec::~XzCodec() {}
+
+int XzCodec::defaultPreset() const
+{
+    return 3;
+}
+
+const char *XzCodec::name() const
+{
+    return "xz";
+}
+
+const char *XzCodec::extension() const
+{
+    return ".xz";
+}
+
+int XzCodec::minPreset() const
+{
+    return 0;
+}
+
+int XzCodec::maxPreset() const
+{
+    return 9;
+}
+
+void XzCodec::setCheck(CHECK check)
+{
+    this->check.store(check);
+}
+
+XzCodec::CHECK XzCodec::getCheck() const
+{
+    return static_cast<CHECK>(this->check.load());
+}
+
+void XzCodec::setBlockSize(std::size_t blockSize)
+{
+    this->blockSize.store(blockSize);
+}
+
+std::size_t XzCodec::getBlockSize() const
+{
+    return this->blockSize.load();
+}
+
+bool XzCodec::compress(const std::string &inputFile, const std::string &outputFile, std::uint32_t threads)
+{
+    std::ifstream input(inputFile, std::ios::binary);
+    std::ofstream output(outputFile, std::ios::binary);
+    if (!input || !output)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed to open %s\n", inputFile.c_str());
+        return false;
+    }
+
+    lzma_check lzmaCheck = toLzmaCheck(this->getCheck());
+    std::uint32_t preset = static_cast<std::uint32_t>(this->getEffectivePreset());
+
+    lzma_stream stream = LZMA_STREAM_INIT;
+    lzma_ret initResult;
+    if (threads > 1)
+    {
+        /* one block per thread share of the file unless a block size was configured */
+        std::uint64_t blockSize = this->blockSize.load();
+        if (blockSize == 0)
+        {
+            struct stat st;
+            std::uint64_t fileSize = (::stat(inputFile.c_str(), &st) == 0) ? static_cast<std::uint64_t>(st.st_size) : 0;
+            blockSize = std::max<std::uint64_t>((fileSize + threads - 1) / threads, 1024 * 1024);
+        }
+
+        lzma_mt mt;
+        std::memset(&mt, 0, sizeof(mt));
+        mt.threads = threads;
+        mt.block_size = blockSize;
+        mt.timeout = 0;
+        mt.preset = preset;
+        mt.filters = nullptr;
+        mt.check = lzmaCheck;
+        initResult = lzma_stream_encoder_mt(&stream, &mt);
+    }
+    else
+    {
+        initResult = lzma_easy_encoder(&stream, preset, lzmaCheck);
+    }
+    if (initResult != LZMA_OK)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed to init encoder: %d\n", static_cast<int>(initResult));
+        return false;
+    }
+
+    std::vector<unsigned char> inBuffer(BUFFER_SIZE);
+    std::vector<unsigned char> outBuffer(BUFFER_SIZE);
+    lzma_action action = LZMA_RUN;
+
+    for (;;)
+    {
+        if (stream.avail_in == 0 && action == LZMA_RUN)
+        {
+            input.read(reinterpret_cast<char *>(inBuffer.data()), BUFFER_SIZE);
+            stream.avail_in = static_cast<std::size_t>(input.gcount());
+            stream.next_in = inBuffer.data();
+            if (input.eof())
+                action = LZMA_FINISH;
+        }
+
+        stream.avail_out = BUFFER_SIZE;
+        stream.next_out = outBuffer.data();
+
+        lzma_ret ret = lzma_code(&stream, action);
+        output.write(reinterpret_cast<char *>(outBuffer.data()), BUFFER_SIZE - stream.avail_out);
+
+        if (ret == LZMA_STREAM_END)
+            break;
+        if (ret != LZMA_OK)
+        {
+            lzma_end(&stream);
+            Debug::error(__FILE__, __LINE__, __func__, "failed to archive file %s\n", inputFile.c_str());
+            return false;
+        }
+    }
+    lzma_end(&stream);
+
+    output.close();
+    if (!output)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed to write %s\n", outputFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool XzCodec::decompress(const std::string &inputFile, const std::string &outputFile)
+{
+    std::ofstream output(outputFile, std::ios::binary);
+    if (!output)
+        return false;
+
+    bool result = this->decompressStream(inputFile, [&output](const char *data, std::size_t size)
+                                         {
+                                             output.write(data, static_cast<std::streamsize>(size));
+                                             return static_cast<bool>(output); });
+    output.close();
+    return result && static_cast<bool>(output);
+}
+
+bool XzCodec::decompressStream(const std::string &inputFile, const Consumer &consumer)
+{
+    std::ifstream input(inputFile, std::ios::binary);
+    if (!input)
+        return false;
+
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if (lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+        return false;
+
+    std::vector<uint8_t> inBuffer(BUFFER_SIZE);
+    std::vector<uint8_t> outBuffer(BUFFER_SIZE);
+    lzma_action action = LZMA_RUN;
+
+    for (;;)
+    {
+        if (stream.avail_in == 0 && action == LZMA_RUN)
+        {
+            input.read(reinterpret_cast<char *>(inBuffer.data()), BUFFER_SIZE);
+            stream.avail_in = static_cast<std::size_t>(input.gcount());
+            stream.next_in = inBuffer.data();
+            if (input.eof())
+                action = LZMA_FINISH;
+        }
+
+        stream.avail_out = BUFFER_SIZE;
+        stream.next_out = outBuffer.data();
+
+        lzma_ret ret = lzma_code(&stream, action);
+        std::size_t produced = BUFFER_SIZE - stream.avail_out;
+        if (produced > 0 && !consumer(reinterpret_cast<char *>(outBuffer.data()), produced))
+        {
+            lzma_end(&stream);
+            return false;
+        }
+
+        if (ret == LZMA_STREAM_END)
+            break;
+        if (ret != LZMA_OK)
+        {
+            lzma_end(&stream);
+            return false;
+        }
+    }
+
+    lzma_end(&stream);
+    return true;
+}
+
+bool XzCodec::compressBuffer(const char *data, std::size_t size, std::string &output)
+{
+    std::size_t offset = output.size();
+    output.resize(offset + lzma_stream_buffer_bound(size));
+
+    std::size_t position = offset;
+    lzma_ret ret = lzma_easy_buffer_encode(static_cast<std::uint32_t>(this->getEffectivePreset()),
+                                           toLzmaCheck(this->getCheck()),
+                                           nullptr,
+                                           reinterpret_cast<const uint8_t *>(data), size,
+                                           reinterpret_cast<uint8_t *>(&output[0]), &position, output.size());
+    output.resize(ret == LZMA_OK ? position : offset);
+    return ret == LZMA_OK;
+}
+
+bool XzCodec::decompressBuffer(const char *data, std::size_t size, const Consumer &consumer)
+{
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if (lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+        return false;
+
+    stream.next_in = reinterpret_cast<const uint8_t *>(data);
+    stream.avail_in = size;
+    std::vector<uint8_t> outBuffer(BUFFER_SIZE);
+    lzma_ret ret;
+    do
+    {
+        stream.avail_out = BUFFER_SIZE;
+        stream.next_out = outBuffer.data();
+        ret = lzma_code(&stream, LZMA_FINISH);
+        std::size_t produced = BUFFER_SIZE - stream.avail_out;
+        if (produced > 0 && !consumer(reinterpret_cast<char *>(outBuffer.data()), produced))
+        {
+            ret = LZMA_PROG_ERROR;
+            break;
+        }
+    } while (ret == LZMA_OK);
+
+    lzma_end(&stream);
+    return ret == LZMA_STREAM_END;
+}
+
+#ifndef __DISABLE_ZLIB
+/* ================= GzipCodec ================= */
+
+GzipCodec::GzipCodec(int preset) : TXTLogCodec(preset)
+{
+    this->setPreset(preset);
+}
+
+GzipCodec::~GzipCodec() {}
+
+int GzipCodec::defaultPreset() const
+{
+    return 6;
+}
+
+const char *GzipCodec::name() const
+{
+    return "gzip";
+}
+
+const char *GzipCodec::extension() const
+{
+    return ".gz";
+}
+
+int GzipCodec::minPreset() const
+{
+    return 1;
+}
+
+int GzipCodec::maxPreset() const
+{
+    return 9;
+}
+
+bool GzipCodec::compress(const std::string &inputFile, const std::string &outputFile, std::uint32_t threads)
+{
+    (void)threads;
+    std::ifstream input(inputFile, std::ios::binary);
+    std::ofstream output(outputFile, std::ios::binary);
+    if (!input || !output)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed to open %s\n", inputFile.c_str());
+        return false;
+    }
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    /* window bits 15 + 16 selects the gzip wrapper */
+    if (deflateInit2(&stream, this->getEffectivePreset(), Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed to init encoder\n");
+        return false;
+    }
+
+    std::vector<unsigned char> inBuffer(BUFFER_SIZE);
+    std::vector<unsigned char> outBuffer(BUFFER_SIZE);
+    int flush = Z_NO_FLUSH;
+
+    for (;;)
+    {
+        if (stream.avail_in == 0 && flush == Z_NO_FLUSH)
+        {
+            input.read(reinterpret_cast<char *>(inBuffer.data()), BUFFER_SIZE);
+            stream.avail_in = static_cast<uInt>(input.gcount());
+            stream.next_in = inBuffer.data();
+            if (input.eof())
+                flush = Z_FINISH;
+        }
+
+        stream.avail_out = static_cast<uInt>(BUFFER_SIZE);
+        stream.next_out = outBuffer.data();
+
+        int ret = deflate(&stream, flush);
+        output.write(reinterpret_cast<char *>(outBuffer.data()), BUFFER_SIZE - stream.avail_out);
+
+        if (ret == Z_STREAM_END)
+            break;
+        if (ret != Z_OK && ret != Z_BUF_ERROR)
+        {
+            deflateEnd(&stream);
+            Debug::error(__FILE__, __LINE__, __func__, "failed to archive file %s\n", inputFile.c_str());
+            return false;
+        }
+    }
+    deflateEnd(&stream);
+
+    output.close();
+    if (!output)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed to write %s\n", outputFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool GzipCodec::decompress(const std::string &inputFile, const std::string &outputFile)
+{
+    std::ofstream output(outputFile, std::ios::binary);
+    if (!output)
+        return false;
+
+    bool result = this->decompressStream(inputFile, [&output](const char *data, std::size_t size)
+                                         {
+                                             output.write(data, static_cast<std::streamsize>(size));
+                                             return static_cast<bool>(output); });
+    output.close();
+    return result && static_cast<bool>(output);
+}
+
+bool GzipCodec::decompressStream(const std::string &inputFile, const Consumer &consumer)
+{
+    std::ifstream input(inputFile, std::ios::binary);
+    if (!input)
+        return false;
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    /* window bits 15 + 32 detects the gzip header */
+    if (inflateInit2(&stream, 15 + 32) != Z_OK)
+        return false;
+
+    std::vector<unsigned char> inBuffer(BUFFER_SIZE);
+    std::vector<unsigned char> outBuffer(BUFFER_SIZE);
+    bool done = false;
+
+    while (!done)
+    {
+        if (stream.avail_in == 0)
+        {
+            input.read(reinterpret_cast<char *>(inBuffer.data()), BUFFER_SIZE);
+            stream.avail_in = static_cast<uInt>(input.gcount());
+            stream.next_in = inBuffer.data();
+            if (stream.avail_in == 0)
+                break;
+        }
+
+        stream.avail_out = static_cast<uInt>(BUFFER_SIZE);
+        stream.next_out = outBuffer.data();
+
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        std::size_t produced = BUFFER_SIZE - stream.avail_out;
+        if (produced > 0 && !consumer(reinterpret_cast<char *>(outBuffer.data()), produced))
+            break;
+
+        if (ret == Z_STREAM_END)
+        {
+            /* concatenated gzip members, continue with the next one */
+            if (stream.avail_in == 0 && input.peek() == std::char_traits<char>::eof())
+                done = true;
+            else
+                inflateReset(&stream);
+        }
+        else if (ret != Z_OK && ret != Z_BUF_ERROR)
+        {
+            break;
+        }
+    }
+
+    inflateEnd(&stream);
+    return done;
+}
+
+bool GzipCodec::compressBuffer(const char *data, std::size_t size, std::string &output)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, this->getEffectivePreset(), Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    std::size_t offset = output.size();
+    /* deflateBound does not account for the gzip header and trailer */
+    output.resize(offset + deflateBound(&stream, static_cast<uLong>(size)) + 18);
+
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = reinterpret_cast<Bytef *>(&output[offset]);
+    stream.avail_out = static_cast<uInt>(output.size() - offset);
+
+    int ret = deflate(&stream, Z_FINISH);
+    output.resize(ret == Z_STREAM_END ? offset + stream.total_out : offset);
+    deflateEnd(&stream);
+    return ret == Z_STREAM_END;
+}
+
+bool GzipCodec::decompressBuffer(const char *data, std::size_t size, const Consumer &consumer)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 15 + 32) != Z_OK)
+        return false;
+
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = static_cast<uInt>(size);
+    std::vector<unsigned char> outBuffer(BUFFER_SIZE);
+    bool done = false;
+
+    for (;;)
+    {
+        stream.avail_out = static_cast<uInt>(BUFFER_SIZE);
+        stream.next_out = outBuffer.data();
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        std::size_t produced = BUFFER_SIZE - stream.avail_out;
+        if (produced > 0 && !consumer(reinterpret_cast<char *>(outBuffer.data()), produced))
+            break;
+
+        if (ret == Z_STREAM_END)
+        {
+            if (stream.avail_in == 0)
+            {
+                done = true;
+                break;
+            }
+            inflateReset(&stream);
+        }
+        else if (ret != Z_OK)
+        {
+            /* Z_BUF_ERROR here means the input ended inside a member */
+            break;
+        }
+    }
+
+    inflateEnd(&stream);
+    return done;
+}
+#endif
@@ -0,0 +1,141 @@
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#include "txtlog-index.hpp"
+
+const char *TXTLogIndex::EXTENSION = ".idx";
+
+bool TXTLogIndex::Entry::overlaps(std::int64_t fromMs, std::int64_t toMs) const
+{
+    if (this->firstMs == 0 && this->lastMs == 0)
+        return true;
+    return this->firstMs <= toMs && this->lastMs >= fromMs;
+}
+
+TXTLogIndex::TimeParser::TimeParser() : prefix(), prefixMs(0), cached(false) {}
+
+bool TXTLogIndex::TimeParser::parse(const char *line, std::size_t length, std::int64_t &ms)
+{
+    /* [YYMMDD_HHMMSS.mmm] */
+    if (length < 19 || line[0] != '[' || line[7] != '_' || line[14] != '.' || line[18] != ']')
+        return false;
+    for (int i = 1; i < 18; i++)
+    {
+        if (i == 7 || i == 14)
+            continue;
+        if (line[i] < '0' || line[i] > '9')
+            return false;
+    }
+
+    if (!this->cached || std::memcmp(this->prefix, line + 1, sizeof(this->prefix)) != 0)
+    {
+        std::tm tmTime;
+        std::memset(&tmTime, 0, sizeof(tmTime));
+        tmTime.tm_year = 100 + (line[1] - '0') * 10 + (line[2] - '0');
+        tmTime.tm_mon = (line[3] - '0') * 10 + (line[4] - '0') - 1;
+        tmTime.tm_mday = (line[5] - '0') * 10 + (line[6] - '0');
+        tmTime.tm_hour = (line[8] - '0') * 10 + (line[9] - '0');
+        tmTime.tm_min = (line[10] - '0') * 10 + (line[11] - '0');
+        tmTime.tm_sec = (line[12] - '0') * 10 + (line[13] - '0');
+        tmTime.tm_isdst = -1;
+        std::time_t seconds = std::mktime(&tmTime);
+        if (seconds == static_cast<std::time_t>(-1))
+            return false;
+        std::memcpy(this->prefix, line + 1, sizeof(this->prefix));
+        this->prefixMs = static_cast<std::int64_t>(seconds) * 1000;
+        this->cached = true;
+    }
+    ms = this->prefixMs + (line[15] - '0') * 100 + (line[16] - '0') * 10 + (line[17] - '0');
+    return true;
+}
+
+void TXTLogIndex::scanTimes(const char *data, std::size_t size, TimeParser &parser, std::int64_t &firstMs, std::int64_t &lastMs)
+{
+    firstMs = 0;
+    lastMs = 0;
+    const char *cursor = data;
+    const char *end = data + size;
+    while (cursor < end)
+    {
+        std::int64_t ms;
+        if (parser.parse(cursor, static_cast<std::size_t>(end - cursor), ms))
+        {
+            if (firstMs == 0)
+                firstMs = ms;
+            lastMs = ms;
+        }
+        const char *newline = static_cast<const char *>(std::memchr(cursor, '\n', static_cast<std::size_t>(end - cursor)));
+        if (newline == nullptr)
+            break;
+        cursor = newline + 1;
+    }
+}
+
+std::string TXTLogIndex::format(const Entry &entry)
+{
+    char line[128];
+    int length = std::snprintf(line, sizeof(line), "%llu %llu %llu %lld %lld\n",
+                               static_cast<unsigned long long>(entry.offset),
+                               static_cast<unsigned long long>(entry.compressedSize),
+                               static_cast<unsigned long long>(entry.rawSize),
+                               static_cast<long long>(entry.firstMs),
+                               static_cast<long long>(entry.lastMs));
+    return std::string(line, static_cast<std::size_t>(length));
+}
+
+bool TXTLogIndex::load(const std::string &path, std::vector<Entry> &entries)
+{
+    std::ifstream input(path);
+    if (!input)
+        return false;
+
+    std::string line;
+    while (std::getline(input, line))
+    {
+        if (line.empty())
+            continue;
+        unsigned long long offset, compressedSize, rawSize;
+        long long firstMs, lastMs;
+        if (std::sscanf(line.c_str(), "%llu %llu %llu %lld %lld", &offset, &compressedSize, &rawSize, &firstMs, &lastMs) != 5)
+            return false;
+        Entry entry;
+        entry.offset = offset;
+        entry.compressedSize = compressedSize;
+        entry.rawSize = rawSize;
+        entry.firstMs = firstMs;
+        entry.lastMs = lastMs;
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+bool TXTLogIndex::loadFor(const std::string &archiveFile, std::vector<Entry> &entries)
+{
+    struct stat st;
+    if (::stat(archiveFile.c_str(), &st) != 0 || !TXTLogIndex::load(TXTLogIndex::pathFor(archiveFile), entries) || entries.empty())
+        return false;
+
+    std::uint64_t expected = 0;
+    for (const Entry &entry : entries)
+    {
+        if (entry.offset != expected)
+            return false;
+        expected += entry.compressedSize;
+    }
+    return expected == static_cast<std::uint64_t>(st.st_size);
+}
+
+std::string TXTLogIndex::pathFor(const std::string &archiveFile)
+{
+    return archiveFile + TXTLogIndex::EXTENSION;
+}
+
+bool TXTLogIndex::isIndexName(const std::string &fileName)
+{
+    std::size_t length = std::strlen(TXTLogIndex::EXTENSION);
+    return fileName.size() > length && fileName.compare(fileName.size() - length, length, TXTLogIndex::EXTENSION) == 0;
+}
@@ -0,0 +1,727 @@
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifndef __DISABLE_IO_URING
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "debug.hpp"
+#include "txtlog-ring.hpp"
+
+#ifndef __DISABLE_IO_URING
+
+namespace
+{
+    const int SYNC_REQUEST = -1;
+    const int RENAME_REQUEST = -2;
+
+    int ringSetup(unsigned entries, struct io_uring_params *params)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int ringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    int ringRegister(int fd, unsigned opcode, void *arg, unsigned count)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    /* head and tail indexes are shared with the kernel */
+    unsigned loadAcquire(const unsigned *index)
+    {
+        return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+    }
+
+    void storeRelease(unsigned *index, unsigned value)
+    {
+        __atomic_store_n(index, value, __ATOMIC_RELEASE);
+    }
+}
+
+TXTLogRing::TXTLogRing() : ringDescriptor(-1),
+                           submissionMap(nullptr),
+                           submissionMapSize(0),
+                           completionMap(nullptr),
+                           completionMapSize(0),
+                           submissionEntries(nullptr),
+                           submissionEntriesSize(0),
+                           submissionHead(nullptr),
+                           submissionTail(nullptr),
+                           submissionMask(0),
+                           submissionArray(nullptr),
+                           submissionCapacity(0),
+                           completionHead(nullptr),
+                           completionTail(nullptr),
+                           completionMask(0),
+                           completionEntries(nullptr),
+                           queued(0),
+                           queuedBytes(0),
+                           pool(nullptr),
+                           poolSize(0),
+                           slotSize(0),
+                           slots(),
+                           currentSlot(0),
+                           fixedBuffers(false),
+                           renameSupported(false),
+                           requests(),
+                           freeRequests(),
+                           inFlight(0),
+                           lastWrite(-1),
+                           lastWriteEntry(nullptr),
+                           failed(false)
+{
+}
+
+TXTLogRing::~TXTLogRing()
+{
+    this->close();
+}
+
+bool TXTLogRing::open(std::size_t bufferSize, std::size_t bufferCount)
+{
+    this->close();
+    /* buffer indexes are 16 bits and registration takes at most 1024 buffers */
+    bufferCount = std::min<std::size_t>(bufferCount, 1024);
+    if (bufferSize == 0 || bufferSize > 0xffffffffu || bufferCount == 0)
+    {
+        return false;
+    }
+
+    /* a few writes per buffer may be in flight at once */
+    unsigned entries = 8;
+    while (entries < bufferCount * 4 && entries < 4096)
+    {
+        entries <<= 1;
+    }
+
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    this->ringDescriptor = ringSetup(entries, &params);
+    if (this->ringDescriptor < 0)
+    {
+        Debug::warning(__FILE__, __LINE__, __func__, "io_uring_setup failed: %s\n", std::strerror(errno));
+        this->ringDescriptor = -1;
+        return false;
+    }
+
+    this->submissionMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    this->completionMapSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap)
+    {
+        this->submissionMapSize = std::max(this->submissionMapSize, this->completionMapSize);
+        this->completionMapSize = this->submissionMapSize;
+    }
+    this->submissionMap = ::mmap(nullptr, this->submissionMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                 this->ringDescriptor, IORING_OFF_SQ_RING);
+    if (this->submissionMap == MAP_FAILED)
+    {
+        this->submissionMap = nullptr;
+        this->release();
+        return false;
+    }
+    if (singleMap)
+    {
+        this->completionMap = this->submissionMap;
+    }
+    else
+    {
+        this->completionMap = ::mmap(nullptr, this->completionMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                     this->ringDescriptor, IORING_OFF_CQ_RING);
+        if (this->completionMap == MAP_FAILED)
+        {
+            this->completionMap = nullptr;
+            this->release();
+            return false;
+        }
+    }
+    this->submissionEntriesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *entriesMap = ::mmap(nullptr, this->submissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              this->ringDescriptor, IORING_OFF_SQES);
+    if (entriesMap == MAP_FAILED)
+    {
+        this->release();
+        return false;
+    }
+    this->submissionEntries = static_cast<struct io_uring_sqe *>(entriesMap);
+
+    char *submission = static_cast<char *>(this->submissionMap);
+    this->submissionHead = reinterpret_cast<unsigned *>(submission + params.sq_off.head);
+    this->submissionTail = reinterpret_cast<unsigned *>(submission + params.sq_off.tail);
+    this->submissionMask = *reinterpret_cast<unsigned *>(submission + params.sq_off.ring_mask);
+    this->submissionArray = reinterpret_cast<unsigned *>(submission + params.sq_off.array);
+    this->submissionCapacity = params.sq_entries;
+    char *completion = static_cast<char *>(this->completionMap);
+    this->completionHead = reinterpret_cast<unsigned *>(completion + params.cq_off.head);
+    this->completionTail = reinterpret_cast<unsigned *>(completion + params.cq_off.tail);
+    this->completionMask = *reinterpret_cast<unsigned *>(completion + params.cq_off.ring_mask);
+    this->completionEntries = reinterpret_cast<struct io_uring_cqe *>(completion + params.cq_off.cqes);
+
+    /* io_uring exists since 5.1, the operations used here arrived later */
+    std::vector<char> probeBuffer(sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op), 0);
+    struct io_uring_probe *probe = reinterpret_cast<struct io_uring_probe *>(probeBuffer.data());
+    if (ringRegister(this->ringDescriptor, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0)
+    {
+        Debug::warning(__FILE__, __LINE__, __func__, "io_uring probe failed: %s\n", std::strerror(errno));
+        this->release();
+        return false;
+    }
+    auto supported = [probe](unsigned opcode)
+    {
+        return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+    };
+    if (!supported(IORING_OP_WRITE) || !supported(IORING_OP_WRITE_FIXED) || !supported(IORING_OP_FSYNC))
+    {
+        Debug::warning(__FILE__, __LINE__, __func__, "io_uring lacks write or fsync\n");
+        this->release();
+        return false;
+    }
+    this->renameSupported = supported(IORING_OP_RENAMEAT);
+
+    this->poolSize = bufferSize * bufferCount;
+    void *poolMap = ::mmap(nullptr, this->poolSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (poolMap == MAP_FAILED)
+    {
+        this->poolSize = 0;
+        this->release();
+        return false;
+    }
+    this->pool = static_cast<char *>(poolMap);
+    this->slotSize = bufferSize;
+
+    /* registered buffers skip the per-write page pinning, RLIMIT_MEMLOCK may refuse them */
+    std::vector<struct iovec> vectors(bufferCount);
+    for (std::size_t i = 0; i < bufferCount; i++)
+    {
+        vectors[i].iov_base = this->pool + i * bufferSize;
+        vectors[i].iov_len = bufferSize;
+    }
+    this->fixedBuffers = ringRegister(this->ringDescriptor, IORING_REGISTER_BUFFERS, vectors.data(), static_cast<unsigned>(bufferCount)) == 0;
+    if (!this->fixedBuffers)
+    {
+        Debug::warning(__FILE__, __LINE__, __func__, "buffer registration failed: %s\n", std::strerror(errno));
+    }
+
+    Slot empty;
+    empty.used = 0;
+    empty.pending = 0;
+    this->slots.assign(bufferCount, empty);
+    this->currentSlot = 0;
+
+    /* never more operations in flight than completion entries */
+    Request idle;
+    std::memset(&idle, 0, sizeof(idle));
+    idle.done = true;
+    this->requests.assign(params.sq_entries, idle);
+    this->freeRequests.clear();
+    for (std::uint32_t i = params.sq_entries; i > 0; i--)
+    {
+        this->freeRequests.push_back(i - 1);
+    }
+    this->queued = 0;
+    this->queuedBytes = 0;
+    this->inFlight = 0;
+    this->lastWrite = -1;
+    this->lastWriteEntry = nullptr;
+    this->failed = false;
+    return true;
+}
+
+void TXTLogRing::close()
+{
+    if (this->ringDescriptor < 0)
+    {
+        return;
+    }
+    this->drain();
+    this->release();
+}
+
+bool TXTLogRing::isOpen() const
+{
+    return this->ringDescriptor >= 0;
+}
+
+std::size_t TXTLogRing::pendingBytes() const
+{
+    return this->queuedBytes;
+}
+
+std::size_t TXTLogRing::bufferSize() const
+{
+    return this->slotSize;
+}
+
+void TXTLogRing::release()
+{
+    if (this->ringDescriptor >= 0)
+    {
+        ::close(this->ringDescriptor);
+        this->ringDescriptor = -1;
+    }
+    if (this->submissionEntries != nullptr)
+    {
+        ::munmap(this->submissionEntries, this->submissionEntriesSize);
+        this->submissionEntries = nullptr;
+    }
+    if (this->completionMap != nullptr && this->completionMap != this->submissionMap)
+    {
+        ::munmap(this->completionMap, this->completionMapSize);
+    }
+    this->completionMap = nullptr;
+    if (this->submissionMap != nullptr)
+    {
+        ::munmap(this->submissionMap, this->submissionMapSize);
+        this->submissionMap = nullptr;
+    }
+    if (this->pool != nullptr)
+    {
+        ::munmap(this->pool, this->poolSize);
+        this->pool = nullptr;
+    }
+    this->poolSize = 0;
+    this->slots.clear();
+    this->requests.clear();
+    this->freeRequests.clear();
+    this->queued = 0;
+    this->queuedBytes = 0;
+    this->inFlight = 0;
+    this->lastWrite = -1;
+    this->lastWriteEntry = nullptr;
+}
+
+void TXTLogRing::write(int fd, std::uint64_t offset, const char *data, std::size_t size)
+{
+    while (size > 0)
+    {
+        if (this->slots[this->currentSlot].used == this->slotSize)
+        {
+            this->nextSlot();
+        }
+        Slot &slot = this->slots[this->currentSlot];
+        std::size_t length = std::min(size, this->slotSize - slot.used);
+        std::size_t position = slot.used;
+        std::memcpy(this->pool + this->currentSlot * this->slotSize + position, data, length);
+        slot.used += length;
+        this->queueWriteFrom(fd, offset, this->currentSlot, position, length);
+        data += length;
+        offset += length;
+        size -= length;
+    }
+}
+
+void TXTLogRing::sync(int fd)
+{
+    if (this->ringDescriptor < 0)
+    {
+        return;
+    }
+    std::uint32_t index = this->acquireRequest();
+    Request &request = this->requests[index];
+    request.offset = 0;
+    request.address = nullptr;
+    request.length = 0;
+    request.fd = fd;
+    request.slot = SYNC_REQUEST;
+    request.done = false;
+    request.result = 0;
+
+    struct io_uring_sqe *entry = this->nextEntry();
+    entry->opcode = IORING_OP_FSYNC;
+    entry->flags = IOSQE_IO_DRAIN;
+    entry->fd = fd;
+    entry->fsync_flags = IORING_FSYNC_DATASYNC;
+    entry->user_data = index;
+    this->pushEntry();
+    this->lastWrite = -1;
+}
+
+bool TXTLogRing::rename(const char *from, const char *to)
+{
+    if (this->ringDescriptor < 0 || !this->renameSupported)
+    {
+        bool written = this->drain();
+        bool renamed = ::rename(from, to) == 0;
+        this->failed = this->failed || !written;
+        return renamed;
+    }
+
+    std::uint32_t index = this->acquireRequest();
+    Request &request = this->requests[index];
+    request.offset = 0;
+    request.address = nullptr;
+    request.length = 0;
+    request.fd = -1;
+    request.slot = RENAME_REQUEST;
+    request.done = false;
+    request.result = 0;
+
+    /* drained: the writes still in flight land in the file before it moves */
+    struct io_uring_sqe *entry = this->nextEntry();
+    entry->opcode = IORING_OP_RENAMEAT;
+    entry->flags = IOSQE_IO_DRAIN;
+    entry->fd = AT_FDCWD;
+    entry->addr = reinterpret_cast<std::uintptr_t>(from);
+    entry->len = static_cast<unsigned>(AT_FDCWD);
+    entry->off = reinterpret_cast<std::uintptr_t>(to);
+    entry->rename_flags = 0;
+    entry->user_data = index;
+    this->pushEntry();
+    this->lastWrite = -1;
+
+    while (!this->requests[index].done && this->ringDescriptor >= 0)
+    {
+        this->waitOne();
+    }
+    int result = this->requests[index].result;
+    this->freeRequests.push_back(index);
+    this->inFlight--;
+    if (result < 0)
+    {
+        errno = -result;
+        return false;
+    }
+    return true;
+}
+
+bool TXTLogRing::submit()
+{
+    if (this->ringDescriptor < 0)
+    {
+        return true;
+    }
+    this->enter(0);
+    this->reap();
+    bool result = !this->failed;
+    this->failed = false;
+    return result;
+}
+
+bool TXTLogRing::drain()
+{
+    if (this->ringDescriptor < 0)
+    {
+        return true;
+    }
+    this->enter(0);
+    this->reap();
+    while (this->inFlight > 0)
+    {
+        if (!this->enter(1))
+        {
+            break;
+        }
+        this->reap();
+    }
+    bool result = !this->failed;
+    this->failed = false;
+    return result;
+}
+
+struct io_uring_sqe *TXTLogRing::nextEntry()
+{
+    while (*this->submissionTail - loadAcquire(this->submissionHead) >= this->submissionCapacity)
+    {
+        /* submission queue full, hand it to the kernel */
+        if (!this->enter(0))
+        {
+            this->reap();
+        }
+    }
+    struct io_uring_sqe *entry = &this->submissionEntries[*this->submissionTail & this->submissionMask];
+    std::memset(entry, 0, sizeof(*entry));
+    return entry;
+}
+
+void TXTLogRing::pushEntry()
+{
+    unsigned tail = *this->submissionTail;
+    this->submissionArray[tail & this->submissionMask] = tail & this->submissionMask;
+    storeRelease(this->submissionTail, tail + 1);
+    this->queued++;
+}
+
+std::uint32_t TXTLogRing::acquireRequest()
+{
+    while (this->freeRequests.empty())
+    {
+        this->waitOne();
+    }
+    std::uint32_t index = this->freeRequests.back();
+    this->freeRequests.pop_back();
+    this->inFlight++;
+    return index;
+}
+
+void TXTLogRing::queueWrite(std::uint32_t index)
+{
+    struct io_uring_sqe *entry = this->nextEntry();
+    const Request &request = this->requests[index];
+    entry->opcode = this->fixedBuffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    entry->fd = request.fd;
+    entry->addr = reinterpret_cast<std::uintptr_t>(request.address);
+    entry->len = request.length;
+    entry->off = request.offset;
+    if (this->fixedBuffers)
+    {
+        entry->buf_index = static_cast<__u16>(request.slot);
+    }
+    entry->user_data = index;
+    this->pushEntry();
+    this->lastWrite = static_cast<int>(index);
+    this->lastWriteEntry = entry;
+}
+
+void TXTLogRing::queueWriteFrom(int fd, std::uint64_t offset, std::size_t slot, std::size_t position, std::size_t length)
+{
+    char *address = this->pool + slot * this->slotSize + position;
+    this->queuedBytes += length;
+
+    /* records appended back to back before a submit share one write */
+    if (this->lastWrite >= 0)
+    {
+        Request &last = this->requests[static_cast<std::size_t>(this->lastWrite)];
+        if (last.fd == fd && last.slot == static_cast<int>(slot) && last.address + last.length == address && last.offset + last.length == offset)
+        {
+            last.length += static_cast<std::uint32_t>(length);
+            this->lastWriteEntry->len = last.length;
+            return;
+        }
+    }
+
+    std::uint32_t index = this->acquireRequest();
+    Request &request = this->requests[index];
+    request.offset = offset;
+    request.address = address;
+    request.length = static_cast<std::uint32_t>(length);
+    request.fd = fd;
+    request.slot = static_cast<int>(slot);
+    request.done = false;
+    request.result = 0;
+    this->slots[slot].pending++;
+    this->queueWrite(index);
+}
+
+bool TXTLogRing::enter(unsigned minComplete)
+{
+    unsigned flags = (minComplete > 0) ? IORING_ENTER_GETEVENTS : 0;
+    for (;;)
+    {
+        int submitted = ringEnter(this->ringDescriptor, this->queued, minComplete, flags);
+        /* queued entries are the kernel's now and must not be extended */
+        this->lastWrite = -1;
+        if (submitted >= 0)
+        {
+            this->queued -= std::min(this->queued, static_cast<unsigned>(submitted));
+            if (this->queued == 0)
+            {
+                this->queuedBytes = 0;
+            }
+            return true;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if ((errno == EAGAIN || errno == EBUSY) && this->inFlight > this->queued)
+        {
+            /* completion queue backed up, make room and retry */
+            this->reap();
+            ringEnter(this->ringDescriptor, 0, 1, IORING_ENTER_GETEVENTS);
+            this->reap();
+            continue;
+        }
+        Debug::error(__FILE__, __LINE__, __func__, "io_uring_enter failed: %s\n", std::strerror(errno));
+        this->failed = true;
+        return false;
+    }
+}
+
+void TXTLogRing::reap()
+{
+    unsigned head;
+    while ((head = *this->completionHead) != loadAcquire(this->completionTail))
+    {
+        const struct io_uring_cqe *entry = &this->completionEntries[head & this->completionMask];
+        std::uint32_t index = static_cast<std::uint32_t>(entry->user_data);
+        int result = entry->res;
+        /* released first, complete() may queue a retry */
+        storeRelease(this->completionHead, head + 1);
+        this->complete(index, result);
+    }
+}
+
+void TXTLogRing::complete(std::uint32_t index, int result)
+{
+    Request &request = this->requests[index];
+    if (request.slot == RENAME_REQUEST)
+    {
+        /* the waiting rename() releases the request */
+        request.done = true;
+        request.result = result;
+        return;
+    }
+
+    if (request.slot == SYNC_REQUEST)
+    {
+        if (result < 0)
+        {
+            Debug::error(__FILE__, __LINE__, __func__, "fdatasync failed: %s\n", std::strerror(-result));
+            this->failed = true;
+        }
+    }
+    else
+    {
+        if (result > 0 && static_cast<std::uint32_t>(result) < request.length)
+        {
+            /* short write, the rest goes out as a new operation of the same request */
+            request.address += result;
+            request.offset += static_cast<std::uint64_t>(result);
+            request.length -= static_cast<std::uint32_t>(result);
+            this->queueWrite(index);
+            return;
+        }
+        if (result <= 0)
+        {
+            Debug::error(__FILE__, __LINE__, __func__, "write failed: %s\n", std::strerror(result < 0 ? -result : EIO));
+            this->failed = true;
+        }
+        this->slots[static_cast<std::size_t>(request.slot)].pending--;
+    }
+    request.done = true;
+    this->freeRequests.push_back(index);
+    this->inFlight--;
+}
+
+void TXTLogRing::waitOne()
+{
+    if (this->enter(1))
+    {
+        this->reap();
+        return;
+    }
+
+    /* the ring is unusable, fail what is in flight instead of waiting forever */
+    for (std::uint32_t i = 0; i < this->requests.size(); i++)
+    {
+        if (!this->requests[i].done)
+        {
+            this->complete(i, -EIO);
+        }
+    }
+}
+
+void TXTLogRing::nextSlot()
+{
+    this->currentSlot = (this->currentSlot + 1) % this->slots.size();
+    while (this->slots[this->currentSlot].pending > 0)
+    {
+        this->waitOne();
+    }
+    this->slots[this->currentSlot].used = 0;
+}
+
+#else
+
+TXTLogRing::TXTLogRing() : ringDescriptor(-1),
+                           submissionMap(nullptr),
+                           submissionMapSize(0),
+                           completionMap(nullptr),
+                           completionMapSize(0),
+                           submissionEntries(nullptr),
+                           submissionEntriesSize(0),
+                           submissionHead(nullptr),
+                           submissionTail(nullptr),
+                           submissionMask(0),
+                           submissionArray(nullptr),
+                           submissionCapacity(0),
+                           completionHead(nullptr),
+                           completionTail(nullptr),
+                           completionMask(0),
+                           completionEntries(nullptr),
+                           queued(0),
+                           queuedBytes(0),
+                           pool(nullptr),
+                           poolSize(0),
+                           slotSize(0),
+                           slots(),
+                           currentSlot(0),
+                           fixedBuffers(false),
+                           renameSupported(false),
+                           requests(),
+                           freeRequests(),
+                           inFlight(0),
+                           lastWrite(-1),
+                           lastWriteEntry(nullptr),
+                           failed(false)
+{
+}
+
+TXTLogRing::~TXTLogRing() {}
+
+bool TXTLogRing::open(std::size_t bufferSize, std::size_t bufferCount)
+{
+    (void)bufferSize;
+    (void)bufferCount;
+    Debug::warning(__FILE__, __LINE__, __func__, "built without io_uring\n");
+    return false;
+}
+
+void TXTLogRing::close() {}
+
+bool TXTLogRing::isOpen() const
+{
+    return false;
+}
+
+std::size_t TXTLogRing::pendingBytes() const
+{
+    return 0;
+}
+
+std::size_t TXTLogRing::bufferSize() const
+{
+    return 0;
+}
+
+void TXTLogRing::write(int fd, std::uint64_t offset, const char *data, std::size_t size)
+{
+    (void)fd;
+    (void)offset;
+    (void)data;
+    (void)size;
+}
+
+void TXTLogRing::sync(int fd)
+{
+    (void)fd;
+}
+
+bool TXTLogRing::rename(const char *from, const char *to)
+{
+    return ::rename(from, to) == 0;
+}
+
+bool TXTLogRing::submit()
+{
+    return true;
+}
+
+bool TXTLogRing::drain()
+{
+    return true;
+}
+
+#endif
@@ -1,7 +1,10 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
 #include <dirent.h>
+#include <climits>
 
 #include <lzma.h>
 #ifndef __DISABLE_MINIZIP
@@ -10,16 +13,377 @@
 #include <fstream>
 
 #include <ctime>
+#include <cerrno>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
 #include <algorithm>
+#include <deque>
+#include <limits>
+#include <regex>
 #include <sstream>
 #include <mutex>
+#include <atomic>
 
+#include "aho-corasick.hpp"
 #include "debug.hpp"
 #include "txtlog.hpp"
+#include "txtlog-codec.hpp"
+#include "txtlog-index.hpp"
+#include "txtlog-ring.hpp"
+
+namespace
+{
+    /* read up to blockSize bytes ending at a line boundary, the cut-off tail is kept in carry */
+    bool readBlock(std::ifstream &input, std::string &carry, std::string &block, std::size_t blockSize)
+    {
+        block.swap(carry);
+        carry.clear();
+        std::size_t have = block.size();
+        block.resize(blockSize);
+        input.read(&block[have], static_cast<std::streamsize>(blockSize - have));
+        block.resize(have + static_cast<std::size_t>(input.gcount()));
+        if (block.size() == blockSize)
+        {
+            std::size_t newline = block.find_last_of('\n');
+            if (newline != std::string::npos && newline + 1 < block.size())
+            {
+                carry.assign(block, newline + 1, std::string::npos);
+                block.resize(newline + 1);
+            }
+        }
+        return !block.empty();
+    }
+
+    /* some line starts with a Debug header carrying the CRITICAL tag, "[YYMMDD_HHMMSS.mmm] [C]: " */
+    bool hasCriticalRecord(const std::string &data)
+    {
+        std::size_t start = 0;
+        while (start + 23 <= data.size())
+        {
+            if (data[start] == '[' && data[start + 18] == ']' && data[start + 20] == '[' && data[start + 21] == 'C' && data[start + 22] == ']')
+                return true;
+            start = data.find('\n', start);
+            if (start == std::string::npos)
+                break;
+            start++;
+        }
+        return false;
+    }
+
+    /* bytes of the lock file used as locks, appends share the first, maintenance takes the second */
+    const off_t APPEND_LOCK = 0;
+    const off_t MAINTENANCE_LOCK = 1;
+
+    /* lock one byte; locks of an open file description also exclude other descriptions in this process */
+    bool lockRange(int fd, short type, off_t start)
+    {
+        struct flock range;
+        std::memset(&range, 0, sizeof(range));
+        range.l_type = type;
+        range.l_whence = SEEK_SET;
+        range.l_start = start;
+        range.l_len = 1;
+        while (::fcntl(fd, F_OFD_SETLKW, &range) != 0)
+        {
+            if (errno != EINTR)
+                return false;
+        }
+        return true;
+    }
+
+    /* holds one byte of the lock file for a scope through a descriptor of its own */
+    class RangeLock
+    {
+    public:
+        RangeLock(bool enable, const std::string &path, short type, off_t start) : fd(-1)
+        {
+            if (!enable)
+                return;
+            this->fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (this->fd >= 0 && !lockRange(this->fd, type, start))
+            {
+                ::close(this->fd);
+                this->fd = -1;
+            }
+            if (this->fd < 0)
+                Debug::error(__FILE__, __LINE__, __func__, "%s: %s\n", path.c_str(), std::strerror(errno));
+        }
+        ~RangeLock()
+        {
+            if (this->fd >= 0)
+                ::close(this->fd);
+        }
+        RangeLock(const RangeLock &) = delete;
+        RangeLock &operator=(const RangeLock &) = delete;
+
+    private:
+        int fd;
+    };
+
+    /* wall-clock seconds at tick resolution, the cheapest clock read the kernel offers */
+    std::int64_t coarseSeconds()
+    {
+        struct timespec now;
+        ::clock_gettime(CLOCK_REALTIME_COARSE, &now);
+        return static_cast<std::int64_t>(now.tv_sec);
+    }
+
+    /* distinguishes the pinning links of concurrent readers in one process */
+    std::atomic<unsigned long> pinSequence(0);
+
+    /* the data ends at the last non-zero byte, a text log never ends with NUL */
+    std::uint64_t findDataEnd(const std::string &path, std::uint64_t size)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return size;
+        }
+        std::uint64_t end = size;
+        char chunk[65536];
+        while (end > 0)
+        {
+            std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(end, sizeof(chunk)));
+            ssize_t got = ::pread(fd, chunk, length, static_cast<off_t>(end - length));
+            if (got != static_cast<ssize_t>(length))
+            {
+                break;
+            }
+            std::size_t i = length;
+            while (i > 0 && chunk[i - 1] == '\0')
+            {
+                i--;
+            }
+            end -= length - i;
+            if (i > 0)
+            {
+                break;
+            }
+        }
+        ::close(fd);
+        return end;
+    }
+
+    /* archiving passes a backup may fail before it is moved out of the way */
+    const unsigned int ARCHIVE_ATTEMPTS = 3;
+
+    /* "YYYYMMDD.HHMMSS" with an optional "_NNN" collision suffix */
+    bool isTimestampKey(const std::string &key)
+    {
+        if (key.size() < 15 || key[8] != '.')
+            return false;
+        for (std::size_t i = 0; i < 15; i++)
+        {
+            if (i != 8 && (key[i] < '0' || key[i] > '9'))
+                return false;
+        }
+        if (key.size() == 15)
+            return true;
+        if (key[15] != '_' || key.size() == 16)
+            return false;
+        return key.find_first_not_of("0123456789", 16) == std::string::npos;
+    }
+
+    /* copy the lines inside [fromMs, toMs], lastMs carries the time of continuation lines */
+    void filterLines(const char *data, std::size_t size, std::int64_t fromMs, std::int64_t toMs,
+                     TXTLogIndex::TimeParser &parser, std::int64_t &lastMs, std::ostream &output)
+    {
+        const char *cursor = data;
+        const char *end = data + size;
+        while (cursor < end)
+        {
+            const char *newline = static_cast<const char *>(std::memchr(cursor, '\n', static_cast<std::size_t>(end - cursor)));
+            const char *next = (newline != nullptr) ? newline + 1 : end;
+            std::int64_t ms;
+            if (parser.parse(cursor, static_cast<std::size_t>(next - cursor), ms))
+                lastMs = ms;
+            if (lastMs == 0 || (lastMs >= fromMs && lastMs <= toMs))
+                output.write(cursor, next - cursor);
+            cursor = next;
+        }
+    }
+}
+
+/* ================= Multi-Process ================= */
+
+/* first bytes of the lock file, updated with atomic builtins by every process */
+struct TXTLog::SharedControl
+{
+    std::uint64_t generation; /* bumped by every rotation */
+    std::uint64_t size;       /* bytes appended to the active file by all processes */
+};
+
+/* ================= Query ================= */
+
+/* splits decoded chunks into records and keeps the ones matching a query */
+class TXTLog::QueryScanner
+{
+private:
+    const TXTLog::Query &query;
+    std::int64_t fromMs;
+    std::int64_t toMs;
+    const AhoCorasick &matcher;
+    const std::regex *regex;
+    TXTLogIndex::TimeParser parser;
+    std::string partial;
+    TXTLog::Record current;
+    bool pending;
+    std::int64_t lastMs;
+
+    static Debug::LogType_t levelOf(const char *line, std::size_t size)
+    {
+        /* "[YYMMDD_HHMMSS.mmm] [L]: " */
+        if (size < 23 || line[19] != ' ' || line[20] != '[' || line[22] != ']')
+            return Debug::INFO;
+        switch (line[21])
+        {
+        case 'W':
+            return Debug::WARNING;
+        case 'E':
+            return Debug::ERROR;
+        case 'C':
+            return Debug::CRITICAL;
+        default:
+            return Debug::INFO;
+        }
+    }
+
+    void line(const char *data, std::size_t size)
+    {
+        std::int64_t ms;
+        if (this->parser.parse(data, size, ms))
+        {
+            this->complete();
+            this->current.timeMs = ms;
+            this->current.level = QueryScanner::levelOf(data, size);
+            this->current.text.assign(data, size);
+            this->pending = true;
+            this->lastMs = ms;
+        }
+        else if (this->pending && this->current.timeMs != 0)
+        {
+            this->current.text.append(data, size);
+        }
+        else
+        {
+            /* no header seen yet, every line stands alone */
+            this->complete();
+            this->current.timeMs = 0;
+            this->current.level = Debug::INFO;
+            this->current.text.assign(data, size);
+            this->pending = true;
+        }
+    }
+
+    void complete()
+    {
+        if (!this->pending)
+            return;
+        this->pending = false;
+
+        if (this->current.timeMs == 0)
+        {
+            if (this->fromMs != std::numeric_limits<std::int64_t>::min() || this->toMs != std::numeric_limits<std::int64_t>::max())
+                return;
+        }
+        else if (this->current.timeMs < this->fromMs || this->current.timeMs > this->toMs)
+        {
+            return;
+        }
+        if (this->current.level < this->query.minLevel)
+            return;
+        if (!this->matcher.isEmpty())
+        {
+            bool found = false;
+            this->matcher.scan(this->current.text.data(), this->current.text.size(), [&found](std::size_t, std::size_t)
+                               { found = true; });
+            if (!found)
+                return;
+        }
+        if (this->regex != nullptr)
+        {
+            /* without the final newline so '$' matches the end of the record */
+            std::string::const_iterator end = this->current.text.end();
+            if (end != this->current.text.begin() && *(end - 1) == '\n')
+                --end;
+            if (!std::regex_search(this->current.text.cbegin(), end, *this->regex))
+                return;
+        }
+
+        this->records.push_back(std::move(this->current));
+        this->keys.push_back(this->lastMs);
+        this->current = TXTLog::Record();
+    }
+
+public:
+    std::vector<TXTLog::Record> records;
+    /* merge key per record, the last timestamp seen so records without one stay in place */
+    std::vector<std::int64_t> keys;
+
+    QueryScanner(const TXTLog::Query &query, std::int64_t fromMs, std::int64_t toMs, const AhoCorasick &matcher, const std::regex *regex)
+        : query(query), fromMs(fromMs), toMs(toMs), matcher(matcher), regex(regex),
+          parser(), partial(), current(), pending(false), lastMs(0), records(), keys() {}
+
+    std::int64_t getFromMs() const
+    {
+        return this->fromMs;
+    }
+
+    std::int64_t getToMs() const
+    {
+        return this->toMs;
+    }
+
+    bool isBounded() const
+    {
+        return this->fromMs != std::numeric_limits<std::int64_t>::min() || this->toMs != std::numeric_limits<std::int64_t>::max();
+    }
+
+    void feed(const char *data, std::size_t size)
+    {
+        const char *cursor = data;
+        const char *end = data + size;
+        if (!this->partial.empty())
+        {
+            const char *newline = static_cast<const char *>(std::memchr(cursor, '\n', size));
+            if (newline == nullptr)
+            {
+                this->partial.append(cursor, size);
+                return;
+            }
+            this->partial.append(cursor, static_cast<std::size_t>(newline + 1 - cursor));
+            this->line(this->partial.data(), this->partial.size());
+            this->partial.clear();
+            cursor = newline + 1;
+        }
+        while (cursor < end)
+        {
+            const char *newline = static_cast<const char *>(std::memchr(cursor, '\n', static_cast<std::size_t>(end - cursor)));
+            if (newline == nullptr)
+            {
+                this->partial.assign(cursor, static_cast<std::size_t>(end - cursor));
+                break;
+            }
+            this->line(cursor, static_cast<std::size_t>(newline + 1 - cursor));
+            cursor = newline + 1;
+        }
+    }
+
+    /* end of the file, or a gap of skipped blocks */
+    void finish()
+    {
+        if (!this->partial.empty())
+        {
+            this->line(this->partial.data(), this->partial.size());
+            this->partial.clear();
+        }
+        this->complete();
+    }
+};
+
+TXTLog::Query::Query() : from(0), to(0), minLevel(Debug::INFO), contains(), pattern() {}
 
 /* ================= Constructor / Destructor ================= */
 
@@ -27,31 +391,119 @@ TXTLog::TXTLog(const std::string &workingDirectory,
                const std::string &baseFileName,
                std::size_t maxFileSize,
                std::size_t maxTxtBackups,
-               std::size_t maxArchiveFiles) : fileDescriptor(-1),
-                                              workingDirectory(workingDirectory),
-                                              baseFileName(baseFileName),
-                                              activeFilePath(),
-                                              maxFileSize(maxFileSize),
-                                              maxTxtBackups(maxTxtBackups),
-                                              maxArchiveFiles(maxArchiveFiles),
-                                              mutex()
-{
-    this->activeFilePath = workingDirectory + "/" + baseFileName + ".log";
+               std::size_t maxArchiveFiles,
+               std::size_t bufferSize,
+               long maxBufferAgeMs,
+               bool multiProcess) : fileDescriptor(-1),
+                                      workingDirectory(workingDirectory),
+                                      baseFileName(baseFileName),
+                                      activeFilePath(),
+                                      maxFileSize(maxFileSize),
+                                      maxTxtBackups(maxTxtBackups),
+                                      maxArchiveFiles(maxArchiveFiles),
+                                      currentFileSize(0),
+                                      writeBuffer(),
+                                      writeBufferSize(bufferSize),
+                                      maxBufferAge(maxBufferAgeMs),
+                                      bufferSince(),
+                                      mutex(),
+                                      backgroundMaintenance(true),
+                                      maintenancePending(false),
+                                      maintenanceRunning(false),
+                                      maintenanceStop(false),
+                                      maintenanceThread(),
+                                      maintenanceMutex(),
+                                      maintenanceCondition(),
+                                      durabilityPolicy(DURABILITY_NONE),
+                                      durabilityValue(0),
+                                      unsyncedBytes(0),
+                                      syncPending(false),
+                                      flushDeadline(),
+                                      archiveThreads(1),
+                                      codec(std::make_shared<XzCodec>()),
+                                      rotationPolicy(ROTATE_SIZE),
+                                      rotationAge(0),
+                                      rotationDeadline(0),
+                                      incomingRate(0),
+                                      rotationSince(std::chrono::steady_clock::now()),
+                                      compressedStreaming(false),
+                                      compressedBuffer(),
+                                      indexedArchives(false),
+                                      indexBlockSize(1048576),
+                                      manifestBackups(),
+                                      manifestArchives(),
+                                      manifestMutex(),
+                                      archiveFailures(),
+                                      groupCommit(false),
+                                      groupLeader(false),
+                                      groupQueue(),
+                                      groupBatch(),
+                                      groupVectors(),
+                                      groupMutex(),
+                                      groupCondition(),
+                                      ring(),
+                                      ringFileDescriptor(-1),
+                                      ringSince(),
+                                      mappedFile(false),
+                                      mappedBase(nullptr),
+                                      mappedOffset(0),
+                                      mappedWriters(0),
+                                      mappedCapacity(0),
+                                      multiProcess(false),
+                                      controlFileDescriptor(-1),
+                                      control(nullptr),
+                                      controlGeneration(0)
+{
+    this->writeBuffer.reserve(bufferSize);
+    this->loadManifest();
+    this->activeFilePath = this->generateActiveName();
     this->openActiveFile();
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    /* a process joining a shared file only rotates it under the shared lock */
+    if (multiProcess && this->openControlLocked())
+    {
+        this->multiProcess = true;
+    }
     this->rotateIfNeeded();
 }
 
 TXTLog::~TXTLog()
 {
     this->close();
+    this->stopMaintenance();
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->closeControlLocked();
 }
 
 /* ================= Public API ================= */
 
 bool TXTLog::write(const std::string &data)
 {
-    std::lock_guard<std::mutex> lock(this->mutex);
+    bool result;
+    if (this->mappedFile)
+    {
+        result = this->writeMapped(data);
+    }
+    else if (this->groupCommit)
+    {
+        result = this->writeGrouped(data);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        result = this->writeLocked(data);
+    }
+
+    if (result && this->durabilityPolicy != DURABILITY_NONE)
+    {
+        result = this->applyDurability(data);
+    }
+    return result;
+}
 
+bool TXTLog::writeLocked(const std::string &data)
+{
     if (this->fileDescriptor <= 0)
     {
         if (!this->openActiveFile())
@@ -60,312 +512,2143 @@ bool TXTLog::write(const std::string &data)
         }
     }
 
-    this->rotateIfNeeded();
+    if (this->writeBufferSize == 0 && !this->compressedStreaming)
+    {
+        this->rotateIfNeeded();
+        if (this->ring)
+        {
+            return this->queueRingLocked(data.data(), data.size());
+        }
+        return this->appendLocked(data.data(), data.size());
+    }
 
-    ssize_t written = ::write(this->fileDescriptor, data.c_str(), data.size());
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    bool started = this->writeBuffer.empty();
+    if (started)
+    {
+        this->bufferSince = now;
+    }
+    this->writeBuffer += data;
 
-    if (written != static_cast<ssize_t>(data.size()))
+    if (this->writeBuffer.size() >= this->writeBufferSize || now - this->bufferSince >= this->maxBufferAge)
     {
-        Debug::error(__FILE__, __LINE__, __func__, "failed\n");
-        return false;
+        return this->flushBufferLocked();
+    }
+    if (started)
+    {
+        this->scheduleFlush(this->bufferSince + this->maxBufferAge);
     }
     return true;
 }
 
-void TXTLog::flush()
+bool TXTLog::writeGrouped(const std::string &data)
 {
-    std::lock_guard<std::mutex> lock(this->mutex);
-
-    if (this->fileDescriptor > 0)
+    GroupCommitRequest request;
+    request.data = &data;
+    request.done = false;
+    request.result = false;
+
+    std::unique_lock<std::mutex> queueLock(this->groupMutex);
+    this->groupQueue.push_back(&request);
+    while (!request.done)
     {
-        ::fsync(this->fileDescriptor);
+        if (this->groupLeader)
+        {
+            this->groupCondition.wait(queueLock);
+            continue;
+        }
+
+        /* lead one batch: everything queued until the writer lock is ours */
+        this->groupLeader = true;
+        queueLock.unlock();
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            queueLock.lock();
+            this->groupBatch.swap(this->groupQueue);
+            queueLock.unlock();
+            this->commitGroupLocked(this->groupBatch);
+        }
+        queueLock.lock();
+        for (GroupCommitRequest *member : this->groupBatch)
+        {
+            member->done = true;
+        }
+        this->groupBatch.clear();
+        /* a follower still waiting takes over as the next leader */
+        this->groupLeader = false;
+        this->groupCondition.notify_all();
     }
+    return request.result;
 }
 
-void TXTLog::close()
+void TXTLog::commitGroupLocked(const std::vector<GroupCommitRequest *> &batch)
 {
-    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->writeBufferSize != 0 || this->compressedStreaming)
+    {
+        /* the user-space buffer already batches */
+        for (GroupCommitRequest *member : batch)
+        {
+            member->result = this->writeLocked(*member->data);
+        }
+        return;
+    }
 
-    if (this->fileDescriptor > 0)
+    bool result = this->fileDescriptor > 0 || this->openActiveFile();
+    if (result)
     {
-        ::close(this->fileDescriptor);
-        this->fileDescriptor = -1;
+        this->rotateIfNeeded();
+        this->groupVectors.clear();
+        for (GroupCommitRequest *member : batch)
+        {
+            struct iovec vector;
+            vector.iov_base = const_cast<char *>(member->data->data());
+            vector.iov_len = member->data->size();
+            this->groupVectors.push_back(vector);
+        }
+        result = this->appendvLocked(this->groupVectors);
+    }
+    for (GroupCommitRequest *member : batch)
+    {
+        member->result = result;
     }
 }
 
-void TXTLog::setMaxFileSize(std::size_t maxFileSize)
+bool TXTLog::writeMapped(const std::string &data)
 {
+    if (!this->isRotationDeadlinePassed() && this->copyMapped(data.data(), data.size()))
+    {
+        return true;
+    }
+
     std::lock_guard<std::mutex> lock(this->mutex);
-    this->maxFileSize = maxFileSize;
+    while (this->mappedFile && this->prepareMappingLocked(data.size()))
+    {
+        /* writers outside the lock may fill the new mapping first */
+        if (this->copyMapped(data.data(), data.size()))
+        {
+            return true;
+        }
+    }
+    /* mode switched off, or a record larger than a whole file */
+    return this->writeLocked(data);
 }
 
-std::size_t TXTLog::getMaxFileSize() const
+bool TXTLog::copyMapped(const char *data, std::size_t size)
 {
-    return this->maxFileSize;
+    /* announced before the mapping is loaded, closeMappingLocked() waits for the count to drop */
+    this->mappedWriters.fetch_add(1);
+    char *base = this->mappedBase.load();
+    bool copied = false;
+    if (base != nullptr)
+    {
+        std::uint64_t offset = this->mappedOffset.load(std::memory_order_relaxed);
+        while (offset + size <= this->mappedCapacity)
+        {
+            if (this->mappedOffset.compare_exchange_weak(offset, offset + size))
+            {
+                std::memcpy(base + offset, data, size);
+                copied = true;
+                break;
+            }
+        }
+    }
+    this->mappedWriters.fetch_sub(1);
+    return copied;
 }
 
-/* ================= File Handling ================= */
+bool TXTLog::prepareMappingLocked(std::size_t size)
+{
+    /* another writer may have mapped the next file while this one waited */
+    if (this->mappedBase.load() != nullptr && this->mappedOffset.load() + size <= this->mappedCapacity &&
+        !this->isRotationDeadlinePassed())
+    {
+        return true;
+    }
 
-bool TXTLog::openActiveFile()
+    this->completeWritesLocked();
+    if (this->fileDescriptor <= 0 && !this->openActiveFile())
+    {
+        return false;
+    }
+    if ((this->currentFileSize > 0 && this->currentFileSize + size > this->maxFileSize) || this->isRotationRequired(0))
+    {
+        this->rotateLocked();
+        if (this->fileDescriptor <= 0)
+        {
+            return false;
+        }
+    }
+    return this->openMappingLocked(size);
+}
+
+bool TXTLog::openMappingLocked(std::size_t size)
 {
-    this->fileDescriptor = ::open(this->activeFilePath.c_str(),
-                                  O_CREAT | O_APPEND | O_WRONLY,
-                                  0644);
+    std::uint64_t used = this->currentFileSize;
+    std::size_t capacity = this->maxFileSize;
+    if (used + size > capacity)
+    {
+        return false;
+    }
 
-    Debug::info(__FILE__, __LINE__, __func__, "%s\n", this->activeFilePath.c_str());
-    if (this->fileDescriptor < 0)
+    /* the write-only descriptor cannot back a shared writable mapping; a failure
+       from here on ends the mode instead of being retried for every record */
+    int fd = ::open(this->activeFilePath.c_str(), O_RDWR);
+    if (fd < 0)
     {
-        Debug::error(__FILE__, __LINE__, __func__, "failed\n");
+        Debug::error(__FILE__, __LINE__, __func__, "%s: %s\n", this->activeFilePath.c_str(), std::strerror(errno));
+        this->mappedFile = false;
         return false;
     }
-    if (this->fileDescriptor == 0)
+    /* reserve the extents once instead of growing the file on every write */
+    if (::fallocate(fd, 0, 0, static_cast<off_t>(capacity)) != 0 && ::ftruncate(fd, static_cast<off_t>(capacity)) != 0)
     {
-        ::close(this->fileDescriptor);
-        this->fileDescriptor = -1;
-        Debug::error(__FILE__, __LINE__, __func__, "failed\n");
+        Debug::error(__FILE__, __LINE__, __func__, "preallocation failed: %s\n", std::strerror(errno));
+        ::close(fd);
+        this->mappedFile = false;
         return false;
     }
+    void *base = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "mmap failed: %s\n", std::strerror(errno));
+        if (::ftruncate(fd, static_cast<off_t>(used)) != 0)
+        {
+            Debug::error(__FILE__, __LINE__, __func__, "truncate failed\n");
+        }
+        ::close(fd);
+        this->mappedFile = false;
+        return false;
+    }
+    ::close(fd);
 
+    this->mappedCapacity = capacity;
+    this->mappedOffset.store(used);
+    this->mappedBase.store(static_cast<char *>(base));
     return true;
 }
 
-void TXTLog::rotateIfNeeded()
+void TXTLog::closeMappingLocked()
 {
-    if (this->fileDescriptor <= 0)
+    char *base = this->mappedBase.exchange(nullptr);
+    if (base == nullptr)
     {
-        Debug::error(__FILE__, __LINE__, __func__, "failed: empty handle\n");
         return;
     }
-
-    if (!this->isRotationRequired(0))
+    while (this->mappedWriters.load() != 0)
     {
-        return;
+        std::this_thread::yield();
     }
 
-    ::close(this->fileDescriptor);
-    this->fileDescriptor = -1;
-
-    this->createTxtBackup();
-    this->maintainTxtBackups();
-    this->maintainArchivedBackups();
-
-    this->openActiveFile();
+    std::uint64_t used = this->mappedOffset.load();
+    ::munmap(base, this->mappedCapacity);
+    if (::ftruncate(this->fileDescriptor, static_cast<off_t>(used)) != 0)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "truncate failed: %s\n", std::strerror(errno));
+    }
+    this->currentFileSize = used;
 }
 
-bool TXTLog::isRotationRequired(std::size_t incomingDataSize) const
+void TXTLog::trimPreallocatedLocked()
 {
-    std::uintmax_t currentSize = this->getCurrentFileSize();
-    return (currentSize + incomingDataSize) >= this->maxFileSize;
+    std::uint64_t end = findDataEnd(this->activeFilePath, this->currentFileSize);
+    if (end < this->currentFileSize && ::ftruncate(this->fileDescriptor, static_cast<off_t>(end)) == 0)
+    {
+        Debug::warning(__FILE__, __LINE__, __func__, "cut %llu preallocated bytes\n", static_cast<unsigned long long>(this->currentFileSize - end));
+        this->currentFileSize = end;
+    }
 }
 
-/* ================= Backup Handling ================= */
-
-std::string TXTLog::generateTimestampedBackupName() const
+bool TXTLog::setMappedFile(bool enable)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->mappedFile == enable)
+    {
+        return true;
+    }
+
+    if (!enable)
+    {
+        this->mappedFile = false;
+        this->closeMappingLocked();
+        return true;
+    }
+    if (this->compressedStreaming || this->multiProcess)
+    {
+        Debug::warning(__FILE__, __LINE__, __func__, "not available while writing compressed or shared\n");
+        return false;
+    }
+
+    this->flushBufferLocked();
+    this->completeWritesLocked();
+    if (this->fileDescriptor > 0)
+    {
+        this->trimPreallocatedLocked();
+    }
+    /* the first write maps the file, rotating first if it is already full */
+    this->mappedFile = true;
+    return true;
+}
+
+bool TXTLog::isMappedFile() const
+{
+    return this->mappedFile.load();
+}
+
+void TXTLog::setGroupCommit(bool enable)
+{
+    this->groupCommit.store(enable);
+}
+
+bool TXTLog::isGroupCommit() const
+{
+    return this->groupCommit.load();
+}
+
+bool TXTLog::setIoUring(bool enable, std::size_t bufferSize, std::size_t bufferCount)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->flushBufferLocked();
+    if (this->ring)
+    {
+        /* the synchronous path, or a new pool, starts from a settled file */
+        this->completeWritesLocked();
+        if (this->ringFileDescriptor >= 0)
+        {
+            ::close(this->ringFileDescriptor);
+            this->ringFileDescriptor = -1;
+        }
+        this->ring.reset();
+    }
+    if (!enable)
+    {
+        return true;
+    }
+    if (this->multiProcess)
+    {
+        Debug::warning(__FILE__, __LINE__, __func__, "not available while shared with other processes\n");
+        return false;
+    }
+
+    std::unique_ptr<TXTLogRing> created(new TXTLogRing());
+    if (!created->open(bufferSize, bufferCount))
+    {
+        Debug::warning(__FILE__, __LINE__, __func__, "io_uring unavailable, writes stay synchronous\n");
+        return false;
+    }
+    this->ring = std::move(created);
+    if (this->fileDescriptor > 0)
+    {
+        this->openRingFileLocked();
+    }
+    return this->ring != nullptr;
+}
+
+bool TXTLog::isIoUring() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->ring != nullptr;
+}
+
+bool TXTLog::setMultiProcess(bool enable)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->multiProcess == enable)
+    {
+        return true;
+    }
+
+    this->flushBufferLocked();
+    if (!enable)
+    {
+        this->multiProcess = false;
+        this->closeControlLocked();
+        return true;
+    }
+    if (this->mappedFile || this->ring || this->compressedStreaming)
+    {
+        Debug::warning(__FILE__, __LINE__, __func__, "not available with memory-mapped, io_uring or compressed writes\n");
+        return false;
+    }
+    if (!this->openControlLocked())
+    {
+        return false;
+    }
+    this->multiProcess = true;
+    return true;
+}
+
+bool TXTLog::isMultiProcess() const
+{
+    return this->multiProcess.load();
+}
+
+void TXTLog::flush()
+{
+    int fd = -1;
+    char *base = nullptr;
+    std::size_t used = 0;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        this->flushBufferLocked();
+        if (this->ring && this->ringFileDescriptor >= 0)
+        {
+            /* queued behind the pending writes, the caller does not wait for the disk */
+            this->ring->sync(this->ringFileDescriptor);
+            this->ring->submit();
+            return;
+        }
+        /* counted like a writer, so a rotation meanwhile waits before it unmaps */
+        this->mappedWriters.fetch_add(1);
+        base = this->mappedBase.load();
+        if (base != nullptr)
+        {
+            /* pages written after the offset is read are synced by the next flush */
+            used = static_cast<std::size_t>(this->mappedOffset.load());
+        }
+        else
+        {
+            this->mappedWriters.fetch_sub(1);
+        }
+        if (this->fileDescriptor > 0)
+        {
+            fd = ::dup(this->fileDescriptor);
+        }
+    }
+
+    /* writers go on while the disk catches up, a rotation meanwhile cannot close the duplicate */
+    if (base != nullptr)
+    {
+        if (::msync(base, used, MS_SYNC) != 0)
+        {
+            Debug::error(__FILE__, __LINE__, __func__, "msync failed: %s\n", std::strerror(errno));
+        }
+        this->mappedWriters.fetch_sub(1);
+    }
+    if (fd >= 0)
+    {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+void TXTLog::setDurability(DurabilityPolicy policy, std::size_t value)
+{
+    std::lock_guard<std::mutex> lock(this->maintenanceMutex);
+    this->durabilityValue = (policy == DURABILITY_INTERVAL) ? std::max<std::size_t>(value, 1) : value;
+    this->durabilityPolicy = policy;
+    this->unsyncedBytes = 0;
+    if (policy == DURABILITY_INTERVAL)
+    {
+        this->startWorkerLocked();
+    }
+    /* the worker picks up the new interval */
+    this->maintenanceCondition.notify_all();
+}
+
+TXTLog::DurabilityPolicy TXTLog::getDurability() const
+{
+    return static_cast<DurabilityPolicy>(this->durabilityPolicy.load());
+}
+
+bool TXTLog::applyDurability(const std::string &data)
+{
+    switch (this->durabilityPolicy.load())
+    {
+    case DURABILITY_BYTES:
+    {
+        std::size_t threshold = std::max<std::size_t>(this->durabilityValue, 1);
+        if (this->unsyncedBytes.fetch_add(data.size()) + data.size() >= threshold)
+        {
+            /* one writer crosses the threshold and hands the sync to the worker */
+            this->unsyncedBytes = 0;
+            this->requestSync();
+        }
+        return true;
+    }
+    case DURABILITY_CRITICAL:
+        if (hasCriticalRecord(data))
+        {
+            return this->syncData(true);
+        }
+        return true;
+    default:
+        return true;
+    }
+}
+
+bool TXTLog::syncData(bool waitForRing)
+{
+    int fd = -1;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->flushBufferLocked();
+        if (this->ring && this->ringFileDescriptor >= 0)
+        {
+            if (!waitForRing)
+            {
+                this->ring->sync(this->ringFileDescriptor);
+                return this->ring->submit();
+            }
+            this->ring->drain();
+        }
+        if (this->fileDescriptor > 0)
+        {
+            fd = ::dup(this->fileDescriptor);
+        }
+    }
+    if (fd < 0)
+    {
+        return true;
+    }
+
+    bool result = ::fdatasync(fd) == 0;
+    if (!result)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "fdatasync failed: %s\n", std::strerror(errno));
+    }
+    ::close(fd);
+    return result;
+}
+
+bool TXTLog::flushBuffer()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->flushBufferLocked();
+}
+
+bool TXTLog::flushExpired()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    bool result = true;
+    if ((this->ring && this->ring->pendingBytes() > 0 && now - this->ringSince >= this->maxBufferAge) ||
+        (!this->writeBuffer.empty() && now - this->bufferSince >= this->maxBufferAge))
+    {
+        result = this->flushBufferLocked();
+    }
+
+    /* younger data keeps a timer of its own */
+    if (!this->writeBuffer.empty())
+    {
+        this->scheduleFlush(this->bufferSince + this->maxBufferAge);
+    }
+    if (this->ring && this->ring->pendingBytes() > 0)
+    {
+        this->scheduleFlush(this->ringSince + this->maxBufferAge);
+    }
+    return result;
+}
+
+void TXTLog::setBufferSize(std::size_t bufferSize, long maxBufferAgeMs)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->flushBufferLocked();
+    this->writeBufferSize = bufferSize;
+    this->maxBufferAge = std::chrono::milliseconds(maxBufferAgeMs);
+    this->writeBuffer.shrink_to_fit();
+    this->writeBuffer.reserve(bufferSize);
+}
+
+std::size_t TXTLog::getBufferSize() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->writeBufferSize;
+}
+
+void TXTLog::close()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->flushBufferLocked();
+    this->completeWritesLocked();
+    this->closeActiveFileLocked();
+}
+
+void TXTLog::setMaxFileSize(std::size_t maxFileSize)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->maxFileSize = maxFileSize;
+}
+
+std::size_t TXTLog::getMaxFileSize() const
+{
+    return this->maxFileSize;
+}
+
+void TXTLog::setRotationPolicy(RotationPolicy policy, long maxAgeSeconds)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->rotationPolicy = policy;
+    this->rotationAge = static_cast<std::time_t>(std::max<long>(maxAgeSeconds, 1));
+    this->updateRotationDeadlineLocked();
+}
+
+TXTLog::RotationPolicy TXTLog::getRotationPolicy() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return static_cast<RotationPolicy>(this->rotationPolicy);
+}
+
+void TXTLog::setBackgroundMaintenance(bool enable)
+{
+    if (!enable)
+    {
+        this->waitForMaintenance();
+    }
+    std::lock_guard<std::mutex> lock(this->maintenanceMutex);
+    this->backgroundMaintenance = enable;
+}
+
+bool TXTLog::isBackgroundMaintenance() const
+{
+    std::lock_guard<std::mutex> lock(this->maintenanceMutex);
+    return this->backgroundMaintenance;
+}
+
+void TXTLog::waitForMaintenance()
+{
+    std::unique_lock<std::mutex> lock(this->maintenanceMutex);
+    this->maintenanceCondition.wait(lock, [this]()
+                                    { return !this->maintenancePending && !this->maintenanceRunning; });
+}
+
+/* ================= File Handling ================= */
+
+bool TXTLog::openActiveFile()
+{
+    this->fileDescriptor = ::open(this->activeFilePath.c_str(),
+                                  O_CREAT | O_APPEND | O_WRONLY,
+                                  0644);
+
+    Debug::info(__FILE__, __LINE__, __func__, "%s\n", this->activeFilePath.c_str());
+    if (this->fileDescriptor < 0)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed\n");
+        return false;
+    }
+    if (this->fileDescriptor == 0)
+    {
+        ::close(this->fileDescriptor);
+        this->fileDescriptor = -1;
+        Debug::error(__FILE__, __LINE__, __func__, "failed\n");
+        return false;
+    }
+
+    struct stat st;
+    this->currentFileSize = (::fstat(this->fileDescriptor, &st) == 0) ? static_cast<std::uintmax_t>(st.st_size) : 0;
+    if (this->ring)
+    {
+        this->openRingFileLocked();
+    }
+    if (this->mappedFile && this->currentFileSize > 0)
+    {
+        this->trimPreallocatedLocked();
+    }
+    this->updateRotationDeadlineLocked();
+    return true;
+}
+
+void TXTLog::openRingFileLocked()
+{
+    this->ringFileDescriptor = ::open(this->activeFilePath.c_str(), O_WRONLY);
+    if (this->ringFileDescriptor < 0)
+    {
+        Debug::warning(__FILE__, __LINE__, __func__, "%s: %s, writes stay synchronous\n", this->activeFilePath.c_str(), std::strerror(errno));
+        this->ring.reset();
+    }
+}
+
+void TXTLog::closeActiveFileLocked()
+{
+    this->closeMappingLocked();
+    if (this->ringFileDescriptor >= 0)
+    {
+        /* queued writes name the descriptor, the kernel must hold it before it is closed and reused */
+        if (!this->ring->submit())
+        {
+            Debug::error(__FILE__, __LINE__, __func__, "failed\n");
+        }
+        ::close(this->ringFileDescriptor);
+        this->ringFileDescriptor = -1;
+    }
+    if (this->fileDescriptor > 0)
+    {
+        ::close(this->fileDescriptor);
+        this->fileDescriptor = -1;
+    }
+}
+
+bool TXTLog::completeWritesLocked()
+{
+    this->closeMappingLocked();
+    return !this->ring || this->ring->drain();
+}
+
+bool TXTLog::renameLocked(const std::string &from, const std::string &to)
+{
+    if (this->ring)
+    {
+        return this->ring->rename(from.c_str(), to.c_str());
+    }
+    return ::rename(from.c_str(), to.c_str()) == 0;
+}
+
+std::string TXTLog::generateLockName() const
+{
+    return this->workingDirectory + "/" + this->baseFileName + ".lock";
+}
+
+bool TXTLog::openControlLocked()
+{
+    std::string path = this->generateLockName();
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "%s: %s\n", path.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    /* a new lock file reads as zeros, a valid block of generation 0 */
+    struct stat st;
+    void *address = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 &&
+        (static_cast<std::size_t>(st.st_size) >= sizeof(SharedControl) || ::ftruncate(fd, sizeof(SharedControl)) == 0))
+    {
+        address = ::mmap(nullptr, sizeof(SharedControl), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (address == MAP_FAILED)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "%s: %s\n", path.c_str(), std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+    this->controlFileDescriptor = fd;
+    this->control = static_cast<SharedControl *>(address);
+
+    /* nobody appends meanwhile, so the file size is exact; it also repairs a count left by a crash */
+    if (!lockRange(fd, F_WRLCK, APPEND_LOCK))
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed: %s\n", std::strerror(errno));
+        this->closeControlLocked();
+        return false;
+    }
+    this->closeActiveFileLocked();
+    this->openActiveFile();
+    __atomic_store_n(&this->control->size, static_cast<std::uint64_t>(this->currentFileSize), __ATOMIC_RELEASE);
+    this->controlGeneration = __atomic_load_n(&this->control->generation, __ATOMIC_ACQUIRE);
+    lockRange(fd, F_UNLCK, APPEND_LOCK);
+    return true;
+}
+
+void TXTLog::closeControlLocked()
+{
+    if (this->control != nullptr)
+    {
+        ::munmap(this->control, sizeof(SharedControl));
+        this->control = nullptr;
+    }
+    if (this->controlFileDescriptor >= 0)
+    {
+        ::close(this->controlFileDescriptor);
+        this->controlFileDescriptor = -1;
+    }
+}
+
+bool TXTLog::beginSharedAppendLocked()
+{
+    if (!lockRange(this->controlFileDescriptor, F_RDLCK, APPEND_LOCK))
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed: %s\n", std::strerror(errno));
+        return false;
+    }
+    this->followRotationLocked();
+    if (this->fileDescriptor <= 0)
+    {
+        lockRange(this->controlFileDescriptor, F_UNLCK, APPEND_LOCK);
+        return false;
+    }
+    return true;
+}
+
+void TXTLog::endSharedAppendLocked(std::size_t size)
+{
+    __atomic_add_fetch(&this->control->size, static_cast<std::uint64_t>(size), __ATOMIC_ACQ_REL);
+    lockRange(this->controlFileDescriptor, F_UNLCK, APPEND_LOCK);
+}
+
+void TXTLog::followRotationLocked()
+{
+    std::uint64_t generation = __atomic_load_n(&this->control->generation, __ATOMIC_ACQUIRE);
+    if (generation == this->controlGeneration && this->fileDescriptor > 0)
+    {
+        return;
+    }
+    /* our descriptor points at a file another process already turned into a backup */
+    this->closeActiveFileLocked();
+    this->openActiveFile();
+    this->controlGeneration = generation;
+}
+
+bool TXTLog::claimRotationLocked()
+{
+    if (!lockRange(this->controlFileDescriptor, F_WRLCK, APPEND_LOCK))
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed: %s\n", std::strerror(errno));
+        return false;
+    }
+
+    bool rotate = false;
+    if (__atomic_load_n(&this->control->generation, __ATOMIC_ACQUIRE) != this->controlGeneration)
+    {
+        this->followRotationLocked();
+    }
+    else
+    {
+        /* the shared count is only a trigger, the file itself decides */
+        struct stat st;
+        std::uint64_t size = (::fstat(this->fileDescriptor, &st) == 0) ? static_cast<std::uint64_t>(st.st_size) : 0;
+        this->currentFileSize = size;
+        __atomic_store_n(&this->control->size, size, __ATOMIC_RELEASE);
+        rotate = this->isRotationRequired(0);
+    }
+    if (!rotate)
+    {
+        lockRange(this->controlFileDescriptor, F_UNLCK, APPEND_LOCK);
+    }
+    return rotate;
+}
+
+void TXTLog::releaseRotationLocked()
+{
+    __atomic_store_n(&this->control->size, static_cast<std::uint64_t>(this->currentFileSize), __ATOMIC_RELEASE);
+    __atomic_store_n(&this->control->generation, ++this->controlGeneration, __ATOMIC_RELEASE);
+    lockRange(this->controlFileDescriptor, F_UNLCK, APPEND_LOCK);
+}
+
+void TXTLog::rotateIfNeeded()
+{
+    if (this->fileDescriptor <= 0)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed: empty handle\n");
+        return;
+    }
+
+    if (!this->isRotationRequired(0))
+    {
+        return;
+    }
+    this->rotateLocked();
+}
+
+void TXTLog::rotateLocked()
+{
+    /* exactly one of the processes sharing the file rotates it */
+    if (this->control != nullptr && !this->claimRotationLocked())
+    {
+        return;
+    }
+
+    /* data rate of the finished file feeds the automatic codec preset */
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - this->rotationSince).count();
+    if (seconds > 0)
+    {
+        this->incomingRate.store(static_cast<double>(this->currentFileSize) / seconds);
+    }
+    this->rotationSince = now;
+
+    this->closeActiveFileLocked();
+
+    this->retireActiveFile();
+    this->openActiveFile();
+    if (this->control != nullptr)
+    {
+        this->releaseRotationLocked();
+    }
+    this->scheduleMaintenance();
+}
+
+void TXTLog::retireActiveFile()
+{
+    if (!TXTLogCodec::isArchiveName(this->activeFilePath))
+    {
+        this->createTxtBackup();
+        return;
+    }
+
+    /* already compressed, the file becomes an archive by renaming it */
+    std::string extension = this->activeFilePath.substr(this->activeFilePath.find_last_of('.'));
+    std::string archiveName = this->generateArchiveName(this->generateTimestampedBackupName(), extension);
+    if (this->renameLocked(this->activeFilePath, archiveName))
+    {
+        ::rename(TXTLogIndex::pathFor(this->activeFilePath).c_str(), TXTLogIndex::pathFor(archiveName).c_str());
+        this->recordFile(archiveName, this->currentFileSize);
+    }
+}
+
+bool TXTLog::isRotationRequired(std::size_t incomingDataSize)
+{
+    std::uintmax_t currentSize = this->getCurrentFileSize();
+    bool timeOnly = this->rotationPolicy == ROTATE_HOURLY || this->rotationPolicy == ROTATE_DAILY;
+    if (!timeOnly && (currentSize + incomingDataSize) >= this->maxFileSize)
+    {
+        return true;
+    }
+    if (!this->isRotationDeadlinePassed())
+    {
+        return false;
+    }
+    if (currentSize > 0)
+    {
+        return true;
+    }
+    /* nothing was written before the deadline, the empty file starts the next period */
+    this->updateRotationDeadlineLocked();
+    return false;
+}
+
+bool TXTLog::isRotationDeadlinePassed() const
+{
+    std::int64_t deadline = this->rotationDeadline.load(std::memory_order_relaxed);
+    return deadline != 0 && coarseSeconds() >= deadline;
+}
+
+void TXTLog::updateRotationDeadlineLocked()
+{
+    if (this->rotationPolicy == ROTATE_SIZE)
+    {
+        this->rotationDeadline = 0;
+        return;
+    }
+
+    std::time_t since = std::time(nullptr);
+    struct stat st;
+    if (this->rotationPolicy != ROTATE_SIZE_OR_AGE && this->fileDescriptor > 0 &&
+        ::fstat(this->fileDescriptor, &st) == 0 && st.st_size > 0)
+    {
+        since = st.st_mtime;
+    }
+
+    std::tm local;
+    localtime_r(&since, &local);
+    local.tm_sec = 0;
+    local.tm_min = 0;
+    local.tm_isdst = -1; /* mktime() works out DST changes on the way */
+    std::time_t deadline = 0;
+    switch (this->rotationPolicy)
+    {
+    case ROTATE_HOURLY:
+    case ROTATE_SIZE_OR_HOURLY:
+        local.tm_hour++;
+        deadline = std::mktime(&local);
+        break;
+    case ROTATE_DAILY:
+    case ROTATE_SIZE_OR_DAILY:
+        local.tm_hour = 0;
+        local.tm_mday++;
+        deadline = std::mktime(&local);
+        break;
+    default:
+        deadline = since + this->rotationAge;
+        break;
+    }
+    this->rotationDeadline = static_cast<std::int64_t>(deadline);
+}
+
+bool TXTLog::appendLocked(const char *data, std::size_t size)
+{
+    if (this->ring)
+    {
+        this->ring->write(this->ringFileDescriptor, this->currentFileSize, data, size);
+        this->currentFileSize += size;
+        if (!this->ring->submit())
+        {
+            Debug::error(__FILE__, __LINE__, __func__, "failed\n");
+            return false;
+        }
+        return true;
+    }
+
+    if (this->control != nullptr && !this->beginSharedAppendLocked())
+    {
+        return false;
+    }
+
+    bool result = true;
+    std::size_t offset = 0;
+    while (offset < size)
+    {
+        ssize_t written = ::write(this->fileDescriptor, data + offset, size - offset);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            Debug::error(__FILE__, __LINE__, __func__, "failed\n");
+            result = false;
+            break;
+        }
+        offset += static_cast<std::size_t>(written);
+        this->currentFileSize += static_cast<std::uintmax_t>(written);
+    }
+
+    if (this->control != nullptr)
+    {
+        this->endSharedAppendLocked(offset);
+    }
+    return result;
+}
+
+bool TXTLog::queueRingLocked(const char *data, std::size_t size)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    bool started = this->ring->pendingBytes() == 0;
+    if (started)
+    {
+        this->ringSince = now;
+    }
+    this->ring->write(this->ringFileDescriptor, this->currentFileSize, data, size);
+    this->currentFileSize += size;
+
+    /* one submission per pool buffer instead of one per record, the worker submits what goes quiet */
+    if (this->ring->pendingBytes() < this->ring->bufferSize() && now - this->ringSince < this->maxBufferAge)
+    {
+        if (started)
+        {
+            this->scheduleFlush(this->ringSince + this->maxBufferAge);
+        }
+        return true;
+    }
+    if (!this->ring->submit())
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed\n");
+        return false;
+    }
+    return true;
+}
+
+bool TXTLog::appendvLocked(std::vector<struct iovec> &vectors)
+{
+    if (this->ring)
+    {
+        /* one submission for the whole batch */
+        for (const struct iovec &vector : vectors)
+        {
+            this->ring->write(this->ringFileDescriptor, this->currentFileSize, static_cast<const char *>(vector.iov_base), vector.iov_len);
+            this->currentFileSize += vector.iov_len;
+        }
+        if (!this->ring->submit())
+        {
+            Debug::error(__FILE__, __LINE__, __func__, "failed\n");
+            return false;
+        }
+        return true;
+    }
+
+    if (this->control != nullptr && !this->beginSharedAppendLocked())
+    {
+        return false;
+    }
+
+    bool result = true;
+    std::size_t total = 0;
+    std::size_t first = 0;
+    while (first < vectors.size())
+    {
+        int count = static_cast<int>(std::min<std::size_t>(vectors.size() - first, IOV_MAX));
+        ssize_t written = ::writev(this->fileDescriptor, &vectors[first], count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            Debug::error(__FILE__, __LINE__, __func__, "failed\n");
+            result = false;
+            break;
+        }
+        this->currentFileSize += static_cast<std::uintmax_t>(written);
+        total += static_cast<std::size_t>(written);
+
+        /* skip what was written, a partial write resumes inside a vector */
+        std::size_t remaining = static_cast<std::size_t>(written);
+        while (first < vectors.size() && remaining >= vectors[first].iov_len)
+        {
+            remaining -= vectors[first].iov_len;
+            first++;
+        }
+        if (remaining > 0)
+        {
+            vectors[first].iov_base = static_cast<char *>(vectors[first].iov_base) + remaining;
+            vectors[first].iov_len -= remaining;
+        }
+    }
+
+    if (this->control != nullptr)
+    {
+        this->endSharedAppendLocked(total);
+    }
+    return result;
+}
+
+bool TXTLog::flushBufferLocked()
+{
+    if (this->writeBuffer.empty())
+    {
+        /* unbuffered records queued on the ring count as buffered */
+        return !this->ring || this->ring->submit();
+    }
+
+    if (this->fileDescriptor <= 0)
+    {
+        if (!this->openActiveFile())
+        {
+            return false;
+        }
+    }
+
+    this->rotateIfNeeded();
+    bool result;
+    if (this->compressedStreaming)
+    {
+        /* one complete stream per flush, everything flushed so far survives a crash */
+        this->compressedBuffer.clear();
+        std::uint64_t offset = this->currentFileSize;
+        result = this->getCodec()->compressBuffer(this->writeBuffer.data(), this->writeBuffer.size(), this->compressedBuffer) &&
+                 this->appendLocked(this->compressedBuffer.data(), this->compressedBuffer.size());
+        if (result && this->indexedArchives)
+        {
+            result = this->appendIndexLocked(offset, this->writeBuffer.data(), this->writeBuffer.size(), this->compressedBuffer.size());
+        }
+    }
+    else
+    {
+        result = this->appendLocked(this->writeBuffer.data(), this->writeBuffer.size());
+    }
+    this->writeBuffer.clear();
+    return result;
+}
+
+bool TXTLog::appendIndexLocked(std::uint64_t offset, const char *data, std::size_t size, std::size_t compressedSize)
+{
+    TXTLogIndex::Entry entry;
+    entry.offset = offset;
+    entry.compressedSize = compressedSize;
+    entry.rawSize = size;
+    TXTLogIndex::TimeParser parser;
+    TXTLogIndex::scanTimes(data, size, parser, entry.firstMs, entry.lastMs);
+    std::string line = TXTLogIndex::format(entry);
+
+    int fd = ::open(TXTLogIndex::pathFor(this->activeFilePath).c_str(), O_CREAT | O_APPEND | O_WRONLY, 0644);
+    if (fd < 0)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed\n");
+        return false;
+    }
+    bool result = ::write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size());
+    ::close(fd);
+    return result;
+}
+
+std::string TXTLog::generateActiveName() const
+{
+    if (this->compressedStreaming)
+        return this->workingDirectory + "/" + this->baseFileName + ".log" + this->getCodec()->extension();
+    return this->workingDirectory + "/" + this->baseFileName + ".log";
+}
+
+void TXTLog::reopenActiveFileLocked()
+{
+    bool retired = false;
+    this->flushBufferLocked();
+    if (this->fileDescriptor > 0)
+    {
+        this->closeActiveFileLocked();
+        /* do not leave the file of the previous mode behind, it is rotated like a full one */
+        if (this->currentFileSize == 0)
+        {
+            ::unlink(this->activeFilePath.c_str());
+            ::unlink(TXTLogIndex::pathFor(this->activeFilePath).c_str());
+        }
+        else
+        {
+            this->retireActiveFile();
+            retired = true;
+        }
+    }
+    this->activeFilePath = this->generateActiveName();
+    this->openActiveFile();
+    if (retired)
+    {
+        this->scheduleMaintenance();
+    }
+}
+
+/* ================= Maintenance ================= */
+
+void TXTLog::scheduleMaintenance()
+{
+    std::unique_lock<std::mutex> lock(this->maintenanceMutex);
+    if (!this->backgroundMaintenance)
+    {
+        lock.unlock();
+        this->runMaintenance();
+        return;
+    }
+
+    this->maintenancePending = true;
+    this->startWorkerLocked();
+    this->maintenanceCondition.notify_all();
+}
+
+void TXTLog::startWorkerLocked()
+{
+    if (!this->maintenanceThread.joinable())
+    {
+        this->maintenanceStop = false;
+        this->maintenanceThread = std::thread(&TXTLog::maintenanceLoop, this);
+    }
+}
+
+void TXTLog::requestSync()
+{
+    std::lock_guard<std::mutex> lock(this->maintenanceMutex);
+    this->syncPending = true;
+    this->startWorkerLocked();
+    this->maintenanceCondition.notify_all();
+}
+
+void TXTLog::scheduleFlush(std::chrono::steady_clock::time_point deadline)
+{
+    std::lock_guard<std::mutex> lock(this->maintenanceMutex);
+    if (this->flushDeadline != std::chrono::steady_clock::time_point() && this->flushDeadline <= deadline)
+    {
+        return;
+    }
+    this->flushDeadline = deadline;
+    this->startWorkerLocked();
+    this->maintenanceCondition.notify_all();
+}
+
+void TXTLog::maintenanceLoop()
+{
+    const std::chrono::steady_clock::time_point never;
+    std::unique_lock<std::mutex> lock(this->maintenanceMutex);
+    std::chrono::steady_clock::time_point nextSync;
+    for (;;)
+    {
+        bool periodic = this->durabilityPolicy == DURABILITY_INTERVAL;
+        if (!periodic)
+        {
+            nextSync = never;
+        }
+        else if (nextSync == never)
+        {
+            nextSync = std::chrono::steady_clock::now() + std::chrono::milliseconds(this->durabilityValue.load());
+        }
+
+        /* sleep until the periodic sync or the buffer timer, whichever comes first */
+        std::chrono::steady_clock::time_point wakeup = nextSync;
+        if (this->flushDeadline != never && (wakeup == never || this->flushDeadline < wakeup))
+        {
+            wakeup = this->flushDeadline;
+        }
+        auto ready = [this, &wakeup, &never]()
+        {
+            return this->maintenancePending || this->maintenanceStop || this->syncPending ||
+                   (this->flushDeadline != never && (wakeup == never || this->flushDeadline < wakeup));
+        };
+        if (wakeup == never)
+        {
+            this->maintenanceCondition.wait(lock, ready);
+        }
+        else
+        {
+            this->maintenanceCondition.wait_until(lock, wakeup, ready);
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (this->flushDeadline != never && now >= this->flushDeadline)
+        {
+            this->flushDeadline = never;
+            lock.unlock();
+            this->flushExpired();
+            lock.lock();
+        }
+
+        if (this->syncPending || (periodic && now >= nextSync))
+        {
+            this->syncPending = false;
+            lock.unlock();
+            this->syncData(false);
+            lock.lock();
+            if (periodic)
+            {
+                nextSync = std::chrono::steady_clock::now() + std::chrono::milliseconds(this->durabilityValue.load());
+            }
+        }
+
+        if (this->maintenancePending)
+        {
+            /* rotations requested while compressing collapse into one more pass */
+            this->maintenancePending = false;
+            this->maintenanceRunning = true;
+            lock.unlock();
+            this->runMaintenance();
+            lock.lock();
+            this->maintenanceRunning = false;
+            this->maintenanceCondition.notify_all();
+        }
+        else if (this->maintenanceStop)
+        {
+            break;
+        }
+    }
+}
+
+void TXTLog::runMaintenance()
+{
+    /* processes sharing the log take turns, each picking up the backups the others rotated */
+    RangeLock turn(this->multiProcess, this->generateLockName(), F_WRLCK, MAINTENANCE_LOCK);
+    if (this->multiProcess)
+    {
+        this->loadManifest();
+    }
+    this->maintainTxtBackups();
+    this->maintainArchivedBackups();
+}
+
+void TXTLog::stopMaintenance()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->maintenanceMutex);
+        this->maintenanceStop = true;
+        this->maintenanceCondition.notify_all();
+    }
+    if (this->maintenanceThread.joinable())
+    {
+        this->maintenanceThread.join();
+    }
+}
+
+/* ================= Backup Handling ================= */
+
+std::string TXTLog::generateTimestampedBackupName() const
 {
     std::time_t now = std::time(nullptr);
     std::tm tmNow;
     localtime_r(&now, &tmNow);
 
-    char buffer[64];
-    std::strftime(buffer, sizeof(buffer),
-                  "_%Y%m%d.%H%M%S", &tmNow);
+    char buffer[64];
+    std::strftime(buffer, sizeof(buffer),
+                  "_%Y%m%d.%H%M%S", &tmNow);
+
+    std::ostringstream oss;
+    oss << this->workingDirectory << "/" << this->baseFileName << buffer;
+    std::string stem = oss.str();
+    std::string name = stem + ".log";
+
+    /* rotations within one second must not overwrite the previous backup or its archive */
+    const std::string extension = this->getCodec()->extension();
+    for (int i = 1; ::access(name.c_str(), F_OK) == 0 || ::access(this->generateArchiveName(name, extension).c_str(), F_OK) == 0; i++)
+    {
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), "_%03d", i);
+        name = stem + suffix + ".log";
+    }
+    return name;
+}
+
+void TXTLog::createTxtBackup()
+{
+    std::string backupName = this->generateTimestampedBackupName();
+    if (this->renameLocked(this->activeFilePath, backupName))
+    {
+        this->recordFile(backupName, this->currentFileSize);
+    }
+}
+
+void TXTLog::maintainTxtBackups()
+{
+    std::vector<std::string> backups = this->listBackupFiles();
+
+    if (backups.size() <= this->maxTxtBackups)
+    {
+        return;
+    }
 
-    std::ostringstream oss;
-    oss << this->workingDirectory << "/" << this->baseFileName << buffer << ".log";
-    return oss.str();
+    /* collect archivable backups, the manifest is sorted oldest first */
+    std::vector<std::string> toArchive(
+        backups.begin(),
+        backups.end() - this->maxTxtBackups);
+
+    /* archived backups are gone already, a failed one waits for the next pass */
+    std::vector<std::string> failed;
+    bool result = this->createArchive(toArchive, failed);
+    for (const std::string &txtFile : toArchive)
+    {
+        if (std::find(failed.begin(), failed.end(), txtFile) == failed.end())
+            this->archiveFailures.erase(txtFile);
+    }
+    for (const std::string &txtFile : failed)
+    {
+        this->handleArchiveFailure(txtFile);
+    }
+    if (!result)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed\n");
+        return;
+    }
+
+    Debug::info(__FILE__, __LINE__, __func__, "success\n");
 }
 
-void TXTLog::createTxtBackup()
+void TXTLog::handleArchiveFailure(const std::string &txtFile)
 {
-    std::string backupName = this->generateTimestampedBackupName();
-    ::rename(this->activeFilePath.c_str(), backupName.c_str());
+    if (::access(txtFile.c_str(), F_OK) != 0)
+    {
+        this->archiveFailures.erase(txtFile);
+        return;
+    }
+    if (++this->archiveFailures[txtFile] < ARCHIVE_ATTEMPTS)
+    {
+        return;
+    }
+
+    this->archiveFailures.erase(txtFile);
+    std::string quarantined = txtFile + ".failed";
+    if (::rename(txtFile.c_str(), quarantined.c_str()) != 0)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "%s: %s\n", txtFile.c_str(), std::strerror(errno));
+        return;
+    }
+    this->forgetFile(txtFile);
+    Debug::error(__FILE__, __LINE__, __func__, "%s could not be archived, moved to %s\n", txtFile.c_str(), quarantined.c_str());
 }
 
-void TXTLog::maintainTxtBackups()
+/* ================= Archive Handling ================= */
+
+std::string TXTLog::generateArchiveName(const std::string &fileName, const std::string ext) const
 {
-    std::vector<std::string> backups = this->listBackupFiles();
+    if (fileName.empty())
+        return this->workingDirectory + "/archive_" + this->baseFileName + ext;
+
+    size_t lastSlash = fileName.find_last_of("/\\");
+    if (lastSlash != std::string::npos)
+        return this->workingDirectory + "/archive_" + fileName.substr(lastSlash + 1, fileName.length() - (lastSlash + 5)) + ext;
+
+    return this->workingDirectory + "/archive_" + fileName.substr(0, fileName.length() - 4) + ext;
+}
+
+bool TXTLog::compressFile(const std::string &txtFile, const std::string &archiveFile, std::uint32_t threads)
+{
+    std::shared_ptr<TXTLogCodec> codec = this->getCodec();
+
+    struct stat st;
+    if (::stat(txtFile.c_str(), &st) != 0)
+    {
+        /* removed behind our back, drop it so later passes are not stuck on it */
+        Debug::error(__FILE__, __LINE__, __func__, "missing %s\n", txtFile.c_str());
+        this->forgetFile(txtFile);
+        return false;
+    }
+    double inputSize = static_cast<double>(st.st_size);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool compressed = this->indexedArchives ? this->compressFileIndexed(*codec, txtFile, archiveFile, threads)
+                                            : codec->compress(txtFile, archiveFile, threads);
+    if (!compressed)
+    {
+        return false;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Debug::info(__FILE__, __LINE__, __func__, "file %s archived as %s\n", txtFile.c_str(), archiveFile.c_str());
+    this->recordFile(archiveFile, (::stat(archiveFile.c_str(), &st) == 0) ? static_cast<std::uintmax_t>(st.st_size) : 0);
+
+    if (seconds > 0)
+    {
+        codec->tune(this->incomingRate.load(), inputSize / seconds);
+    }
+    return true;
+}
+
+bool TXTLog::compressFileIndexed(TXTLogCodec &codec, const std::string &txtFile, const std::string &archiveFile, std::uint32_t threads)
+{
+    std::ifstream input(txtFile, std::ios::binary);
+    std::ofstream output(archiveFile, std::ios::binary);
+    if (!input || !output)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed to open %s\n", txtFile.c_str());
+        return false;
+    }
+
+    const std::size_t blockSize = std::max<std::size_t>(this->indexBlockSize.load(), 4096);
+    threads = std::max<std::uint32_t>(threads, 1);
+    std::vector<std::string> blocks(threads);
+    std::vector<std::string> packed(threads);
+    std::vector<char> packedOk(threads);
+    std::string carry;
+    std::string index;
+    TXTLogIndex::TimeParser parser;
+    std::uint64_t offset = 0;
+
+    for (;;)
+    {
+        std::size_t count = 0;
+        while (count < threads && readBlock(input, carry, blocks[count], blockSize))
+        {
+            count++;
+        }
+        if (count == 0)
+        {
+            break;
+        }
+
+        auto work = [&](std::size_t i)
+        {
+            packed[i].clear();
+            packedOk[i] = codec.compressBuffer(blocks[i].data(), blocks[i].size(), packed[i]);
+        };
+        std::vector<std::thread> pool;
+        for (std::size_t i = 1; i < count; i++)
+        {
+            pool.emplace_back(work, i);
+        }
+        work(0);
+        for (std::thread &worker : pool)
+        {
+            worker.join();
+        }
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (!packedOk[i])
+            {
+                Debug::error(__FILE__, __LINE__, __func__, "failed to archive file %s\n", txtFile.c_str());
+                return false;
+            }
+            output.write(packed[i].data(), static_cast<std::streamsize>(packed[i].size()));
+
+            TXTLogIndex::Entry entry;
+            entry.offset = offset;
+            entry.compressedSize = packed[i].size();
+            entry.rawSize = blocks[i].size();
+            TXTLogIndex::scanTimes(blocks[i].data(), blocks[i].size(), parser, entry.firstMs, entry.lastMs);
+            index += TXTLogIndex::format(entry);
+            offset += packed[i].size();
+        }
+    }
+
+    output.close();
+    std::ofstream indexOutput(TXTLogIndex::pathFor(archiveFile), std::ios::binary);
+    indexOutput << index;
+    indexOutput.close();
+    if (!output || !indexOutput)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed to write %s\n", archiveFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool TXTLog::createArchive(const std::vector<std::string> &files, std::vector<std::string> &failed)
+{
+    if (files.empty())
+    {
+        return true;
+    }
+
+    std::uint32_t threads = this->archiveThreads.load();
+    if (threads == 0)
+    {
+        threads = std::max<std::uint32_t>(lzma_cputhreads(), 1);
+    }
+
+    const std::string extension = this->getCodec()->extension();
+
+    /* a burst of backups is spread over workers, a single one uses the block encoder */
+    std::size_t workers = std::min<std::size_t>(files.size(), threads);
+    std::uint32_t threadsPerFile = std::max<std::uint32_t>(threads / static_cast<std::uint32_t>(workers), 1);
+    std::vector<char> archived(files.size(), 0);
+    auto archive = [&](std::size_t i)
+    {
+        /* the txt copy goes right away, a later failure must not leave it to be compressed again */
+        if (this->compressFile(files[i], this->generateArchiveName(files[i], extension), threadsPerFile))
+        {
+            archived[i] = 1;
+            ::unlink(files[i].c_str());
+            this->forgetFile(files[i]);
+        }
+    };
+    if (workers <= 1)
+    {
+        for (std::size_t i = 0; i < files.size(); i++)
+        {
+            archive(i);
+        }
+    }
+    else
+    {
+        std::atomic<std::size_t> next(0);
+        std::vector<std::thread> pool;
+        for (std::size_t w = 0; w < workers; w++)
+        {
+            pool.emplace_back([&]()
+                              {
+                                  for (std::size_t i = next++; i < files.size(); i = next++)
+                                  {
+                                      archive(i);
+                                  } });
+        }
+        for (std::thread &worker : pool)
+        {
+            worker.join();
+        }
+    }
+
+    for (std::size_t i = 0; i < files.size(); i++)
+    {
+        if (!archived[i])
+            failed.push_back(files[i]);
+    }
+    return failed.empty();
+}
+
+void TXTLog::setArchiveThreads(std::uint32_t threads)
+{
+    this->archiveThreads.store(threads);
+}
+
+std::uint32_t TXTLog::getArchiveThreads() const
+{
+    return this->archiveThreads.load();
+}
+
+void TXTLog::setCodec(const std::shared_ptr<TXTLogCodec> &codec)
+{
+    if (!codec)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->compressedStreaming)
+    {
+        /* pending data belongs to the old codec's file */
+        this->flushBufferLocked();
+        std::atomic_store(&this->codec, codec);
+        this->reopenActiveFileLocked();
+        return;
+    }
+    std::atomic_store(&this->codec, codec);
+}
+
+void TXTLog::setCompressedStreaming(bool enable)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->compressedStreaming == enable)
+    {
+        return;
+    }
+    if (enable && this->multiProcess)
+    {
+        Debug::warning(__FILE__, __LINE__, __func__, "not available while shared with other processes\n");
+        return;
+    }
+
+    this->flushBufferLocked();
+    if (enable && this->mappedFile)
+    {
+        /* compressed streams are appended whole, the mapping cannot hold them */
+        this->mappedFile = false;
+        this->closeMappingLocked();
+    }
+    this->compressedStreaming = enable;
+    if (enable && this->writeBufferSize == 0)
+    {
+        /* one stream per record would cost more than it saves */
+        this->writeBufferSize = 256 * 1024;
+        this->writeBuffer.reserve(this->writeBufferSize);
+    }
+    this->reopenActiveFileLocked();
+}
+
+bool TXTLog::isCompressedStreaming() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->compressedStreaming;
+}
+
+void TXTLog::setIndexedArchives(bool enable, std::size_t blockSize)
+{
+    this->indexBlockSize.store(std::max<std::size_t>(blockSize, 4096));
+    this->indexedArchives.store(enable);
+}
+
+bool TXTLog::isIndexedArchives() const
+{
+    return this->indexedArchives.load();
+}
+
+std::shared_ptr<TXTLogCodec> TXTLog::getCodec() const
+{
+    return std::atomic_load(&this->codec);
+}
+
+void TXTLog::maintainArchivedBackups()
+{
+    std::vector<std::string> backups = this->listArchiveFiles();
+
+    if (backups.size() <= this->maxArchiveFiles)
+    {
+        return;
+    }
+
+    /* collect old backups, the manifest is sorted oldest first */
+    std::vector<std::string> toRemove(
+        backups.begin(),
+        backups.end() - this->maxArchiveFiles);
+
+    /* delete old archive files together with their index */
+    this->removeFiles(toRemove);
+    for (const std::string &archiveFile : toRemove)
+    {
+        ::unlink(TXTLogIndex::pathFor(archiveFile).c_str());
+    }
+
+    Debug::info(__FILE__, __LINE__, __func__, "success\n");
+}
+
+bool TXTLog::extractXzToFile(const std::string &xzFile, const std::string &outputFile)
+{
+    XzCodec codec;
+    return codec.decompress(xzFile, outputFile);
+}
+
+bool TXTLog::extractArchiveToFile(const std::string &archiveFile, const std::string &outputFile)
+{
+    std::shared_ptr<TXTLogCodec> codec = TXTLogCodec::forArchive(archiveFile);
+    if (!codec)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "unknown archive format: %s\n", archiveFile.c_str());
+        return false;
+    }
+    return codec->decompress(archiveFile, outputFile);
+}
+
+bool TXTLog::extractArchiveRange(const std::string &archiveFile, std::int64_t fromMs, std::int64_t toMs, std::ostream &output)
+{
+    std::shared_ptr<TXTLogCodec> codec = TXTLogCodec::forArchive(archiveFile);
+    if (!codec)
+    {
+        return false;
+    }
+
+    std::vector<TXTLogIndex::Entry> entries;
+    if (!TXTLogIndex::loadFor(archiveFile, entries))
+    {
+        TXTLogIndex::TimeParser parser;
+        std::int64_t lastMs = 0;
+        std::string carry;
+        bool result = codec->decompressStream(archiveFile, [&](const char *data, std::size_t size)
+                                              {
+                                                  carry.append(data, size);
+                                                  std::size_t newline = carry.find_last_of('\n');
+                                                  if (newline != std::string::npos)
+                                                  {
+                                                      filterLines(carry.data(), newline + 1, fromMs, toMs, parser, lastMs, output);
+                                                      carry.erase(0, newline + 1);
+                                                  }
+                                                  return static_cast<bool>(output); });
+        filterLines(carry.data(), carry.size(), fromMs, toMs, parser, lastMs, output);
+        return result;
+    }
+
+    int fd = ::open(archiveFile.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    TXTLogIndex::TimeParser parser;
+    std::string packed;
+    std::string block;
+    bool result = true;
+    for (std::size_t i = 0; i < entries.size() && result; i++)
+    {
+        const TXTLogIndex::Entry &entry = entries[i];
+        if (!entry.overlaps(fromMs, toMs))
+        {
+            continue;
+        }
+
+        packed.resize(entry.compressedSize);
+        result = ::pread(fd, &packed[0], packed.size(), static_cast<off_t>(entry.offset)) == static_cast<ssize_t>(packed.size());
+        block.clear();
+        result = result && codec->decompressBuffer(packed.data(), packed.size(), block);
+        if (result)
+        {
+            /* leading continuation lines belong to the last timestamp of the previous block */
+            std::int64_t lastMs = (i > 0 && entries[i - 1].lastMs != 0) ? entries[i - 1].lastMs : entry.firstMs;
+            filterLines(block.data(), block.size(), fromMs, toMs, parser, lastMs, output);
+        }
+    }
+    ::close(fd);
+    return result;
+}
+
+bool TXTLog::extractTextRange(const std::string &txtFile, std::int64_t fromMs, std::int64_t toMs, std::ostream &output)
+{
+    std::ifstream input(txtFile, std::ios::binary);
+    if (!input)
+    {
+        return false;
+    }
+
+    TXTLogIndex::TimeParser parser;
+    std::int64_t lastMs = 0;
+    std::string carry;
+    std::string block;
+    while (readBlock(input, carry, block, 1048576))
+    {
+        filterLines(block.data(), block.size(), fromMs, toMs, parser, lastMs, output);
+    }
+    return true;
+}
+
+bool TXTLog::extractTimeRange(std::time_t from, std::time_t to, const std::string &outputFile)
+{
+    std::ofstream output(outputFile, std::ios::binary);
+    if (!output)
+    {
+        Debug::error(__FILE__, __LINE__, __func__, "failed to open %s\n", outputFile.c_str());
+        return false;
+    }
+
+    std::int64_t fromMs = static_cast<std::int64_t>(from) * 1000;
+    std::int64_t toMs = static_cast<std::int64_t>(to) * 1000 + 999;
+
+    std::vector<std::string> archiveFiles;
+    std::vector<std::string> txtFiles;
+    std::vector<std::string> links;
+    std::string activeFile;
+    bool compressed = false;
+    std::uint64_t activeLimit = 0;
+
+    this->waitForMaintenance();
+    {
+        /* writers only wait while the file set and the active file length are captured */
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->flushBufferLocked();
+        this->completeWritesLocked();
+        RangeLock shared(this->multiProcess, this->generateLockName(), F_RDLCK, MAINTENANCE_LOCK);
+        if (this->multiProcess)
+        {
+            this->loadManifest();
+        }
+
+        for (const std::string &file : this->listArchiveFiles())
+            archiveFiles.push_back(this->pinFile(file, links));
+        for (const std::string &file : this->listBackupFiles())
+            txtFiles.push_back(this->pinFile(file, links));
+        activeFile = this->pinFile(this->activeFilePath, links);
+        compressed = this->compressedStreaming;
+        activeLimit = static_cast<std::uint64_t>(this->getCurrentFileSize());
+    }
+
+    for (const std::string &archiveFile : archiveFiles)
+    {
+        if (!this->extractArchiveRange(archiveFile, fromMs, toMs, output))
+        {
+            Debug::error(__FILE__, __LINE__, __func__, "failed to read %s\n", archiveFile.c_str());
+        }
+    }
+    for (const std::string &txtFile : txtFiles)
+    {
+        this->extractTextRange(txtFile, fromMs, toMs, output);
+    }
+
+    TXTLogIndex::TimeParser parser;
+    std::int64_t lastMs = 0;
+    std::string carry;
+    TXTLog::readFilePrefix(activeFile, compressed, activeLimit, [&](const char *data, std::size_t size)
+                         {
+                             carry.append(data, size);
+                             std::size_t newline = carry.find_last_of('\n');
+                             if (newline != std::string::npos)
+                             {
+                                 filterLines(carry.data(), newline + 1, fromMs, toMs, parser, lastMs, output);
+                                 carry.erase(0, newline + 1);
+                             }
+                             return static_cast<bool>(output); });
+    filterLines(carry.data(), carry.size(), fromMs, toMs, parser, lastMs, output);
+
+    this->removeFiles(links);
+    output.close();
+    return static_cast<bool>(output);
+}
 
-    if (backups.size() <= this->maxTxtBackups)
+bool TXTLog::queryFile(const std::string &file, bool archive, QueryScanner &scanner)
+{
+    if (!archive)
     {
-        return;
+        std::ifstream input(file, std::ios::binary);
+        if (!input)
+        {
+            return false;
+        }
+        std::vector<char> buffer(1048576);
+        while (input)
+        {
+            input.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            scanner.feed(buffer.data(), static_cast<std::size_t>(input.gcount()));
+        }
+        scanner.finish();
+        return true;
     }
 
-    /* collect archivable backups */
-    std::sort(backups.begin(), backups.end());
+    std::shared_ptr<TXTLogCodec> codec = TXTLogCodec::forArchive(file);
+    if (!codec)
+    {
+        return false;
+    }
 
-    std::vector<std::string> toArchive(
-        backups.begin(),
-        backups.end() - this->maxTxtBackups);
+    std::vector<TXTLogIndex::Entry> entries;
+    if (!scanner.isBounded() || !TXTLogIndex::loadFor(file, entries))
+    {
+        bool result = codec->decompressStream(file, [&scanner](const char *data, std::size_t size)
+                                              {
+                                                  scanner.feed(data, size);
+                                                  return true; });
+        scanner.finish();
+        return result;
+    }
 
-    /* archive file and delete archived files */
-    this->createArchive(toArchive);
-    this->removeFiles(toArchive);
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
 
-    Debug::info(__FILE__, __LINE__, __func__, "success\n");
+    std::string packed;
+    std::string block;
+    bool result = true;
+    for (std::size_t i = 0; i < entries.size() && result; i++)
+    {
+        if (!entries[i].overlaps(scanner.getFromMs(), scanner.getToMs()))
+        {
+            scanner.finish();
+            continue;
+        }
+        packed.resize(entries[i].compressedSize);
+        block.clear();
+        result = ::pread(fd, &packed[0], packed.size(), static_cast<off_t>(entries[i].offset)) == static_cast<ssize_t>(packed.size()) &&
+                 codec->decompressBuffer(packed.data(), packed.size(), block);
+        if (result)
+        {
+            scanner.feed(block.data(), block.size());
+        }
+    }
+    ::close(fd);
+    scanner.finish();
+    return result;
 }
 
-/* ================= Archive Handling ================= */
-
-std::string TXTLog::generateArchiveName(const std::string &fileName, const std::string ext) const
+std::string TXTLog::pinFile(const std::string &file, std::vector<std::string> &links)
 {
-    if (fileName.empty())
-        return this->workingDirectory + "/archive_" + this->baseFileName + ext;
-
-    size_t lastSlash = fileName.find_last_of("/\\");
-    if (lastSlash != std::string::npos)
-        return this->workingDirectory + "/archive_" + fileName.substr(lastSlash + 1, fileName.length() - (lastSlash + 5)) + ext;
-
-    return this->workingDirectory + "/archive_" + fileName.substr(0, fileName.length() - 4) + ext;
+    std::string name = file.substr(file.find_last_of("/\\") + 1);
+    std::string staged = this->workingDirectory + "/.snapshot-" + std::to_string(::getpid()) + "-" +
+                         std::to_string(pinSequence++) + "-" + name;
+    if (::link(file.c_str(), staged.c_str()) != 0)
+        return file;
+    links.push_back(staged);
+    return staged;
 }
 
-bool TXTLog::createArchive(const std::vector<std::string> &files)
+bool TXTLog::readFilePrefix(const std::string &file, bool archive, std::uint64_t limit, const std::function<bool(const char *, std::size_t)> &consumer)
 {
-    if (files.empty())
+    if (limit == 0)
     {
         return true;
     }
 
-    for (const std::string &txtFile : files)
+    std::ifstream input(file, std::ios::binary);
+    if (!input)
     {
-        std::string xzFile = generateArchiveName(txtFile, ".xz");
-        std::ifstream inputFile(txtFile, std::ios::binary);
-        std::ofstream outputFile(xzFile, std::ios::binary);
+        return false;
+    }
 
-        lzma_stream stream = LZMA_STREAM_INIT;
-        if (lzma_easy_encoder(&stream, 6, LZMA_CHECK_CRC64) != LZMA_OK)
+    if (archive)
+    {
+        /* only the streams completed before the length was captured are decoded */
+        std::shared_ptr<TXTLogCodec> codec = TXTLogCodec::forArchive(file);
+        if (!codec)
+        {
             return false;
+        }
+        std::string packed;
+        packed.resize(static_cast<std::size_t>(limit));
+        input.read(&packed[0], static_cast<std::streamsize>(packed.size()));
+        packed.resize(static_cast<std::size_t>(input.gcount()));
+        return codec->decompressBuffer(packed.data(), packed.size(), consumer);
+    }
 
-        const std::size_t bufferSize = 4096;
-        std::vector<unsigned char> inBuffer(bufferSize);
-        std::vector<unsigned char> outBuffer(bufferSize);
-        lzma_action action = LZMA_RUN;
-
-        bool isRun = true;
-
-        while (isRun)
+    std::vector<char> buffer(1048576);
+    while (limit > 0 && input)
+    {
+        input.read(buffer.data(), static_cast<std::streamsize>(std::min<std::uint64_t>(buffer.size(), limit)));
+        std::size_t size = static_cast<std::size_t>(input.gcount());
+        if (size == 0 || !consumer(buffer.data(), size))
         {
-            if (!inputFile.eof())
-            {
-                inputFile.read(reinterpret_cast<char *>(inBuffer.data()), bufferSize);
-                stream.avail_in = inputFile.gcount();
-                stream.next_in = inBuffer.data();
-            }
-            else
-            {
-                stream.avail_in = 0;
-                action = LZMA_FINISH;
-            }
-
-            do
-            {
-                stream.avail_out = bufferSize;
-                stream.next_out = outBuffer.data();
-
-                lzma_ret ret = lzma_code(&stream, action);
-
-                size_t writeSize = bufferSize - stream.avail_out;
-                outputFile.write(reinterpret_cast<char *>(outBuffer.data()), writeSize);
-
-                if (ret == LZMA_STREAM_END)
-                {
-                    lzma_end(&stream);
-                    Debug::info(__FILE__, __LINE__, __func__, "file %s archived as %s\n", txtFile.c_str(), xzFile.c_str());
-                    isRun = false;
-                    break;
-                }
-                else if (ret != LZMA_OK)
-                {
-                    lzma_end(&stream);
-                    Debug::info(__FILE__, __LINE__, __func__, "failed to archive file %s\n", txtFile.c_str());
-                    isRun = false;
-                    break;
-                }
-            } while (stream.avail_out == 0);
+            break;
         }
+        limit -= size;
     }
-    return true;
+    return limit == 0;
 }
 
-void TXTLog::maintainArchivedBackups()
+bool TXTLog::query(const Query &query, std::vector<Record> &records)
 {
-    std::vector<std::string> backups = this->listArchiveFiles();
+    /* oldest first, so equal timestamps keep the order they were written in */
+    std::vector<QuerySource> sources;
+    std::vector<std::string> links;
+    const std::uint64_t unlimited = std::numeric_limits<std::uint64_t>::max();
 
-    if (backups.size() <= this->maxArchiveFiles)
+    this->waitForMaintenance();
     {
-        return;
-    }
-
-    /* collect old backups */
-    std::sort(backups.begin(), backups.end());
-
-    std::vector<std::string> toRemove(
-        backups.begin(),
-        backups.end() - this->maxArchiveFiles);
+        /* writers only wait while the file set and the active file length are captured */
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->flushBufferLocked();
+        this->completeWritesLocked();
+        RangeLock shared(this->multiProcess, this->generateLockName(), F_RDLCK, MAINTENANCE_LOCK);
+        if (this->multiProcess)
+        {
+            this->loadManifest();
+        }
 
-    /* delete old archive files */
-    this->removeFiles(toRemove);
+        for (const std::string &file : this->listArchiveFiles())
+            sources.push_back(QuerySource{this->pinFile(file, links), true, unlimited});
+        for (const std::string &file : this->listBackupFiles())
+            sources.push_back(QuerySource{this->pinFile(file, links), false, unlimited});
+        sources.push_back(QuerySource{this->pinFile(this->activeFilePath, links), static_cast<bool>(this->compressedStreaming),
+                                      static_cast<std::uint64_t>(this->getCurrentFileSize())});
+    }
 
-    Debug::info(__FILE__, __LINE__, __func__, "success\n");
+    bool result = TXTLog::queryFiles(query, sources, records);
+    this->removeFiles(links);
+    return result;
 }
 
-bool TXTLog::extractXzToFile(const std::string &xzFile, const std::string &outputFile)
+bool TXTLog::queryDirectory(const std::string &workingDirectory, const std::string &baseFileName, const Query &query, std::vector<Record> &records)
 {
-    std::ifstream input(xzFile, std::ios::binary);
-    std::ofstream output(outputFile, std::ios::binary);
-
-    if (!input || !output)
-        return false;
-
-    lzma_stream stream = LZMA_STREAM_INIT;
-    if (lzma_stream_decoder(&stream, UINT64_MAX, 0) != LZMA_OK)
-        return false;
-
-    const std::size_t bufferSize = 4096;
-    std::vector<uint8_t> inBuffer(bufferSize);
-    std::vector<uint8_t> outBuffer(bufferSize);
-
-    lzma_action action = LZMA_RUN;
-    bool done = false;
+    std::vector<ManifestEntry> backups;
+    std::vector<ManifestEntry> archives;
+    std::vector<std::string> activeFiles;
+    TXTLog::scanDirectory(workingDirectory, baseFileName, backups, archives, activeFiles);
+
+    std::vector<QuerySource> sources;
+    const std::uint64_t unlimited = std::numeric_limits<std::uint64_t>::max();
+    for (const ManifestEntry &file : archives)
+        sources.push_back(QuerySource{file.path, true, unlimited});
+    for (const ManifestEntry &file : backups)
+        sources.push_back(QuerySource{file.path, false, unlimited});
+    for (const std::string &file : activeFiles)
+    {
+        /* only whole records, a memory-mapped file is preallocated with zeros */
+        struct stat st;
+        if (::stat(file.c_str(), &st) != 0)
+            continue;
+        bool archive = TXTLogCodec::isArchiveName(file);
+        std::uint64_t size = static_cast<std::uint64_t>(st.st_size);
+        sources.push_back(QuerySource{file, archive, archive ? size : findDataEnd(file, size)});
+    }
+    return TXTLog::queryFiles(query, sources, records);
+}
 
-    while (!done)
+bool TXTLog::queryFiles(const Query &query, const std::vector<QuerySource> &sources, std::vector<Record> &records)
+{
+    std::unique_ptr<std::regex> regex;
+    if (!query.pattern.empty())
     {
-        if (!input.eof())
+        try
         {
-            input.read(reinterpret_cast<char *>(inBuffer.data()), bufferSize);
-            stream.avail_in = input.gcount();
-            stream.next_in = inBuffer.data();
+            regex.reset(new std::regex(query.pattern));
         }
-        else
+        catch (const std::regex_error &e)
         {
-            stream.avail_in = 0;
-            action = LZMA_FINISH;
+            Debug::error(__FILE__, __LINE__, __func__, "invalid pattern %s: %s\n", query.pattern.c_str(), e.what());
+            return false;
         }
+    }
 
-        do
-        {
-            stream.avail_out = bufferSize;
-            stream.next_out = outBuffer.data();
+    AhoCorasick matcher;
+    for (const std::string &text : query.contains)
+    {
+        if (!text.empty())
+            matcher.add(text);
+    }
+    matcher.build();
 
-            lzma_ret ret = lzma_code(&stream, action);
+    std::int64_t fromMs = (query.from != 0) ? static_cast<std::int64_t>(query.from) * 1000 : std::numeric_limits<std::int64_t>::min();
+    std::int64_t toMs = (query.to != 0) ? static_cast<std::int64_t>(query.to) * 1000 + 999 : std::numeric_limits<std::int64_t>::max();
 
-            std::size_t writeSize = bufferSize - stream.avail_out;
-            output.write(reinterpret_cast<char *>(outBuffer.data()), writeSize);
+    std::vector<std::unique_ptr<QueryScanner>> scanners;
+    for (std::size_t i = 0; i < sources.size(); i++)
+    {
+        scanners.emplace_back(new QueryScanner(query, fromMs, toMs, matcher, regex.get()));
+    }
 
-            if (ret == LZMA_STREAM_END)
+    std::atomic<std::size_t> next(0);
+    auto work = [&]()
+    {
+        for (std::size_t i = next++; i < sources.size(); i = next++)
+        {
+            const QuerySource &source = sources[i];
+            bool result;
+            if (source.limit == std::numeric_limits<std::uint64_t>::max())
             {
-                done = true;
-                break;
+                result = TXTLog::queryFile(source.path, source.archive, *scanners[i]);
             }
-            else if (ret != LZMA_OK)
+            else
             {
-                lzma_end(&stream);
-                return false;
+                /* the active file keeps growing, only the captured length is scanned */
+                QueryScanner &scanner = *scanners[i];
+                result = TXTLog::readFilePrefix(source.path, source.archive, source.limit, [&scanner](const char *data, std::size_t size)
+                                                {
+                                                    scanner.feed(data, size);
+                                                    return true; });
+                scanner.finish();
             }
-
-        } while (stream.avail_out == 0);
+            if (!result)
+                Debug::error(__FILE__, __LINE__, __func__, "failed to read %s\n", source.path.c_str());
+        }
+    };
+    std::size_t workers = std::min<std::size_t>(sources.size(), std::max<unsigned int>(std::thread::hardware_concurrency(), 1));
+    std::vector<std::thread> pool;
+    for (std::size_t w = 1; w < workers; w++)
+    {
+        pool.emplace_back(work);
+    }
+    work();
+    for (std::thread &worker : pool)
+    {
+        worker.join();
     }
 
-    lzma_end(&stream);
+    /* merge by time, files were listed oldest first */
+    std::vector<std::pair<std::size_t, std::size_t>> order;
+    for (std::size_t f = 0; f < scanners.size(); f++)
+    {
+        for (std::size_t r = 0; r < scanners[f]->records.size(); r++)
+            order.push_back(std::make_pair(f, r));
+    }
+    std::stable_sort(order.begin(), order.end(), [&scanners](const std::pair<std::size_t, std::size_t> &a, const std::pair<std::size_t, std::size_t> &b)
+                     { return scanners[a.first]->keys[a.second] < scanners[b.first]->keys[b.second]; });
+    records.reserve(records.size() + order.size());
+    for (const std::pair<std::size_t, std::size_t> &position : order)
+    {
+        records.push_back(std::move(scanners[position.first]->records[position.second]));
+    }
     return true;
 }
 
@@ -463,61 +2746,192 @@ bool TXTLog::addFolderToZip(void *zipHandle, const std::string &basePath, const
 
 std::uintmax_t TXTLog::getCurrentFileSize() const
 {
-    struct stat st;
-    if (::stat(this->activeFilePath.c_str(), &st) == 0)
+    if (this->control != nullptr)
+    {
+        return __atomic_load_n(&this->control->size, __ATOMIC_ACQUIRE);
+    }
+    if (this->mappedBase.load() != nullptr)
     {
-        return static_cast<std::uintmax_t>(st.st_size);
+        return this->mappedOffset.load();
     }
-    return 0;
+    return this->currentFileSize;
 }
 
 std::vector<std::string> TXTLog::listBackupFiles() const
 {
+    std::lock_guard<std::mutex> lock(this->manifestMutex);
+    std::vector<std::string> result;
+    result.reserve(this->manifestBackups.size());
+    for (const ManifestEntry &entry : this->manifestBackups)
+    {
+        result.push_back(entry.path);
+    }
+    return result;
+}
+
+std::vector<std::string> TXTLog::listArchiveFiles() const
+{
+    std::lock_guard<std::mutex> lock(this->manifestMutex);
     std::vector<std::string> result;
+    result.reserve(this->manifestArchives.size());
+    for (const ManifestEntry &entry : this->manifestArchives)
+    {
+        result.push_back(entry.path);
+    }
+    return result;
+}
+
+bool TXTLog::parseBackupName(const std::string &baseFileName, const std::string &name, std::string &key)
+{
+    /* <base>_<key>.log */
+    const std::string &base = baseFileName;
+    if (name.size() <= base.size() + 5 || name.compare(0, base.size(), base) != 0 || name[base.size()] != '_' ||
+        name.compare(name.size() - 4, 4, ".log") != 0)
+    {
+        return false;
+    }
+    key = name.substr(base.size() + 1, name.size() - base.size() - 5);
+    return isTimestampKey(key);
+}
+
+bool TXTLog::parseArchiveName(const std::string &baseFileName, const std::string &name, std::string &key)
+{
+    /* archive_<base>_<key><ext> */
+    const std::string prefix = "archive_" + baseFileName + "_";
+    if (name.compare(0, prefix.size(), prefix) != 0 || !TXTLogCodec::isArchiveName(name))
+    {
+        return false;
+    }
+    std::size_t extension = name.find_last_of('.');
+    if (extension < prefix.size())
+    {
+        return false;
+    }
+    key = name.substr(prefix.size(), extension - prefix.size());
+    return isTimestampKey(key);
+}
 
-    DIR *dp = ::opendir(this->workingDirectory.c_str());
+void TXTLog::scanDirectory(const std::string &workingDirectory,
+                           const std::string &baseFileName,
+                           std::vector<ManifestEntry> &backups,
+                           std::vector<ManifestEntry> &archives,
+                           std::vector<std::string> &activeFiles)
+{
+    DIR *dp = ::opendir(workingDirectory.c_str());
     if (!dp)
     {
-        return result;
+        return;
     }
 
+    const std::string active = baseFileName + ".log";
     struct dirent *entry;
     while ((entry = ::readdir(dp)) != nullptr)
     {
         std::string name(entry->d_name);
-        if (name.find(this->baseFileName) == 0 && name.find(".log") != std::string::npos)
+        std::string key;
+        std::vector<ManifestEntry> *list = nullptr;
+        if (TXTLog::parseBackupName(baseFileName, name, key))
+            list = &backups;
+        else if (TXTLog::parseArchiveName(baseFileName, name, key))
+            list = &archives;
+        else
         {
-            result.push_back(this->workingDirectory + "/" + name);
+            /* "<base>.log", or "<base>.log<ext>" in compress-as-you-write mode */
+            if (name.compare(0, active.size(), active) == 0 &&
+                (name.size() == active.size() || (TXTLogCodec::isArchiveName(name) && name.find('.', active.size() + 1) == std::string::npos)))
+                activeFiles.push_back(workingDirectory + "/" + name);
+            continue;
         }
-    }
 
+        ManifestEntry file;
+        file.path = workingDirectory + "/" + name;
+        file.key = key;
+        struct stat st;
+        file.size = (::stat(file.path.c_str(), &st) == 0) ? static_cast<std::uintmax_t>(st.st_size) : 0;
+        list->push_back(file);
+    }
     ::closedir(dp);
-    return result;
+
+    auto byKey = [](const ManifestEntry &a, const ManifestEntry &b)
+    {
+        return a.key < b.key;
+    };
+    std::sort(backups.begin(), backups.end(), byKey);
+    std::sort(archives.begin(), archives.end(), byKey);
+    /* a plain file left by an earlier mode is older than a compressed one */
+    std::sort(activeFiles.begin(), activeFiles.end());
 }
 
-std::vector<std::string> TXTLog::listArchiveFiles() const
+void TXTLog::loadManifest()
 {
-    std::vector<std::string> result;
+    std::lock_guard<std::mutex> lock(this->manifestMutex);
+    this->manifestBackups.clear();
+    this->manifestArchives.clear();
+    std::vector<std::string> activeFiles;
+    TXTLog::scanDirectory(this->workingDirectory, this->baseFileName, this->manifestBackups, this->manifestArchives, activeFiles);
+}
 
-    DIR *dp = ::opendir(this->workingDirectory.c_str());
-    if (!dp)
+void TXTLog::recordFile(const std::string &path, std::uintmax_t size)
+{
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    ManifestEntry file;
+    file.path = path;
+    file.size = size;
+
+    std::lock_guard<std::mutex> lock(this->manifestMutex);
+    std::vector<ManifestEntry> *list = nullptr;
+    if (TXTLog::parseBackupName(this->baseFileName, name, file.key))
+        list = &this->manifestBackups;
+    else if (TXTLog::parseArchiveName(this->baseFileName, name, file.key))
+        list = &this->manifestArchives;
+    else
+        return;
+
+    std::vector<ManifestEntry>::iterator it = std::lower_bound(list->begin(), list->end(), file, [](const ManifestEntry &a, const ManifestEntry &b)
+                                                               { return a.key < b.key; });
+    /* the same name again (archive rewritten after a failed pass) replaces the entry */
+    for (std::vector<ManifestEntry>::iterator same = it; same != list->end() && same->key == file.key; ++same)
     {
-        return result;
+        if (same->path == path)
+        {
+            same->size = size;
+            return;
+        }
     }
+    list->insert(it, file);
+}
 
-    struct dirent *entry;
-    std::string baseArchiveName = "archive_" + this->baseFileName;
-    while ((entry = ::readdir(dp)) != nullptr)
+void TXTLog::forgetFile(const std::string &path)
+{
+    auto erase = [&path](std::vector<ManifestEntry> &list)
     {
-        std::string name(entry->d_name);
-        if (name.find(baseArchiveName) == 0 && name.find(".xz") != std::string::npos)
+        for (std::vector<ManifestEntry>::iterator it = list.begin(); it != list.end(); ++it)
         {
-            result.push_back(this->workingDirectory + "/" + name);
+            if (it->path == path)
+            {
+                list.erase(it);
+                return true;
+            }
         }
+        return false;
+    };
+
+    std::lock_guard<std::mutex> lock(this->manifestMutex);
+    if (!erase(this->manifestBackups))
+    {
+        erase(this->manifestArchives);
     }
+}
 
-    ::closedir(dp);
-    return result;
+std::uintmax_t TXTLog::getStoredSize() const
+{
+    std::lock_guard<std::mutex> lock(this->manifestMutex);
+    std::uintmax_t total = 0;
+    for (const ManifestEntry &entry : this->manifestBackups)
+        total += entry.size;
+    for (const ManifestEntry &entry : this->manifestArchives)
+        total += entry.size;
+    return total;
 }
 
 void TXTLog::removeFiles(const std::vector<std::string> &files)
@@ -525,48 +2939,246 @@ void TXTLog::removeFiles(const std::vector<std::string> &files)
     for (const auto &file : files)
     {
         ::unlink(file.c_str());
+        this->forgetFile(file);
     }
 }
 
 #ifndef __DISABLE_MINIZIP
+namespace
+{
+    /* decoded chunks of one archive, bounded so decoding runs only a little ahead of the zip writer */
+    class SnapshotPipe
+    {
+    private:
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<std::string> chunks;
+        bool finished;
+        bool cancelled;
+        bool result;
+
+    public:
+        static const std::size_t MAX_CHUNKS = 8;
+
+        SnapshotPipe() : mutex(), condition(), chunks(), finished(false), cancelled(false), result(false) {}
+
+        /* producer side, false once the writer gave up */
+        bool push(const char *data, std::size_t size)
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition.wait(lock, [this]()
+                                 { return this->chunks.size() < MAX_CHUNKS || this->cancelled; });
+            if (this->cancelled)
+                return false;
+            this->chunks.emplace_back(data, size);
+            this->condition.notify_all();
+            return true;
+        }
+
+        void finish(bool result)
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->finished = true;
+            this->result = result;
+            this->condition.notify_all();
+        }
+
+        void cancel()
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->cancelled = true;
+            this->condition.notify_all();
+        }
+
+        /* writer side, false once the producer finished and every chunk was taken */
+        bool pop(std::string &chunk)
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition.wait(lock, [this]()
+                                 { return !this->chunks.empty() || this->finished; });
+            if (this->chunks.empty())
+                return false;
+            chunk.swap(this->chunks.front());
+            this->chunks.pop_front();
+            this->condition.notify_all();
+            return true;
+        }
+
+        bool succeeded()
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            return this->result;
+        }
+    };
+
+    struct SnapshotSource
+    {
+        std::string path;
+        std::string entryName;
+        bool archive;
+        std::uint64_t limit;
+    };
+
+    bool writeFileToZip(zipFile zf, const std::string &path, std::uint64_t limit)
+    {
+        std::ifstream input(path, std::ios::binary);
+        if (!input)
+            return false;
+
+        std::vector<char> buffer(256 * 1024);
+        while (limit > 0 && input)
+        {
+            input.read(buffer.data(), static_cast<std::streamsize>(std::min<std::uint64_t>(buffer.size(), limit)));
+            std::size_t readSize = static_cast<std::size_t>(input.gcount());
+            if (readSize > 0 && zipWriteInFileInZip(zf, buffer.data(), static_cast<unsigned int>(readSize)) < 0)
+                return false;
+            limit -= readSize;
+        }
+        return true;
+    }
+}
+
 bool TXTLog::createZipSnapshot(const std::string &zipFilePath)
 {
-    std::lock_guard<std::mutex> lock(this->mutex);
+    std::vector<SnapshotSource> sources;
+    std::vector<std::string> links;
 
-    zipFile zf = zipOpen(zipFilePath.c_str(), APPEND_STATUS_CREATE);
-    if (!zf)
-        return false;
+    /* pin every file with a hard link so rotation and retention cannot pull it away while it is read */
+    auto pin = [&](const std::string &file) -> std::string
+    {
+        return this->pinFile(file, links);
+    };
+    auto entryFor = [](const std::string &file, bool archive) -> std::string
+    {
+        std::string name = file.substr(file.find_last_of("/\\") + 1);
+        if (!archive)
+            return name;
+        return name.substr(0, name.find_last_of('.')) + ".log";
+    };
+
+    this->waitForMaintenance();
+    {
+        /* writers only wait while the file set and the active file length are captured */
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->flushBufferLocked();
+        this->completeWritesLocked();
+        RangeLock shared(this->multiProcess, this->generateLockName(), F_RDLCK, MAINTENANCE_LOCK);
+        if (this->multiProcess)
+        {
+            this->loadManifest();
+        }
 
-    std::vector<std::string> txtFiles = this->listBackupFiles();
-    txtFiles.push_back(this->activeFilePath);
+        std::vector<std::string> txtFiles = this->listBackupFiles();
+        std::vector<std::string> archiveFiles = this->listArchiveFiles();
+
+        const std::uint64_t unlimited = std::numeric_limits<std::uint64_t>::max();
+        for (const auto &file : archiveFiles)
+            sources.push_back(SnapshotSource{pin(file), entryFor(file, true), true, unlimited});
+        for (const auto &file : txtFiles)
+            sources.push_back(SnapshotSource{pin(file), entryFor(file, false), false, unlimited});
+        bool compressed = this->compressedStreaming;
+        sources.push_back(SnapshotSource{pin(this->activeFilePath), entryFor(this->activeFilePath, compressed), compressed,
+                                         static_cast<std::uint64_t>(this->getCurrentFileSize())});
+    }
 
-    for (const auto &file : txtFiles)
+    /* archives are decoded by workers in snapshot order, each a few chunks ahead of the writer */
+    std::vector<std::size_t> archives;
+    std::vector<std::unique_ptr<SnapshotPipe>> pipes(sources.size());
+    for (std::size_t i = 0; i < sources.size(); i++)
     {
-        std::string entryName = file.substr(file.find_last_of("/\\") + 1);
-        if (!this->addFileToZip(zf, file, entryName))
+        if (sources[i].archive)
         {
-            zipClose(zf, nullptr);
-            return false;
+            archives.push_back(i);
+            pipes[i].reset(new SnapshotPipe());
         }
     }
 
-    std::vector<std::string> archiveFiles = this->listArchiveFiles();
+    std::atomic<std::size_t> next(0);
+    auto decode = [&]()
+    {
+        for (std::size_t n = next++; n < archives.size(); n = next++)
+        {
+            const SnapshotSource &source = sources[archives[n]];
+            SnapshotPipe &pipe = *pipes[archives[n]];
+            TXTLogCodec::Consumer consumer = [&pipe](const char *data, std::size_t size)
+            {
+                return pipe.push(data, size);
+            };
 
-    for (const auto &xzFile : archiveFiles)
+            std::shared_ptr<TXTLogCodec> codec = TXTLogCodec::forArchive(source.path);
+            bool result = false;
+            if (codec && source.limit == std::numeric_limits<std::uint64_t>::max())
+            {
+                result = codec->decompressStream(source.path, consumer);
+            }
+            else if (codec)
+            {
+                /* the active file keeps growing, only the captured streams are decoded */
+                std::string packed;
+                std::ifstream input(source.path, std::ios::binary);
+                packed.resize(static_cast<std::size_t>(source.limit));
+                input.read(&packed[0], static_cast<std::streamsize>(packed.size()));
+                packed.resize(static_cast<std::size_t>(input.gcount()));
+                result = codec->decompressBuffer(packed.data(), packed.size(), consumer);
+            }
+            pipe.finish(result);
+        }
+    };
+    std::size_t workers = std::min<std::size_t>(archives.size(), std::max<unsigned int>(std::thread::hardware_concurrency(), 1));
+    std::vector<std::thread> pool;
+    for (std::size_t w = 0; w < workers; w++)
     {
-        std::string tempTxt = xzFile.substr(0, xzFile.length() - 3) + ".log";
+        pool.emplace_back(decode);
+    }
 
-        if (!this->extractXzToFile(xzFile, tempTxt))
-            continue;
+    bool result = true;
+    zipFile zf = zipOpen(zipFilePath.c_str(), APPEND_STATUS_CREATE);
+    if (!zf)
+        result = false;
 
-        std::string entryName = tempTxt.substr(tempTxt.find_last_of("/\\") + 1);
-        this->addFileToZip(zf, tempTxt, entryName);
+    for (std::size_t i = 0; i < sources.size() && result; i++)
+    {
+        const SnapshotSource &source = sources[i];
+        zip_fileinfo zi = {};
+        if (zipOpenNewFileInZip(zf, source.entryName.c_str(), &zi, nullptr, 0, nullptr, 0, nullptr, Z_DEFLATED, Z_DEFAULT_COMPRESSION) != ZIP_OK)
+        {
+            result = false;
+            break;
+        }
 
-        ::unlink(tempTxt.c_str());
+        if (!source.archive)
+        {
+            result = writeFileToZip(zf, source.path, source.limit);
+        }
+        else
+        {
+            std::string chunk;
+            while (result && pipes[i]->pop(chunk))
+            {
+                result = zipWriteInFileInZip(zf, chunk.data(), static_cast<unsigned int>(chunk.size())) >= 0;
+            }
+            if (result && !pipes[i]->succeeded())
+            {
+                Debug::error(__FILE__, __LINE__, __func__, "failed to decode %s\n", source.entryName.c_str());
+                result = false;
+            }
+        }
+        zipCloseFileInZip(zf);
     }
 
-    zipClose(zf, nullptr);
-    return true;
+    for (std::unique_ptr<SnapshotPipe> &pipe : pipes)
+    {
+        if (pipe)
+            pipe->cancel();
+    }
+    for (std::thread &worker : pool)
+    {
+        worker.join();
+    }
+    if (zf)
+        zipClose(zf, nullptr);
+    this->removeFiles(links);
+    return result;
 }
 
 bool TXTLog::zipFolder(const std::string &folderPath, const std::string &zipFilePath)
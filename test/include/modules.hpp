@@ -2,13 +2,30 @@
 #define __MODULES_HPP__
 
 #include "binary-tree.hpp"
+#include "byte-ring.hpp"
 #include "debug.hpp"
+#include "debug-sink.hpp"
 #include "queue.hpp"
 #include "string.hpp"
 #include "time.hpp"
+#include "txtlog.hpp"
+#include "txtlog-codec.hpp"
+#include "txtlog-index.hpp"
 
 #include "doctest.h"
 
+#include <algorithm>
 #include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <dirent.h>
+#include <lzma.h>
 
 #endif
\ No newline at end of file
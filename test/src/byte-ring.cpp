@@ -0,0 +1,77 @@
+#include "modules.hpp"
+
+static std::vector<std::string> ringContent(const ByteRing &ring)
+{
+    std::vector<std::string> result;
+    ring.iteration([&](const char *data, size_t length)
+                   {
+                       CHECK(data[length] == '\0');
+                       result.emplace_back(data, length);
+                       return true; });
+    return result;
+}
+
+TEST_CASE("Byte ring record limit")
+{
+    ByteRing ring(1024, 3);
+    for (int i = 0; i < 10; i++)
+    {
+        std::string s = "line " + std::to_string(i);
+        ring.push(s.data(), s.size());
+    }
+    CHECK(ring.size() == 3);
+    std::vector<std::string> content = ringContent(ring);
+    CHECK(content == std::vector<std::string>{"line 7", "line 8", "line 9"});
+    CHECK(ring.bytes() == 18);
+}
+
+TEST_CASE("Byte ring wrap around and byte budget")
+{
+    ByteRing ring(64);
+    for (int i = 0; i < 100; i++)
+    {
+        std::string s = std::string(static_cast<size_t>(i % 7 + 1), static_cast<char>('a' + i % 26));
+        ring.push(s.data(), s.size());
+        std::vector<std::string> content = ringContent(ring);
+        REQUIRE(content.empty() == false);
+        CHECK(content.back() == s);
+        CHECK(content.size() == ring.size());
+    }
+    CHECK(ring.capacity() == 64);
+
+    /* an oversized record keeps its header and its line break */
+    std::string large = "[header] " + std::string(200, 'x') + "\n";
+    ring.push(large.data(), large.size());
+    std::vector<std::string> content = ringContent(ring);
+    CHECK(content.size() == 1);
+    CHECK(content.front().compare(0, 9, "[header] ") == 0);
+    CHECK(content.front().back() == '\n');
+    CHECK(content.front().size() < 64);
+
+    std::string unterminated(200, 'z');
+    unterminated.front() = 'a';
+    ring.push(unterminated.data(), unterminated.size());
+    content = ringContent(ring);
+    CHECK(content.size() == 1);
+    CHECK(content.front().front() == 'a');
+    CHECK(content.front().back() == 'z');
+
+    ring.clear();
+    CHECK(ring.isEmpty() == true);
+    CHECK(ringContent(ring).empty() == true);
+}
+
+TEST_CASE("Byte ring resize keeps newest records")
+{
+    ByteRing ring(1024);
+    for (int i = 0; i < 20; i++)
+    {
+        std::string s = "record " + std::to_string(i);
+        ring.push(s.data(), s.size());
+    }
+    ring.setCapacity(64);
+    std::vector<std::string> content = ringContent(ring);
+    REQUIRE(content.empty() == false);
+    CHECK(content.back() == "record 19");
+    CHECK(content.size() < 20);
+}
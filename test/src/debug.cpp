@@ -180,4 +180,378 @@ TEST_CASE("Static method generator for large message")
     const char *ldata = "OOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOO";
     std::string gen = Debug::generate(Debug::INFO, __FILE__, __LINE__, "generator", "gcheck %s %d\n", ldata, 128);
     CHECK(memcmp(gen.c_str() + 20, "[I]: debug.cpp:181 → generator: gcheck OOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOOO 128\n", 1444) == 0);
-}
\ No newline at end of file
+}
+TEST_CASE("Asynchronous writer")
+{
+    DebugWithSomeLinesHistoryTestHelper debug;
+
+    SUBCASE("Single producer")
+    {
+        CHECK(Debug::startAsync(16) == true);
+        CHECK(Debug::startAsync(16) == false);
+        CHECK(Debug::isAsync() == true);
+        for (int i = 0; i < 100; i++)
+        {
+            debug.log(Debug::INFO, "acheck", "%d\n", i);
+        }
+        Debug::flush();
+        CHECK(debug.getHistoriesNumber() == 3);
+        CHECK(memcmp(debug.getLogHistory().c_str() + 20, "[I]: acheck: 97\n", 16) == 0);
+        Debug::stopAsync();
+        CHECK(Debug::isAsync() == false);
+    }
+
+    SUBCASE("Multiple producers")
+    {
+        Debug::setMaxLinesLogCache(1000);
+        Debug::startAsync(64);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < 4; t++)
+        {
+            producers.emplace_back([t]()
+                                   {
+                                        for (int i = 0; i < 200; i++)
+                                        {
+                                            Debug::info(__FILE__, __LINE__, "mcheck", "%d %d\n", t, i);
+                                        } });
+        }
+        for (std::thread &producer : producers)
+        {
+            producer.join();
+        }
+        Debug::stopAsync();
+        CHECK(debug.getHistoriesNumber() == 800);
+        Debug::setMaxLinesLogCache(3);
+    }
+}
+
+TEST_CASE("Deferred formatting")
+{
+    DebugWithSomeLinesHistoryTestHelper debug;
+
+    SUBCASE("Synchronous fallback")
+    {
+        Debug::logDeferred(Debug::WARNING, nullptr, 0, "dcheck", "%d %s %.02f %c\n", 7, "seven", 7.0, 'x');
+        CHECK(memcmp(debug.getLogHistory().c_str() + 20, "[W]: dcheck: 7 seven 7.00 x\n", 28) == 0);
+    }
+
+    SUBCASE("Rendered by the writer thread")
+    {
+        Debug::startAsync(16);
+        for (int i = 0; i < 50; i++)
+        {
+            std::string owner = "str" + std::to_string(i);
+            Debug::logDeferred(Debug::ERROR, nullptr, 0, "dcheck", "%s %llu %p\n", owner.c_str(), static_cast<unsigned long long>(i), nullptr);
+        }
+        Debug::logDeferred(Debug::INFO, nullptr, 0, "dcheck", "no args\n");
+        Debug::stopAsync();
+        std::string history = debug.getLogHistory();
+        CHECK(debug.getHistoriesNumber() == 3);
+        CHECK(history.find("[E]: dcheck: str48 48 ") != std::string::npos);
+        CHECK(history.find("[E]: dcheck: str49 49 ") != std::string::npos);
+        CHECK(history.find("[I]: dcheck: no args\n") != std::string::npos);
+    }
+}
+
+class DebugTimestampTestHelper : public Debug
+{
+public:
+    using Debug::formatTimestamp;
+};
+
+TEST_CASE("Cached timestamp prefix")
+{
+    std::chrono::system_clock::time_point base = std::chrono::system_clock::from_time_t(1759045512);
+    const int offsets[] = {0, 7, 999, 1000, 1001, 60123, 3600000, 7};
+    for (int offset : offsets)
+    {
+        std::chrono::system_clock::time_point tp = base + std::chrono::milliseconds(offset);
+        std::time_t sec = std::chrono::system_clock::to_time_t(tp);
+        std::tm localTime{};
+        localtime_r(&sec, &localTime);
+        char expected[32];
+        std::snprintf(expected, sizeof(expected), "[%02d%02d%02d_%02d%02d%02d.%03d]",
+                      localTime.tm_year % 100, localTime.tm_mon + 1, localTime.tm_mday,
+                      localTime.tm_hour, localTime.tm_min, localTime.tm_sec, offset % 1000);
+        char buffer[20]{};
+        DebugTimestampTestHelper::formatTimestamp(buffer, tp);
+        CHECK(std::string(buffer, 19) == expected);
+    }
+}
+
+TEST_CASE("Log level filtering")
+{
+    DebugWithSomeLinesHistoryTestHelper debug;
+
+    SUBCASE("Global level")
+    {
+        Debug::setLogLevel(Debug::WARNING);
+        CHECK(Debug::getLogLevel() == Debug::WARNING);
+        CHECK(Debug::isEnabled(Debug::INFO) == false);
+        CHECK(Debug::isEnabled(Debug::ERROR) == true);
+        Debug::info(__FILE__, __LINE__, __func__, "dropped\n");
+        DEBUG_INFO("dropped %d\n", 1);
+        debug.info("lcheck", "dropped\n");
+        CHECK(debug.getHistoriesNumber() == 0);
+        DEBUG_WARNING("kept %d\n", 2);
+        CHECK(debug.getHistoriesNumber() == 1);
+        CHECK(debug.getLogHistory().find("[W]: debug.cpp:") != std::string::npos);
+        Debug::setLogLevel(Debug::INFO);
+    }
+
+    SUBCASE("Per logger level")
+    {
+        Debug other;
+        debug.setLevel(Debug::ERROR);
+        CHECK(debug.getLevel() == Debug::ERROR);
+        CHECK(debug.isLoggable(Debug::WARNING) == false);
+        CHECK(other.isLoggable(Debug::WARNING) == true);
+        DEBUG_LOGGER_WARNING(debug, "dropped\n");
+        debug.warning("lcheck", "dropped\n");
+        CHECK(debug.getHistoriesNumber() == 0);
+        DEBUG_LOGGER_CRITICAL(debug, "kept\n");
+        CHECK(debug.getHistoriesNumber() == 1);
+        CHECK(debug.getLogHistory().find("[C]: debug.cpp:") != std::string::npos);
+    }
+}
+
+TEST_CASE("History byte budget")
+{
+    DebugWithSomeLinesHistoryTestHelper debug;
+
+    Debug::setMaxLinesLogCache(100);
+    Debug::setLogCacheSize(256);
+    for (int i = 0; i < 20; i++)
+    {
+        debug.log(Debug::INFO, "bcheck", "%d\n", i);
+    }
+    size_t lines = debug.getHistoriesNumber();
+    CHECK(lines > 0);
+    CHECK(lines < 20);
+    std::string history = debug.getLogHistory();
+    CHECK(history.size() <= 256);
+    CHECK(history.compare(history.size() - 16, 16, "[I]: bcheck: 19\n") == 0);
+    Debug::setLogCacheSize(0);
+    Debug::setMaxLinesLogCache(3);
+}
+
+TEST_CASE("Confidential masking covers every occurrence")
+{
+    DebugWithSomeLinesHistoryTestHelper debug;
+
+    debug.setConfidential("token");
+    debug.setConfidential("ken");
+    debug.setConfidential("secret");
+    debug.setConfidential("secretive");
+    debug.log(Debug::INFO, "hcheck", "token=token;ken secretive secret tokentoken\n");
+    std::string history = debug.getLogHistory();
+    CHECK(history.compare(20, 54, "[I]: hcheck: *****=*****;***** ***** ***** **********\n") == 0);
+
+    Debug copy(debug);
+    CHECK(copy.getLevel() == debug.getLevel());
+}
+
+TEST_CASE("Streaming into TXTLog")
+{
+    DebugWithSomeLinesHistoryTestHelper debug;
+
+    ::mkdir("./log", 0755);
+    ::unlink("./log/stream.log");
+    debug.log(Debug::INFO, "pcheck", "cached\n");
+    Debug::setupTXTLogFile("./log", "stream", 1024 * 1024);
+    Debug::setTXTLogStreaming(true, 256, 60000);
+    CHECK(Debug::isTXTLogStreaming() == true);
+    for (int i = 0; i < 50; i++)
+    {
+        debug.log(Debug::INFO, "scheck", "%d\n", i);
+    }
+    std::thread worker([&]()
+                       { debug.log(Debug::INFO, "scheck", "worker\n"); });
+    worker.join();
+    Debug::flush();
+
+    std::string content = StringUtils::fromFile("./log/stream.log");
+    size_t lines = 0;
+    for (size_t pos = content.find("scheck"); pos != std::string::npos; pos = content.find("scheck", pos + 1))
+    {
+        lines++;
+    }
+    CHECK(lines == 51);
+    CHECK(content.find("[I]: scheck: 49\n") != std::string::npos);
+    CHECK(content.find("[I]: scheck: worker\n") != std::string::npos);
+
+    /* streamed lines stay out of the history, the line cached before streaming is still written */
+    CHECK(debug.getLogHistory().find("pcheck: cached") != std::string::npos);
+    CHECK(debug.getLogHistory().find("scheck") == std::string::npos);
+    Debug::moveLogHistoryToFile();
+    content = StringUtils::fromFile("./log/stream.log");
+    CHECK(content.find("[I]: pcheck: cached\n") != std::string::npos);
+    CHECK(content.find("[I]: scheck: 49\n") == content.rfind("[I]: scheck: 49\n"));
+
+    /* the file can be replaced while other threads flush batches into it */
+    std::atomic<bool> running(true);
+    std::vector<std::thread> loggers;
+    for (int t = 0; t < 4; t++)
+    {
+        loggers.emplace_back([&]()
+                             {
+                                 while (running)
+                                     debug.log(Debug::INFO, "scheck", "swap\n"); });
+    }
+    for (int i = 0; i < 20; i++)
+    {
+        ::unlink("./log/stream.log");
+        Debug::setupTXTLogFile("./log", "stream", 1024 * 1024);
+    }
+    running = false;
+    for (std::thread &logger : loggers)
+    {
+        logger.join();
+    }
+    debug.log(Debug::INFO, "scheck", "after swap\n");
+    Debug::flush();
+    CHECK(StringUtils::fromFile("./log/stream.log").find("[I]: scheck: after swap\n") != std::string::npos);
+
+    /* a thread that goes quiet still gets its batch written once it ages out */
+    Debug::setTXTLogStreaming(true, 65536, 20);
+    debug.log(Debug::INFO, "scheck", "idle\n");
+    bool written = false;
+    for (int i = 0; i < 200 && !written; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        written = StringUtils::fromFile("./log/stream.log").find("[I]: scheck: idle\n") != std::string::npos;
+    }
+    CHECK(written == true);
+
+    Debug::setTXTLogStreaming(false);
+    CHECK(Debug::isTXTLogStreaming() == false);
+}
+
+TEST_CASE("Pluggable sinks")
+{
+    DebugWithSomeLinesHistoryTestHelper debug;
+
+    std::shared_ptr<MemorySink> all = std::make_shared<MemorySink>(4096);
+    std::shared_ptr<MemorySink> errors = std::make_shared<MemorySink>(4096);
+    errors->setLevel(Debug::ERROR);
+
+    Debug::clearSinks();
+    CHECK(Debug::getSinksNumber() == 0);
+    Debug::addSink(all);
+    Debug::addSink(errors);
+    Debug::addSink(std::make_shared<NullSink>());
+    CHECK(Debug::getSinksNumber() == 3);
+
+    debug.log(Debug::INFO, "kcheck", "info\n");
+    debug.log(Debug::ERROR, "kcheck", "error\n");
+    CHECK(all->size() == 2);
+    CHECK(errors->size() == 1);
+    CHECK(errors->getContent().compare(20, 19, "[E]: kcheck: error\n") == 0);
+    CHECK(debug.getHistoriesNumber() == 2);
+
+    Debug::removeSink(errors);
+    debug.log(Debug::CRITICAL, "kcheck", "critical\n");
+    CHECK(errors->size() == 1);
+    CHECK(all->size() == 3);
+
+    Debug::resetSinks();
+    CHECK(Debug::getSinksNumber() == 1);
+}
+
+TEST_CASE("Unix datagram sink")
+{
+    const char *path = "./log/sink.sock";
+    ::mkdir("./log", 0755);
+    ::unlink(path);
+    int receiver = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    REQUIRE(receiver >= 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path);
+    REQUIRE(::bind(receiver, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+
+    UnixDatagramSink sink(path);
+    CHECK(sink.isOpen() == true);
+    sink.write(Debug::INFO, "datagram\n");
+    char buffer[64]{};
+    CHECK(::recv(receiver, buffer, sizeof(buffer), 0) == 9);
+    CHECK(std::string(buffer) == "datagram\n");
+    CHECK(sink.getDropped() == 0);
+
+    ::close(receiver);
+    ::unlink(path);
+    sink.write(Debug::INFO, "lost\n");
+    CHECK(sink.getDropped() == 1);
+}
+
+TEST_CASE("File sink")
+{
+    ::mkdir("./log", 0755);
+    ::unlink("./log/filesink.log");
+    std::shared_ptr<FileSink> file = std::make_shared<FileSink>("./log", "filesink", 1024 * 1024, 3, 10, 4096, 60000);
+    file->setLevel(Debug::WARNING);
+    Debug::addSink(file);
+    Debug::info(__FILE__, __LINE__, "fcheck", "skipped\n");
+    Debug::warning(__FILE__, __LINE__, "fcheck", "kept\n");
+    Debug::flush();
+    Debug::removeSink(file);
+
+    std::string content = StringUtils::fromFile("./log/filesink.log");
+    CHECK(content.find("fcheck: skipped") == std::string::npos);
+    CHECK(content.find("fcheck: kept\n") != std::string::npos);
+
+    /* a quiet process still gets its records into the file, without flush() */
+    ::unlink("./log/fileidle.log");
+    std::shared_ptr<FileSink> idle = std::make_shared<FileSink>("./log", "fileidle", 1024 * 1024, 3, 10, 4096, 20);
+    Debug::addSink(idle);
+    Debug::warning(__FILE__, __LINE__, "fcheck", "idle\n");
+    Debug::removeSink(idle);
+    for (int i = 0; i < 200 && StringUtils::fromFile("./log/fileidle.log").empty(); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK(StringUtils::fromFile("./log/fileidle.log").find("fcheck: idle\n") != std::string::npos);
+}
+
+TEST_CASE("Per call-site rate limiting")
+{
+    DebugWithSomeLinesHistoryTestHelper debug;
+    Debug::setMaxLinesLogCache(200);
+    Debug::setRateLimit(5, 50);
+
+    for (int i = 0; i < 100; i++)
+    {
+        Debug::warning(__FILE__, 900, "rcheck", "storm %d\n", i);
+    }
+    Debug::error(__FILE__, 901, "rcheck", "other site\n");
+    CHECK(debug.getHistoriesNumber() == 6);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    Debug::warning(__FILE__, 900, "rcheck", "calm\n");
+    std::string history = debug.getLogHistory();
+    CHECK(history.find("rcheck: last message repeated 95 times\n") != std::string::npos);
+    CHECK(history.find("rcheck: calm\n") != std::string::npos);
+    CHECK(debug.getHistoriesNumber() == 8);
+
+    /* a storm that stops is reported by a later record elsewhere, or by flush() */
+    for (int i = 0; i < 20; i++)
+    {
+        Debug::warning(__FILE__, 902, "rcheck", "burst %d\n", i);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    Debug::warning(__FILE__, 903, "rcheck", "elsewhere\n");
+    CHECK(debug.getLogHistory().find("rcheck: last message repeated 15 times\n") != std::string::npos);
+    for (int i = 0; i < 12; i++)
+    {
+        Debug::warning(__FILE__, 904, "rcheck", "burst %d\n", i);
+    }
+    Debug::flush();
+    CHECK(debug.getLogHistory().find("rcheck: last message repeated 7 times\n") != std::string::npos);
+    CHECK(debug.getHistoriesNumber() == 21);
+
+    Debug::setRateLimit(0);
+    for (int i = 0; i < 10; i++)
+    {
+        Debug::warning(__FILE__, 900, "rcheck", "free\n");
+    }
+    CHECK(debug.getHistoriesNumber() == 31);
+    debug.clearLogHistory();
+}
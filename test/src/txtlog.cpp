@@ -0,0 +1,1085 @@
+#include "modules.hpp"
+
+static void resetDirectory(const std::string &path)
+{
+    ::mkdir(path.c_str(), 0755);
+    DIR *dir = ::opendir(path.c_str());
+    if (!dir)
+        return;
+    struct dirent *entry;
+    while ((entry = ::readdir(dir)) != nullptr)
+    {
+        std::string name(entry->d_name);
+        if (name != "." && name != "..")
+            ::unlink((path + "/" + name).c_str());
+    }
+    ::closedir(dir);
+}
+
+static std::vector<std::string> listDirectory(const std::string &path)
+{
+    std::vector<std::string> result;
+    DIR *dir = ::opendir(path.c_str());
+    if (!dir)
+        return result;
+    struct dirent *entry;
+    while ((entry = ::readdir(dir)) != nullptr)
+    {
+        std::string name(entry->d_name);
+        if (name != "." && name != "..")
+            result.push_back(name);
+    }
+    ::closedir(dir);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+static std::size_t fileSize(const std::string &path)
+{
+    struct stat st;
+    return (::stat(path.c_str(), &st) == 0) ? static_cast<std::size_t>(st.st_size) : 0;
+}
+
+/* for data written by a background thread, gives up after about two seconds */
+static std::size_t waitForSize(const std::string &path, std::size_t size)
+{
+    for (int i = 0; i < 200 && fileSize(path) < size; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return fileSize(path);
+}
+
+TEST_CASE("TXTLog buffered write")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtbuf");
+    TXTLog log("./log/txtbuf", "buffered", 1024 * 1024, 3, 3, 64, 60000);
+    CHECK(log.getBufferSize() == 64);
+
+    SUBCASE("Flush on size")
+    {
+        log.write("0123456789\n");
+        CHECK(fileSize("./log/txtbuf/buffered.log") == 0);
+        for (int i = 0; i < 5; i++)
+        {
+            log.write("0123456789\n");
+        }
+        CHECK(fileSize("./log/txtbuf/buffered.log") == 66);
+    }
+
+    SUBCASE("Explicit flush")
+    {
+        log.write("pending\n");
+        CHECK(fileSize("./log/txtbuf/buffered.log") == 0);
+        CHECK(log.flushBuffer() == true);
+        CHECK(StringUtils::fromFile("./log/txtbuf/buffered.log") == "pending\n");
+    }
+
+    SUBCASE("Flush on age")
+    {
+        /* long enough that the worker's timer does not beat the first check */
+        log.setBufferSize(1024, 300);
+        log.write("aged\n");
+        CHECK(log.flushExpired() == true);
+        CHECK(fileSize("./log/txtbuf/buffered.log") == 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(310));
+        CHECK(log.flushExpired() == true);
+        CHECK(fileSize("./log/txtbuf/buffered.log") == 5);
+    }
+
+    SUBCASE("Flush on a timer")
+    {
+        /* no later write and no flushExpired() call: the worker drains the buffer */
+        log.setBufferSize(1024, 20);
+        log.write("idle\n");
+        CHECK(waitForSize("./log/txtbuf/buffered.log", 5) == 5);
+        log.write("again\n");
+        CHECK(waitForSize("./log/txtbuf/buffered.log", 11) == 11);
+    }
+
+    SUBCASE("Close drains the buffer")
+    {
+        log.write("closing\n");
+        log.close();
+        CHECK(StringUtils::fromFile("./log/txtbuf/buffered.log") == "closing\n");
+    }
+}
+
+TEST_CASE("TXTLog tracks size without stat")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtsize");
+    {
+        /* existing content is picked up from fstat at open */
+        std::ofstream seed("./log/txtsize/size.log");
+        seed << std::string(90, 'x');
+    }
+    TXTLog log("./log/txtsize", "size", 100, 3, 3);
+    log.write(std::string(10, 'y'));
+    CHECK(fileSize("./log/txtsize/size.log") == 100);
+    CHECK(listDirectory("./log/txtsize").size() == 1);
+
+    log.write("z");
+    std::vector<std::string> files = listDirectory("./log/txtsize");
+    CHECK(files.size() == 2);
+    CHECK(fileSize("./log/txtsize/size.log") == 1);
+}
+
+TEST_CASE("TXTLog archives in the background")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtbg");
+    TXTLog log("./log/txtbg", "bg", 64, 0, 3);
+    CHECK(log.isBackgroundMaintenance() == true);
+
+    log.write(std::string(64, 'a') + "\n");
+    log.write("fresh\n");
+    CHECK(StringUtils::fromFile("./log/txtbg/bg.log") == "fresh\n");
+
+    log.waitForMaintenance();
+    std::vector<std::string> files = listDirectory("./log/txtbg");
+    REQUIRE(files.size() == 2);
+    CHECK(files[0].find("archive_bg_") == 0);
+    CHECK(files[0].find(".xz") != std::string::npos);
+    CHECK(files[1] == "bg.log");
+
+    SUBCASE("Inline maintenance")
+    {
+        log.setBackgroundMaintenance(false);
+        CHECK(log.isBackgroundMaintenance() == false);
+        log.write(std::string(64, 'b') + "\n");
+        log.write("again\n");
+        CHECK(listDirectory("./log/txtbg").size() >= 2);
+        CHECK(StringUtils::fromFile("./log/txtbg/bg.log") == "again\n");
+    }
+}
+
+static std::string decodeXz(const std::string &path)
+{
+    std::string input = StringUtils::fromFile(path);
+    std::string output;
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if (lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+        return output;
+    stream.next_in = reinterpret_cast<const uint8_t *>(input.data());
+    stream.avail_in = input.size();
+    std::vector<uint8_t> buffer(65536);
+    lzma_ret ret = LZMA_OK;
+    while (ret == LZMA_OK)
+    {
+        stream.next_out = buffer.data();
+        stream.avail_out = buffer.size();
+        ret = lzma_code(&stream, LZMA_FINISH);
+        output.append(reinterpret_cast<char *>(buffer.data()), buffer.size() - stream.avail_out);
+    }
+    lzma_end(&stream);
+    return (ret == LZMA_STREAM_END) ? output : std::string();
+}
+
+TEST_CASE("TXTLog multi-threaded archive")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtmt");
+    TXTLog log("./log/txtmt", "mt", 512 * 1024, 0, 3);
+    log.setCodec(std::make_shared<XzCodec>(6, XzCodec::CHECK_CRC64, 128 * 1024));
+    log.setArchiveThreads(2);
+    CHECK(log.getArchiveThreads() == 2);
+
+    std::string expected;
+    for (int i = 0; expected.size() < 512 * 1024; i++)
+    {
+        std::string line = "record " + std::to_string(i) + " " + std::to_string(i * 7919) + "\n";
+        expected += line;
+    }
+    log.write(expected);
+    log.write("next\n");
+    log.waitForMaintenance();
+
+    std::vector<std::string> files = listDirectory("./log/txtmt");
+    REQUIRE(files.size() == 2);
+    CHECK(files[0].find("archive_mt_") == 0);
+    CHECK(decodeXz("./log/txtmt/" + files[0]) == expected);
+}
+
+TEST_CASE("TXTLog archive codecs")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtcodec");
+    std::string content;
+    for (int i = 0; content.size() < 4096; i++)
+    {
+        content += "codec line " + std::to_string(i) + "\n";
+    }
+
+    SUBCASE("Fast xz preset without check")
+    {
+        std::shared_ptr<XzCodec> codec = std::make_shared<XzCodec>(0, XzCodec::CHECK_NONE);
+        CHECK(codec->getPreset() == 0);
+        CHECK(std::string(codec->extension()) == ".xz");
+        TXTLog log("./log/txtcodec", "xz", 4096, 0, 3);
+        log.setCodec(codec);
+        log.write(content);
+        log.write("x\n");
+        log.waitForMaintenance();
+        std::vector<std::string> files = listDirectory("./log/txtcodec");
+        REQUIRE(files.size() == 2);
+        CHECK(files[0].find("archive_xz_") == 0);
+        CHECK(decodeXz("./log/txtcodec/" + files[0]) == content);
+    }
+
+#ifndef __DISABLE_ZLIB
+    SUBCASE("Gzip")
+    {
+        std::shared_ptr<GzipCodec> codec = std::make_shared<GzipCodec>(1);
+        TXTLog log("./log/txtcodec", "gz", 4096, 0, 3);
+        log.setCodec(codec);
+        log.write(content);
+        log.write("x\n");
+        log.waitForMaintenance();
+        std::vector<std::string> files = listDirectory("./log/txtcodec");
+        REQUIRE(files.size() == 2);
+        CHECK(files[0].find("archive_gz_") == 0);
+        CHECK(files[0].find(".gz") == files[0].size() - 3);
+
+        std::shared_ptr<TXTLogCodec> reader = TXTLogCodec::forArchive(files[0]);
+        REQUIRE(reader != nullptr);
+        CHECK(std::string(reader->name()) == "gzip");
+        CHECK(reader->decompress("./log/txtcodec/" + files[0], "./log/txtcodec/restored.txt") == true);
+        CHECK(StringUtils::fromFile("./log/txtcodec/restored.txt") == content);
+    }
+#endif
+
+    SUBCASE("Automatic preset")
+    {
+        XzCodec codec(TXTLogCodec::PRESET_AUTO);
+        CHECK(codec.getPreset() == TXTLogCodec::PRESET_AUTO);
+        CHECK(codec.getEffectivePreset() == 3);
+        codec.tune(100.0, 150.0);
+        CHECK(codec.getEffectivePreset() == 2);
+        codec.tune(100.0, 500.0);
+        CHECK(codec.getEffectivePreset() == 2);
+        codec.tune(100.0, 1000.0);
+        CHECK(codec.getEffectivePreset() == 3);
+
+        XzCodec fixed(9);
+        fixed.tune(100.0, 1.0);
+        CHECK(fixed.getEffectivePreset() == 9);
+        fixed.setPreset(42);
+        CHECK(fixed.getPreset() == 9);
+    }
+}
+
+TEST_CASE("TXTLog compress-as-you-write")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtlive");
+    TXTLog log("./log/txtlive", "live", 1024 * 1024, 0, 3);
+    log.setCodec(std::make_shared<XzCodec>(1));
+    log.setCompressedStreaming(true);
+    CHECK(log.isCompressedStreaming() == true);
+    CHECK(log.getBufferSize() == 256 * 1024);
+
+    log.write("first block\n");
+    CHECK(log.flushBuffer() == true);
+    log.write("second block\n");
+    log.flush();
+    CHECK(decodeXz("./log/txtlive/live.log.xz") == "first block\nsecond block\n");
+
+    SUBCASE("Rotation renames the compressed file into an archive")
+    {
+        log.setMaxFileSize(16);
+        log.write("third block\n");
+        log.flushBuffer();
+        log.waitForMaintenance();
+        std::vector<std::string> files = listDirectory("./log/txtlive");
+        REQUIRE(files.size() == 2);
+        CHECK(files[0].find("archive_live_") == 0);
+        CHECK(decodeXz("./log/txtlive/" + files[0]) == "first block\nsecond block\n");
+        CHECK(decodeXz("./log/txtlive/live.log.xz") == "third block\n");
+    }
+
+#ifndef __DISABLE_ZLIB
+    SUBCASE("Switching codec starts a new active file")
+    {
+        log.setCodec(std::make_shared<GzipCodec>(1));
+        log.write("gzip block\n");
+        log.flushBuffer();
+        log.write("gzip again\n");
+        log.close();
+        GzipCodec reader;
+        CHECK(reader.decompress("./log/txtlive/live.log.gz", "./log/txtlive/restored.txt") == true);
+        CHECK(StringUtils::fromFile("./log/txtlive/restored.txt") == "gzip block\ngzip again\n");
+    }
+#endif
+
+    SUBCASE("Back to plain text")
+    {
+        log.setCompressedStreaming(false);
+        log.write("plain\n");
+        log.flushBuffer();
+        CHECK(StringUtils::fromFile("./log/txtlive/live.log") == "plain\n");
+    }
+}
+
+static std::string stampedLine(std::time_t seconds, int ms, const std::string &text)
+{
+    std::tm tmTime;
+    localtime_r(&seconds, &tmTime);
+    char header[32];
+    std::snprintf(header, sizeof(header), "[%02d%02d%02d_%02d%02d%02d.%03d]",
+                  tmTime.tm_year % 100, tmTime.tm_mon + 1, tmTime.tm_mday,
+                  tmTime.tm_hour, tmTime.tm_min, tmTime.tm_sec, ms);
+    return std::string(header) + " [I]: " + text + "\n";
+}
+
+TEST_CASE("TXTLog seekable time-indexed archives")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtidx");
+    const std::time_t base = 1700000000;
+    TXTLog log("./log/txtidx", "seek", 1024 * 1024, 0, 5);
+    log.setCodec(std::make_shared<XzCodec>(0));
+    log.setIndexedArchives(true, 4096);
+    CHECK(log.isIndexedArchives() == true);
+
+    std::string content;
+    std::string expected;
+    for (int i = 0; i < 2000; i++)
+    {
+        std::string line = stampedLine(base + i * 10, i % 1000, "line " + std::to_string(i));
+        if (i == 505)
+            line += "  continuation of 505\n";
+        content += line;
+        if (i >= 500 && i <= 510)
+            expected += line;
+        log.write(line);
+    }
+
+    /* the next write rotates, the backup is archived right away */
+    log.setMaxFileSize(1);
+    log.write(stampedLine(base + 50000, 0, "after rotation"));
+    log.waitForMaintenance();
+
+    std::vector<std::string> files = listDirectory("./log/txtidx");
+    REQUIRE(files.size() == 3);
+    CHECK(files[0].find("archive_seek_") == 0);
+    CHECK(files[1] == files[0] + ".idx");
+    CHECK(decodeXz("./log/txtidx/" + files[0]) == content);
+
+    std::vector<TXTLogIndex::Entry> entries;
+    CHECK(TXTLogIndex::load("./log/txtidx/" + files[1], entries) == true);
+    CHECK(entries.size() > 10);
+    CHECK(entries.front().firstMs == static_cast<std::int64_t>(base) * 1000);
+    CHECK(entries.back().lastMs == static_cast<std::int64_t>(base + 19990) * 1000 + 999);
+
+    SUBCASE("Only the requested window is extracted")
+    {
+        CHECK(log.extractTimeRange(base + 5000, base + 5100, "./log/txtidx/range.txt") == true);
+        CHECK(StringUtils::fromFile("./log/txtidx/range.txt") == expected);
+    }
+
+    SUBCASE("Archives without index are decoded completely")
+    {
+        ::unlink(("./log/txtidx/" + files[1]).c_str());
+        CHECK(log.extractTimeRange(base + 5000, base + 5100, "./log/txtidx/range.txt") == true);
+        CHECK(StringUtils::fromFile("./log/txtidx/range.txt") == expected);
+    }
+
+    SUBCASE("Windows reach into the active file")
+    {
+        CHECK(log.extractTimeRange(base + 19990, base + 50000, "./log/txtidx/range.txt") == true);
+        CHECK(StringUtils::fromFile("./log/txtidx/range.txt") ==
+              stampedLine(base + 19990, 999, "line 1999") + stampedLine(base + 50000, 0, "after rotation"));
+    }
+
+    SUBCASE("Writers keep going while a range is extracted")
+    {
+        log.setMaxFileSize(1024 * 1024);
+        std::atomic<bool> stop(false);
+        std::thread writer([&]()
+                           {
+                               for (int i = 0; i < 20000 && !stop.load(); i++)
+                                   log.write(stampedLine(base + 70000, 0, "busy " + std::to_string(i))); });
+        for (int round = 0; round < 5; round++)
+        {
+            CHECK(log.extractTimeRange(base + 5000, base + 5100, "./log/txtidx/range.txt") == true);
+            CHECK(StringUtils::fromFile("./log/txtidx/range.txt") == expected);
+        }
+        stop.store(true);
+        writer.join();
+        log.waitForMaintenance();
+
+        /* the pinning links are gone */
+        for (const std::string &name : listDirectory("./log/txtidx"))
+            CHECK(name.find(".snapshot-") == std::string::npos);
+    }
+
+    SUBCASE("Compress-as-you-write indexes every flushed block")
+    {
+        log.setMaxFileSize(1024 * 1024);
+        log.setCompressedStreaming(true);
+        for (int i = 0; i < 30; i++)
+        {
+            log.write(stampedLine(base + 60000 + i, 0, "live " + std::to_string(i)));
+            if (i % 10 == 9)
+                log.flushBuffer();
+        }
+        entries.clear();
+        CHECK(TXTLogIndex::load("./log/txtidx/seek.log.xz.idx", entries) == true);
+        CHECK(entries.size() == 3);
+        CHECK(log.extractTimeRange(base + 60012, base + 60013, "./log/txtidx/range.txt") == true);
+        CHECK(StringUtils::fromFile("./log/txtidx/range.txt") ==
+              stampedLine(base + 60012, 0, "live 12") + stampedLine(base + 60013, 0, "live 13"));
+
+        /* a read-only query finds the compressed active file */
+        TXTLog::Query query;
+        query.from = base + 60012;
+        query.to = base + 60013;
+        std::vector<TXTLog::Record> records;
+        CHECK(TXTLog::queryDirectory("./log/txtidx", "seek", query, records) == true);
+        REQUIRE(records.size() == 2);
+        CHECK(records[1].text == stampedLine(base + 60013, 0, "live 13"));
+    }
+}
+
+TEST_CASE("TXTLog query")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtquery");
+    const std::time_t base = 1700000000;
+    TXTLog log("./log/txtquery", "query", 1024 * 1024, 1, 5);
+    log.setCodec(std::make_shared<XzCodec>(0));
+    log.setIndexedArchives(true, 4096);
+
+    /* one archive (indexed), one txt backup and the active file */
+    const char *levels = "IWEC";
+    for (int i = 0; i < 300; i++)
+    {
+        std::string line = stampedLine(base + i, 0, "event " + std::to_string(i));
+        line[21] = levels[i % 4];
+        if (i % 50 == 7)
+            line += "    at frame " + std::to_string(i) + "\n";
+        log.write(line);
+        if (i == 99 || i == 199)
+        {
+            log.setMaxFileSize(1);
+            log.write(stampedLine(base + i, 500, "rotation " + std::to_string(i)));
+            log.waitForMaintenance();
+            log.setMaxFileSize(1024 * 1024);
+        }
+    }
+    std::vector<std::string> files = listDirectory("./log/txtquery");
+    REQUIRE(files.size() == 4);
+    CHECK(files[0].find("archive_query_") == 0);
+    CHECK(files[1] == files[0] + ".idx");
+
+    std::vector<TXTLog::Record> records;
+    TXTLog::Query query;
+
+    SUBCASE("Everything in time order")
+    {
+        CHECK(log.query(query, records) == true);
+        REQUIRE(records.size() == 302);
+        for (std::size_t i = 1; i < records.size(); i++)
+        {
+            CHECK(records[i - 1].timeMs <= records[i].timeMs);
+        }
+        CHECK(records[7].text.find("at frame 7\n") != std::string::npos);
+    }
+
+    SUBCASE("Time range across files")
+    {
+        query.from = base + 95;
+        query.to = base + 205;
+        CHECK(log.query(query, records) == true);
+        REQUIRE(records.size() == 113);
+        CHECK(records.front().timeMs == static_cast<std::int64_t>(base + 95) * 1000);
+        CHECK(records.back().timeMs == static_cast<std::int64_t>(base + 205) * 1000);
+    }
+
+    SUBCASE("Level, substring and regex filters")
+    {
+        query.minLevel = Debug::CRITICAL;
+        CHECK(log.query(query, records) == true);
+        CHECK(records.size() == 75);
+
+        records.clear();
+        query.minLevel = Debug::INFO;
+        query.contains = {"event 57\n", "frame 257"};
+        CHECK(log.query(query, records) == true);
+        REQUIRE(records.size() == 2);
+        CHECK(records[0].level == Debug::WARNING);
+        CHECK(records[1].text.find("event 257") != std::string::npos);
+
+        records.clear();
+        query.contains.clear();
+        query.pattern = "event 1[0-9]5$";
+        CHECK(log.query(query, records) == true);
+        CHECK(records.size() == 10);
+
+        query.pattern = "event (";
+        CHECK(log.query(query, records) == false);
+    }
+
+    SUBCASE("Read-only directory query")
+    {
+        CHECK(TXTLog::queryDirectory("./log/txtquery", "query", query, records) == true);
+        CHECK(records.size() == 302);
+        CHECK(listDirectory("./log/txtquery").size() == files.size());
+
+        /* nothing is created where no log exists */
+        records.clear();
+        resetDirectory("./log/txtqueryro");
+        CHECK(TXTLog::queryDirectory("./log/txtqueryro", "query", query, records) == true);
+        CHECK(records.empty());
+        CHECK(listDirectory("./log/txtqueryro").empty());
+    }
+
+    SUBCASE("Writers keep going during a query")
+    {
+        std::atomic<bool> stop(false);
+        std::thread writer([&]()
+                           {
+                               for (int i = 0; i < 20000 && !stop.load(); i++)
+                                   log.write(stampedLine(base + 1000, 0, "busy " + std::to_string(i))); });
+        query.to = base + 299;
+        for (int round = 0; round < 5; round++)
+        {
+            records.clear();
+            CHECK(log.query(query, records) == true);
+            CHECK(records.size() == 302);
+        }
+        stop.store(true);
+        writer.join();
+        log.waitForMaintenance();
+
+        /* the pinning links are gone */
+        for (const std::string &name : listDirectory("./log/txtquery"))
+            CHECK(name.find(".snapshot-") == std::string::npos);
+    }
+}
+
+TEST_CASE("TXTLog manifest")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtmanifest");
+    const std::vector<std::string> unrelated = {"app2_20240101.000000.log", "application.log", "app_notes.log",
+                                                "archive_app_backup.xz", "archive_app_20240101.000000.log"};
+    for (const std::string &name : unrelated)
+    {
+        std::ofstream("./log/txtmanifest/" + name) << "not ours\n";
+    }
+    std::ofstream("./log/txtmanifest/app_20240101.000000.log") << "old backup\n";
+    std::string archive;
+    XzCodec(0).compressBuffer("older archive\n", 14, archive);
+    std::ofstream("./log/txtmanifest/archive_app_20231231.235959.xz") << archive;
+
+    TXTLog log("./log/txtmanifest", "app", 1024 * 1024, 1, 1);
+    log.setCodec(std::make_shared<XzCodec>(0));
+    CHECK(log.getStoredSize() == 11 + archive.size());
+
+    /* a second backup pushes the old one into an archive, which pushes out the older archive */
+    log.write("current\n");
+    log.setMaxFileSize(1);
+    log.write("next\n");
+    log.waitForMaintenance();
+
+    std::vector<std::string> files = listDirectory("./log/txtmanifest");
+    for (const std::string &name : unrelated)
+    {
+        CHECK(std::find(files.begin(), files.end(), name) != files.end());
+    }
+    CHECK(std::find(files.begin(), files.end(), "app_20240101.000000.log") == files.end());
+    CHECK(std::find(files.begin(), files.end(), "archive_app_20231231.235959.xz") == files.end());
+    REQUIRE(std::find(files.begin(), files.end(), "archive_app_20240101.000000.xz") != files.end());
+    CHECK(decodeXz("./log/txtmanifest/archive_app_20240101.000000.xz") == "old backup\n");
+    CHECK(files.size() == unrelated.size() + 3);
+    CHECK(log.getStoredSize() == fileSize("./log/txtmanifest/archive_app_20240101.000000.xz") + 8);
+}
+
+TEST_CASE("TXTLog archiving failures")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtfail");
+    ::rmdir("./log/txtfail/archive_app_20240101.000001.xz");
+    for (const char *key : {"000000", "000001", "000002"})
+    {
+        std::ofstream("./log/txtfail/app_20240101." + std::string(key) + ".log") << "backup " << key << "\n";
+    }
+    /* the archive of the middle backup cannot be created */
+    REQUIRE(::mkdir("./log/txtfail/archive_app_20240101.000001.xz", 0755) == 0);
+
+    TXTLog log("./log/txtfail", "app", 1024 * 1024, 1, 10);
+    log.setBackgroundMaintenance(false);
+    log.setCodec(std::make_shared<XzCodec>(0));
+    log.write("current\n");
+    log.setMaxFileSize(1);
+    log.write("next\n");
+
+    /* the others are archived and removed, the failed one waits for the next pass */
+    std::vector<std::string> files = listDirectory("./log/txtfail");
+    auto has = [&files](const std::string &name)
+    {
+        return std::find(files.begin(), files.end(), name) != files.end();
+    };
+    CHECK(!has("app_20240101.000000.log"));
+    CHECK(!has("app_20240101.000002.log"));
+    CHECK(has("archive_app_20240101.000000.xz"));
+    CHECK(has("archive_app_20240101.000002.xz"));
+    CHECK(has("app_20240101.000001.log"));
+
+    /* after a few failed passes it is moved aside instead of holding back the backups */
+    log.write("more\n");
+    log.write("more\n");
+    files = listDirectory("./log/txtfail");
+    CHECK(!has("app_20240101.000001.log"));
+    CHECK(has("app_20240101.000001.log.failed"));
+    std::size_t backups = 0;
+    for (const std::string &name : files)
+    {
+        if (name.compare(0, 4, "app_") == 0 && name.size() > 4 && name.compare(name.size() - 4, 4, ".log") == 0)
+            backups++;
+    }
+    CHECK(backups == 1);
+    ::rmdir("./log/txtfail/archive_app_20240101.000001.xz");
+}
+
+TEST_CASE("TXTLog group commit")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtgroup");
+    TXTLog log("./log/txtgroup", "group", 64 * 1024 * 1024, 1, 1);
+    log.setGroupCommit(true);
+    CHECK(log.isGroupCommit() == true);
+
+    const int threads = 8;
+    const int records = 500;
+    std::atomic<int> failures(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&log, &failures, t]()
+                             {
+                                 for (int i = 0; i < records; i++)
+                                 {
+                                     if (!log.write("thread " + std::to_string(t) + " record " + std::to_string(i) + "\n"))
+                                         failures++;
+                                 } });
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    CHECK(failures == 0);
+
+    /* every record intact, and each thread's records in the order it wrote them */
+    std::ifstream input("./log/txtgroup/group.log");
+    std::vector<int> next(threads, 0);
+    std::string line;
+    int lines = 0;
+    while (std::getline(input, line))
+    {
+        int t = -1, i = -1;
+        REQUIRE(std::sscanf(line.c_str(), "thread %d record %d", &t, &i) == 2);
+        REQUIRE(t >= 0);
+        REQUIRE(t < threads);
+        CHECK(i == next[t]);
+        next[t] = i + 1;
+        lines++;
+    }
+    CHECK(lines == threads * records);
+}
+
+TEST_CASE("TXTLog io_uring backend")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txturing");
+    /* small files and a small pool so rotation, buffer reuse and short writes all happen */
+    TXTLog log("./log/txturing", "uring", 64 * 1024, 100, 1);
+    log.setBackgroundMaintenance(false);
+    bool available = log.setIoUring(true, 4096, 4);
+    CHECK(log.isIoUring() == available);
+
+    const int records = 6000;
+    int failures = 0;
+    for (int i = 0; i < records; i++)
+    {
+        char line[64];
+        std::snprintf(line, sizeof(line), "record %06d the quick brown fox\n", i);
+        if (!log.write(line))
+            failures++;
+        if (i == 1000)
+            log.flush();
+        if (i == 2000)
+            log.setBufferSize(8192);
+        if (i == 4000)
+            log.setGroupCommit(true);
+    }
+    CHECK(failures == 0);
+    log.close();
+
+    /* the backups in name order followed by the active file hold every record once */
+    std::vector<std::string> files = listDirectory("./log/txturing");
+    REQUIRE(files.size() > 1);
+    REQUIRE(files.front() == "uring.log");
+    files.push_back(files.front());
+    files.erase(files.begin());
+    int next = 0;
+    for (const std::string &file : files)
+    {
+        std::ifstream input("./log/txturing/" + file);
+        std::string line;
+        while (std::getline(input, line))
+        {
+            int i = -1;
+            REQUIRE(std::sscanf(line.c_str(), "record %d", &i) == 1);
+            REQUIRE(i == next);
+            next++;
+        }
+    }
+    CHECK(next == records);
+
+    CHECK(log.setIoUring(false) == true);
+    CHECK(log.isIoUring() == false);
+    CHECK(log.write("after\n"));
+    log.close();
+    CHECK(fileSize("./log/txturing/uring.log") > 0);
+
+    /* records queued by a logger that goes quiet are submitted by the worker */
+    TXTLog idle("./log/txturing", "idle", 64 * 1024, 1, 1, 0, 20);
+    if (idle.setIoUring(true))
+    {
+        CHECK(idle.write("idle\n"));
+        CHECK(waitForSize("./log/txturing/idle.log", 5) == 5);
+    }
+}
+
+TEST_CASE("TXTLog memory-mapped active file")
+{
+    ::mkdir("./log", 0755);
+
+    SUBCASE("lock-free writers across rotations")
+    {
+        resetDirectory("./log/txtmapped");
+        TXTLog log("./log/txtmapped", "mapped", 64 * 1024, 100, 1);
+        log.setBackgroundMaintenance(false);
+        CHECK(log.setMappedFile(true) == true);
+        CHECK(log.isMappedFile() == true);
+
+        const int threads = 4;
+        const int records = 2000;
+        std::atomic<int> failures(0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&log, &failures, t]()
+                                 {
+                                     for (int i = 0; i < records; i++)
+                                     {
+                                         if (!log.write("thread " + std::to_string(t) + " record " + std::to_string(i) + "\n"))
+                                             failures++;
+                                     } });
+        }
+        /* flushes sync outside the writer lock while rotations unmap the files */
+        std::atomic<bool> writing(true);
+        std::thread flusher([&log, &writing]()
+                            {
+                                while (writing)
+                                    log.flush(); });
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+        writing = false;
+        flusher.join();
+        CHECK(failures == 0);
+        log.close();
+
+        /* files are cut to their data, within the limit, and hold each thread's records in order */
+        std::vector<std::string> files = listDirectory("./log/txtmapped");
+        REQUIRE(files.size() > 1);
+        REQUIRE(files.front() == "mapped.log");
+        files.push_back(files.front());
+        files.erase(files.begin());
+        std::vector<int> next(threads, 0);
+        int lines = 0;
+        for (const std::string &file : files)
+        {
+            std::string path = "./log/txtmapped/" + file;
+            CHECK(fileSize(path) <= 64 * 1024);
+            std::ifstream input(path);
+            std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+            CHECK(content.find('\0') == std::string::npos);
+            std::istringstream lineStream(content);
+            std::string line;
+            while (std::getline(lineStream, line))
+            {
+                int t = -1, i = -1;
+                REQUIRE(std::sscanf(line.c_str(), "thread %d record %d", &t, &i) == 2);
+                REQUIRE(t >= 0);
+                REQUIRE(t < threads);
+                CHECK(i == next[t]);
+                next[t] = i + 1;
+                lines++;
+            }
+        }
+        CHECK(lines == threads * records);
+    }
+
+    SUBCASE("zero tail left by a crash is cut")
+    {
+        resetDirectory("./log/txtmapped");
+        {
+            std::ofstream crashed("./log/txtmapped/mapped.log", std::ios::binary);
+            crashed << "before crash\n";
+            crashed << std::string(100000, '\0');
+        }
+        TXTLog log("./log/txtmapped", "mapped", 1024 * 1024, 100, 1);
+        CHECK(log.setMappedFile(true) == true);
+        CHECK(log.write("after restart\n"));
+        log.flush();
+
+        /* a read-only query stops at the data, not at the preallocated end */
+        std::vector<TXTLog::Record> records;
+        CHECK(TXTLog::queryDirectory("./log/txtmapped", "mapped", TXTLog::Query(), records) == true);
+        std::string text;
+        for (const TXTLog::Record &record : records)
+            text += record.text;
+        CHECK(text == "before crash\nafter restart\n");
+
+        CHECK(log.setMappedFile(false) == true);
+        CHECK(log.write("unmapped\n"));
+        log.close();
+
+        std::ifstream input("./log/txtmapped/mapped.log");
+        std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        CHECK(content == "before crash\nafter restart\nunmapped\n");
+    }
+}
+
+TEST_CASE("TXTLog durability policies")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtdurable");
+    /* a large, long-lived buffer: only a sync moves data into the file */
+    TXTLog log("./log/txtdurable", "durable", 64 * 1024 * 1024, 1, 1, 1024 * 1024, 60000);
+    const std::string path = "./log/txtdurable/durable.log";
+    const std::string info = stampedLine(1, 0, "info record");
+    const std::string critical = "[260101_000000.000] [C]: critical record\n";
+
+    auto waitForData = [&path]()
+    {
+        for (int i = 0; i < 200 && fileSize(path) == 0; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return fileSize(path);
+    };
+
+    CHECK(log.getDurability() == TXTLog::DURABILITY_NONE);
+    CHECK(log.write(info));
+    CHECK(fileSize(path) == 0);
+
+    SUBCASE("critical")
+    {
+        log.setDurability(TXTLog::DURABILITY_CRITICAL);
+        CHECK(log.getDurability() == TXTLog::DURABILITY_CRITICAL);
+        CHECK(log.write(info));
+        CHECK(fileSize(path) == 0);
+        /* the critical record and everything before it is synced before write() returns */
+        CHECK(log.write(info + critical));
+        CHECK(fileSize(path) == info.size() * 3 + critical.size());
+    }
+
+    SUBCASE("interval")
+    {
+        log.setDurability(TXTLog::DURABILITY_INTERVAL, 20);
+        CHECK(log.getDurability() == TXTLog::DURABILITY_INTERVAL);
+        CHECK(waitForData() == info.size());
+    }
+
+    SUBCASE("bytes")
+    {
+        log.setDurability(TXTLog::DURABILITY_BYTES, info.size() * 4);
+        CHECK(log.write(info));
+        CHECK(log.write(info));
+        CHECK(fileSize(path) == 0);
+        CHECK(log.write(info));
+        CHECK(log.write(info));
+        CHECK(waitForData() == info.size() * 5);
+    }
+
+    log.setDurability(TXTLog::DURABILITY_NONE);
+    log.close();
+}
+
+TEST_CASE("TXTLog multi-process shared files")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txtshared");
+    const int processes = 4;
+    const int records = 1500;
+    const std::size_t maxFileSize = 16 * 1024;
+
+    /* a full active file left by an earlier writer, numbered as one more process */
+    int prefill = 0;
+    {
+        std::ofstream output("./log/txtshared/shared.log");
+        for (std::size_t size = 0; size < maxFileSize; prefill++)
+        {
+            char line[64];
+            size += static_cast<std::size_t>(std::snprintf(line, sizeof(line), "process %d record %05d\n", processes, prefill));
+            output << line;
+        }
+    }
+
+    /* all of them join the full file at once, only one may rotate it */
+    int start[2];
+    REQUIRE(::pipe(start) == 0);
+    std::vector<pid_t> children;
+    for (int p = 0; p < processes; p++)
+    {
+        pid_t pid = ::fork();
+        if (pid == 0)
+        {
+            int status = 0;
+            ::close(start[1]);
+            char go;
+            if (::read(start[0], &go, 1) != 0)
+                status = 1;
+            {
+                /* the last process buffers, so batches of several records go out in one write */
+                TXTLog log("./log/txtshared", "shared", maxFileSize, 1000, 10, (p == processes - 1) ? 2048 : 0, 1000, true);
+                log.setBackgroundMaintenance(false);
+                if (!log.isMultiProcess() || log.setMappedFile(true) || log.setIoUring(true))
+                    status = 1;
+                for (int i = 0; i < records; i++)
+                {
+                    char line[64];
+                    std::snprintf(line, sizeof(line), "process %d record %05d\n", p, i);
+                    if (!log.write(line))
+                        status = 1;
+                }
+            }
+            ::_exit(status);
+        }
+        REQUIRE(pid > 0);
+        children.push_back(pid);
+    }
+    ::close(start[0]);
+    ::close(start[1]);
+    for (pid_t pid : children)
+    {
+        int status = -1;
+        CHECK(::waitpid(pid, &status, 0) == pid);
+        CHECK(WIFEXITED(status));
+        CHECK(WEXITSTATUS(status) == 0);
+    }
+
+    /* backups sort oldest first, the active file holds the newest records */
+    std::vector<std::string> files;
+    for (const std::string &name : listDirectory("./log/txtshared"))
+    {
+        if (name.compare(0, 7, "shared_") == 0)
+            files.push_back("./log/txtshared/" + name);
+    }
+    CHECK(files.size() > 4);
+    for (const std::string &file : files)
+    {
+        CHECK(fileSize(file) >= maxFileSize);
+        CHECK(fileSize(file) < maxFileSize + processes * 2048);
+    }
+    files.push_back("./log/txtshared/shared.log");
+
+    /* every record exactly once, whole, and in the order its process wrote it */
+    std::vector<int> next(processes + 1, 0);
+    for (const std::string &file : files)
+    {
+        std::ifstream input(file);
+        std::string line;
+        while (std::getline(input, line))
+        {
+            int p = -1;
+            int i = -1;
+            char tail = 0;
+            REQUIRE(std::sscanf(line.c_str(), "process %d record %d%c", &p, &i, &tail) == 2);
+            REQUIRE(p >= 0);
+            REQUIRE(p <= processes);
+            CHECK(i == next[p]);
+            next[p] = i + 1;
+        }
+    }
+    for (int p = 0; p < processes; p++)
+    {
+        CHECK(next[p] == records);
+    }
+    CHECK(next[processes] == prefill);
+}
+
+TEST_CASE("TXTLog time-based rotation")
+{
+    ::mkdir("./log", 0755);
+    resetDirectory("./log/txttime");
+    const std::string path = "./log/txttime/time.log";
+    const std::string line = "time-based rotation record\n";
+
+    auto backups = []()
+    {
+        std::size_t count = 0;
+        for (const std::string &name : listDirectory("./log/txttime"))
+        {
+            if (name.compare(0, 5, "time_") == 0)
+                count++;
+        }
+        return count;
+    };
+
+    SUBCASE("hourly")
+    {
+        /* a file left over from two hours ago */
+        {
+            std::ofstream old(path);
+            old << line;
+        }
+        struct timeval times[2];
+        times[0].tv_sec = std::time(nullptr) - 2 * 3600;
+        times[0].tv_usec = 0;
+        times[1] = times[0];
+        REQUIRE(::utimes(path.c_str(), times) == 0);
+
+        TXTLog log("./log/txttime", "time", 64, 10, 10);
+        log.setBackgroundMaintenance(false);
+        log.setRotationPolicy(TXTLog::ROTATE_HOURLY);
+        CHECK(log.getRotationPolicy() == TXTLog::ROTATE_HOURLY);
+
+        /* the old hour is cut on the first write, then the size no longer matters */
+        for (int i = 0; i < 10; i++)
+        {
+            CHECK(log.write(line));
+        }
+        CHECK(backups() == 1);
+        CHECK(fileSize(path) == line.size() * 10);
+    }
+
+    SUBCASE("size or age")
+    {
+        TXTLog log("./log/txttime", "time", 1024, 10, 10);
+        log.setBackgroundMaintenance(false);
+        log.setRotationPolicy(TXTLog::ROTATE_SIZE_OR_AGE, 1);
+
+        /* an empty file past its deadline starts the next period instead of becoming a backup */
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        CHECK(log.write(line));
+        CHECK(log.write(line));
+        CHECK(backups() == 0);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        CHECK(log.write(line));
+        CHECK(backups() == 1);
+        CHECK(fileSize(path) == line.size());
+
+        /* the size limit still applies */
+        for (int i = 0; i < 40; i++)
+        {
+            CHECK(log.write(line));
+        }
+        CHECK(backups() == 2);
+    }
+}
@@ -6,6 +6,7 @@
 #include <sstream>
 #include <cstdlib>
 #include "txtlog.hpp"
+#include "txtlog-codec.hpp"
 #include "debug.hpp"
 
 class CmdOptions
@@ -107,6 +108,14 @@ _________________________________________________________________________
                                 "                                Default: 10\n\n"
                                 "  --buffer=<count>              Input buffer size\n"
                                 "                                Default: 1024 bytes\n\n"
+                                "  --archive-threads=<count>     Threads used to compress backups\n"
+                                "                                0 uses every core, Default: 1\n\n"
+                                "  --codec=<xz|gzip>             Archive compression codec\n"
+                                "                                Default: xz\n\n"
+                                "  --preset=<level|auto>         Codec preset, auto follows the log rate\n"
+                                "                                Default: 6\n\n"
+                                "  --index-block=<bytes>         Write seekable archives with a time index,\n"
+                                "                                blocks of this size. Default: 0 (off)\n\n"
                                 "  --help                        Show this help and exit\n";
     }
 };
@@ -145,6 +154,10 @@ int main(int argc, char **argv)
     const std::size_t maxTxtBackups = opts.getSizeT("max-txt-backups", 3);
     const std::size_t maxArchiveFiles = opts.getSizeT("max-archive-files", 10);
     const std::size_t bsz = opts.getSizeT("buffer", 1024);
+    const std::size_t archiveThreads = opts.getSizeT("archive-threads", 1);
+    const std::string codecName = opts.getString("codec", "xz");
+    const std::string presetValue = opts.getString("preset", "6");
+    const std::size_t indexBlock = opts.getSizeT("index-block", 0);
 
     printConfig(
         workDir,
@@ -160,6 +173,17 @@ int main(int argc, char **argv)
         maxFileSize,
         maxTxtBackups,
         maxArchiveFiles);
+    log.setArchiveThreads(static_cast<std::uint32_t>(archiveThreads));
+
+    int preset = (presetValue == "auto") ? TXTLogCodec::PRESET_AUTO : std::atoi(presetValue.c_str());
+#ifndef __DISABLE_ZLIB
+    if (codecName == "gzip")
+        log.setCodec(std::make_shared<GzipCodec>(preset));
+    else
+#endif
+        log.setCodec(std::make_shared<XzCodec>(preset));
+    if (indexBlock > 0)
+        log.setIndexedArchives(true, indexBlock);
 
     std::string line;
     std::string toWrite;
@@ -0,0 +1,169 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <sstream>
+#include <cstdlib>
+#include "txtlog.hpp"
+#include "time.hpp"
+#include "debug.hpp"
+
+class CmdOptions
+{
+private:
+    std::unordered_map<std::string, std::vector<std::string>> options;
+
+    void parse(int argc, char *argv[])
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg(argv[i]);
+
+            if (arg == "--help")
+            {
+                printHelp(argv[0]);
+                std::exit(0);
+            }
+
+            if (arg.rfind("--", 0) == 0)
+            {
+                auto pos = arg.find('=');
+                if (pos != std::string::npos)
+                {
+                    std::string key = arg.substr(2, pos - 2);
+                    std::string value = arg.substr(pos + 1);
+                    options[key].push_back(value);
+                }
+            }
+        }
+    }
+
+public:
+    CmdOptions(int argc, char *argv[])
+    {
+        parse(argc, argv);
+    }
+
+    std::string getString(const std::string &key,
+                          const std::string &defaultValue) const
+    {
+        auto it = options.find(key);
+        return (it != options.end()) ? it->second.back() : defaultValue;
+    }
+
+    std::vector<std::string> getAll(const std::string &key) const
+    {
+        auto it = options.find(key);
+        return (it != options.end()) ? it->second : std::vector<std::string>();
+    }
+
+    static void printHelp(const std::string &appName)
+    {
+        std::cout << R"(
+_________________________________________________________________________
+
+utils-query searches the logs written by utils-logger (or any TXTLog
+instance): the active file, the plain text backups and the compressed
+archives. Every file is scanned by its own worker and the matching
+records are printed in time order.
+
+A record is a line starting with a Debug header
+"[YYMMDD_HHMMSS.mmm] [L]: " plus the lines following it without one.
+_________________________________________________________________________
+)" << std::endl;
+
+        std::cout << "Usage:\n"
+                     "  "
+                  << appName << " [options]\n\n"
+                                "Options:\n"
+                                "  --workdir=<path>              Working directory of the log files\n"
+                                "                                Default: /var/log\n\n"
+                                "  --filename=<name>             Base log file name\n"
+                                "                                Default: log\n\n"
+                                "  --from=<time>                 First second, \"YYYY-MM-DD HH:MM:SS\"\n"
+                                "                                (local time) or epoch seconds\n\n"
+                                "  --to=<time>                   Last second (inclusive), same format\n\n"
+                                "  --level=<info|warning|error|critical>\n"
+                                "                                Minimum level. Default: info\n\n"
+                                "  --contains=<text>             Substring filter, may be repeated,\n"
+                                "                                a record matches if it has any of them\n\n"
+                                "  --regex=<pattern>             ECMAScript regular expression filter\n\n"
+                                "  --help                        Show this help and exit\n";
+    }
+};
+
+static bool parseTime(const std::string &value, std::time_t &result)
+{
+    if (value.empty())
+    {
+        result = 0;
+        return true;
+    }
+    if (value.find_first_not_of("0123456789") == std::string::npos)
+    {
+        result = static_cast<std::time_t>(std::strtoll(value.c_str(), nullptr, 10));
+        return true;
+    }
+
+    std::tm tmTime;
+    if (!TimeUtils::parse(&tmTime, value.c_str(), TimeUtils::TIME_FORMAT_SQL_DATETIME))
+    {
+        return false;
+    }
+    tmTime.tm_isdst = -1;
+    result = TimeUtils::toEpoch(&tmTime);
+    return true;
+}
+
+static bool parseLevel(const std::string &value, Debug::LogType_t &level)
+{
+    if (value == "info")
+        level = Debug::INFO;
+    else if (value == "warning")
+        level = Debug::WARNING;
+    else if (value == "error")
+        level = Debug::ERROR;
+    else if (value == "critical")
+        level = Debug::CRITICAL;
+    else
+        return false;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    CmdOptions opts(argc, argv);
+
+    const std::string workDir = opts.getString("workdir", "/var/log");
+    const std::string fileName = opts.getString("filename", "log");
+
+    TXTLog::Query query;
+    query.contains = opts.getAll("contains");
+    query.pattern = opts.getString("regex", "");
+    if (!parseTime(opts.getString("from", ""), query.from) || !parseTime(opts.getString("to", ""), query.to))
+    {
+        std::cerr << "invalid time, expected \"YYYY-MM-DD HH:MM:SS\" or epoch seconds" << std::endl;
+        return 1;
+    }
+    if (!parseLevel(opts.getString("level", "info"), query.minLevel))
+    {
+        std::cerr << "invalid level, expected info, warning, error or critical" << std::endl;
+        return 1;
+    }
+
+    /* keep TXTLog's own messages out of the results */
+    Debug::setLogLevel(Debug::ERROR);
+
+    /* read-only, the files of a running logger are never created, locked or rotated */
+    std::vector<TXTLog::Record> records;
+    if (!TXTLog::queryDirectory(workDir, fileName, query, records))
+    {
+        return 1;
+    }
+    for (const TXTLog::Record &record : records)
+    {
+        std::cout << record.text;
+    }
+    std::cout.flush();
+    return 0;
+}